@@ -0,0 +1,134 @@
+// jack-bridge-local/include/circuit_breaker.h
+// Consecutive-failure circuit breaker with a single half-open probe
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "instrumented_mutex.h"
+
+// Closed: calls go through. failureThreshold failures in a row (a call that
+// timed out, or answered but took longer than slowCall) open the circuit.
+// Open: calls are rejected at once for openFor.
+// HalfOpen: the next call goes through as a probe while the rest are still
+// rejected; the probe's outcome closes the circuit or opens it again.
+//
+// Every admitted call must be recorded, and by its caller rather than by
+// whatever runs it, so a probe that never comes back still ends in a
+// failure once its caller stops waiting. A caller that gave up for reasons
+// of its own releases the call instead: it counts neither way.
+class CircuitBreaker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State : uint8_t { Closed, Open, HalfOpen };
+    enum class Admission : uint8_t { Rejected, Admitted, Probe };
+
+    struct Options {
+        uint32_t failureThreshold = 3;
+        Clock::duration slowCall = std::chrono::milliseconds(1000);
+        Clock::duration openFor = std::chrono::milliseconds(5000);
+    };
+
+    struct Stats {
+        State state = State::Closed;
+        uint32_t consecutiveFailures = 0;
+        uint64_t trips = 0;
+        uint64_t rejected = 0;
+        uint64_t probes = 0;
+        uint64_t retryAfterMs = 0;      // until the next probe may go; 0 unless open
+    };
+
+    explicit CircuitBreaker(const char* name) : mutex(name) {}
+
+    void configure(const Options& o) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        options = o;
+    }
+
+    Admission admit() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (state == State::Open && Clock::now() >= reopenAt) {
+            state = State::HalfOpen;
+            probing = false;
+        }
+        if (state == State::Closed) return Admission::Admitted;
+        if (state == State::HalfOpen && !probing) {
+            probing = true;
+            stats.probes++;
+            return Admission::Probe;
+        }
+        stats.rejected++;
+        return Admission::Rejected;
+    }
+
+    // completed: the call answered before its caller gave up
+    void record(Admission admission, bool completed, Clock::duration elapsed) {
+        if (admission == Admission::Rejected) return;
+        bool ok = completed && elapsed <= options.slowCall;
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (admission == Admission::Probe) {
+            probing = false;
+            if (ok) {
+                state = State::Closed;
+                consecutiveFailures = 0;
+            } else {
+                trip();
+            }
+            return;
+        }
+        if (state != State::Closed) return;    // admitted before the trip; old news
+        if (ok) {
+            consecutiveFailures = 0;
+        } else if (++consecutiveFailures >= options.failureThreshold) {
+            trip();
+        }
+    }
+
+    // Neutral outcome: a released probe lets the next call probe again
+    void release(Admission admission) {
+        if (admission != Admission::Probe) return;
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        probing = false;
+    }
+
+    Stats inspect() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        Stats copy = stats;
+        copy.state = state;
+        copy.consecutiveFailures = consecutiveFailures;
+        if (state == State::Open) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(reopenAt - Clock::now()).count();
+            copy.retryAfterMs = left > 0 ? static_cast<uint64_t>(left) : 0;
+        }
+        return copy;
+    }
+
+    static const char* stateName(State s) {
+        switch (s) {
+        case State::Closed: return "closed";
+        case State::Open: return "open";
+        case State::HalfOpen: return "half_open";
+        }
+        return "closed";
+    }
+
+private:
+    // Caller holds mutex
+    void trip() {
+        state = State::Open;
+        reopenAt = Clock::now() + options.openFor;
+        consecutiveFailures = 0;
+        stats.trips++;
+    }
+
+    InstrumentedMutex mutex;
+    Options options;
+    State state = State::Closed;
+    uint32_t consecutiveFailures = 0;
+    bool probing = false;
+    Clock::time_point reopenAt;
+    Stats stats;
+};
@@ -0,0 +1,207 @@
+// jack-bridge-local/include/control_protocol.h
+// Binary control protocol: framing and field encoding (no I/O)
+//
+// Every frame is a little-endian u32 byte count followed by that many bytes:
+//
+//   request   u32 id | u8 op     | payload
+//   response  u32 id | u8 status | payload     (same id, same order)
+//   event     u32 0  | u8 Event* | payload     (only after Subscribe)
+//
+// Requests on one connection are answered strictly in order, so a client may
+// pipeline as many as it likes without waiting. Strings are u16 length +
+// bytes. Payloads by op:
+//
+//   Ping        -                                -> -
+//   Connect     u16 n, n x (str from, str to)    -> u16 n, n x u8 ok
+//   Disconnect  u16 n, n x (str from, str to)    -> u16 n, n x u8 ok
+//   SetGain     u16 n, n x (u8 out, u8 in, f32 dB; NaN = off)
+//                                                -> u16 n, n x u8 ok
+//   Subscribe   u8 on                            -> u64 graph generation
+//   GetGraph    -                                -> u64 generation, u32 n, n x (str from, str to)
+//
+//   EventGraphChanged  u64 generation, sent once per change seen (coalesced)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace control {
+
+enum Op : uint8_t {
+    Ping = 0,
+    Connect = 1,
+    Disconnect = 2,
+    SetGain = 3,
+    Subscribe = 4,
+    GetGraph = 5,
+};
+
+enum Status : uint8_t {
+    Ok = 0,
+    BadRequest = 1,     // payload did not parse
+    UnknownOp = 2,
+    Unavailable = 3,    // the service behind the op is not running or not answering
+};
+
+enum Event : uint8_t {
+    EventGraphChanged = 0x80,
+};
+
+constexpr size_t kMaxFrame = 1 << 20;
+constexpr size_t kHeaderSize = 4 + 4 + 1;   // length, id, op/status
+
+class Writer {
+public:
+    explicit Writer(std::string& out) : out_(out) {}
+
+    void u8(uint8_t v) { out_.push_back(static_cast<char>(v)); }
+    void u16(uint16_t v) { put(v, 2); }
+    void u32(uint32_t v) { put(v, 4); }
+    void u64(uint64_t v) { put(v, 8); }
+    void f32(float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        u32(bits);
+    }
+    void str(std::string_view s) {
+        u16(static_cast<uint16_t>(s.length()));
+        out_.append(s.data(), s.length());
+    }
+
+    // Starts a frame; the length is filled in by endFrame()
+    size_t beginFrame(uint32_t id, uint8_t opOrStatus) {
+        size_t start = out_.length();
+        u32(0);
+        u32(id);
+        u8(opOrStatus);
+        return start;
+    }
+    void endFrame(size_t start) {
+        uint32_t length = static_cast<uint32_t>(out_.length() - start - 4);
+        for (size_t i = 0; i < 4; i++) {
+            out_[start + i] = static_cast<char>(length >> (8 * i));
+        }
+    }
+
+private:
+    void put(uint64_t v, size_t bytes) {
+        for (size_t i = 0; i < bytes; i++) {
+            out_.push_back(static_cast<char>(v >> (8 * i)));
+        }
+    }
+
+    std::string& out_;
+};
+
+// Reads fields off a payload. A short read leaves ok() false and returns
+// zeros, so a parser can read everything and check once at the end.
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data_(data) {}
+
+    uint8_t u8() { return static_cast<uint8_t>(get(1)); }
+    uint16_t u16() { return static_cast<uint16_t>(get(2)); }
+    uint32_t u32() { return static_cast<uint32_t>(get(4)); }
+    uint64_t u64() { return get(8); }
+    float f32() {
+        uint32_t bits = u32();
+        float v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    std::string_view str() {
+        size_t length = u16();
+        if (!take(length)) return {};
+        std::string_view s = data_.substr(pos_ - length, length);
+        return s;
+    }
+
+    bool ok() const { return ok_; }
+    bool done() const { return ok_ && pos_ == data_.length(); }
+    size_t remaining() const { return ok_ ? data_.length() - pos_ : 0; }
+
+private:
+    bool take(size_t bytes) {
+        if (!ok_ || data_.length() - pos_ < bytes) {
+            ok_ = false;
+            return false;
+        }
+        pos_ += bytes;
+        return true;
+    }
+    uint64_t get(size_t bytes) {
+        if (!take(bytes)) return 0;
+        uint64_t v = 0;
+        for (size_t i = 0; i < bytes; i++) {
+            v |= static_cast<uint64_t>(static_cast<uint8_t>(data_[pos_ - bytes + i])) << (8 * i);
+        }
+        return v;
+    }
+
+    std::string_view data_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+struct Frame {
+    uint32_t id = 0;
+    uint8_t code = 0;           // op in requests, status or event in replies
+    std::string_view payload;   // valid until the next FrameBuffer::consume()
+};
+
+// Collects bytes from a stream and hands out whole frames in place
+class FrameBuffer {
+public:
+    void feed(const char* data, size_t length) { buffer_.append(data, length); }
+
+    // False when no complete frame is buffered; malformed() if the stream
+    // announced a frame that is too short or too long to be valid
+    bool peek(Frame& frame) {
+        size_t available = buffer_.length() - start_;
+        if (available < 4) return false;
+        const char* p = buffer_.data() + start_;
+        uint32_t length = 0;
+        for (size_t i = 0; i < 4; i++) {
+            length |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+        }
+        if (length < kHeaderSize - 4 || length > kMaxFrame) {
+            malformed_ = true;
+            return false;
+        }
+        if (available < 4 + size_t(length)) return false;
+
+        Reader header(std::string_view(p + 4, 5));
+        frame.id = header.u32();
+        frame.code = header.u8();
+        frame.payload = std::string_view(p + kHeaderSize, length - (kHeaderSize - 4));
+        pending_ = 4 + size_t(length);
+        return true;
+    }
+
+    // Drops the frame peek() returned
+    void consume() {
+        start_ += pending_;
+        pending_ = 0;
+        if (start_ == buffer_.length()) {
+            buffer_.clear();
+            start_ = 0;
+        } else if (start_ > 64 * 1024) {
+            buffer_.erase(0, start_);
+            start_ = 0;
+        }
+    }
+
+    bool malformed() const { return malformed_; }
+
+private:
+    std::string buffer_;
+    size_t start_ = 0;
+    size_t pending_ = 0;
+    bool malformed_ = false;
+};
+
+}  // namespace control
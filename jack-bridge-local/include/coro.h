@@ -0,0 +1,219 @@
+// jack-bridge-local/include/coro.h
+// C++20 coroutine primitives: lazy Task<T>, detached Spawn, ThreadPool
+
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory_resource>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "instrumented_mutex.h"
+
+namespace coro {
+
+// Task frames come from this resource when one is installed on the calling
+// thread (a request arena, say), otherwise from the heap. The resource is
+// remembered in front of the frame so it is freed to the right place.
+inline thread_local std::pmr::memory_resource* t_frameResource = nullptr;
+
+namespace detail {
+    constexpr size_t kFrameHeader = alignof(std::max_align_t);
+
+    inline void* allocateFrame(size_t size) {
+        std::pmr::memory_resource* resource = t_frameResource;
+        if (!resource) resource = std::pmr::new_delete_resource();
+        auto* block = static_cast<std::byte*>(resource->allocate(size + kFrameHeader, alignof(std::max_align_t)));
+        *reinterpret_cast<std::pmr::memory_resource**>(block) = resource;
+        return block + kFrameHeader;
+    }
+
+    inline void freeFrame(void* frame, size_t size) {
+        std::byte* block = static_cast<std::byte*>(frame) - kFrameHeader;
+        auto* resource = *reinterpret_cast<std::pmr::memory_resource**>(block);
+        resource->deallocate(block, size + kFrameHeader, alignof(std::max_align_t));
+    }
+
+    struct PromiseBase {
+        std::coroutine_handle<> continuation = std::noop_coroutine();
+        std::exception_ptr error;
+
+        static void* operator new(size_t size) { return allocateFrame(size); }
+        static void operator delete(void* frame, size_t size) { freeFrame(frame, size); }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        // Hands control straight back to whoever awaited the task
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+                return h.promise().continuation;
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+}
+
+// Lazily started coroutine returning T. It runs when awaited and resumes the
+// awaiting coroutine when it finishes; exceptions propagate to the awaiter.
+template <typename T = void>
+class Task {
+public:
+    struct promise_type : detail::PromiseBase {
+        std::optional<T> value;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        template <typename U>
+        void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+    };
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle_) handle_.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+    T await_resume() {
+        if (handle_.promise().error) std::rethrow_exception(handle_.promise().error);
+        return std::move(*handle_.promise().value);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+    std::coroutine_handle<promise_type> handle_;
+};
+
+template <>
+class Task<void> {
+public:
+    struct promise_type : detail::PromiseBase {
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        void return_void() {}
+    };
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle_) handle_.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+    void await_resume() {
+        if (handle_.promise().error) std::rethrow_exception(handle_.promise().error);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Fire-and-forget coroutine: starts at once on the calling thread and frees
+// itself when it returns. The body must not let exceptions escape.
+struct Spawn {
+    struct promise_type {
+        Spawn get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+// Fixed set of threads resuming coroutines in FIFO order. A coroutine moves
+// onto the pool with co_await pool.schedule(); anything that completes an
+// operation a coroutine waits for resumes it with post().
+class ThreadPool {
+public:
+    ~ThreadPool() { stop(); }
+
+    void start(size_t threads) {
+        std::lock_guard<InstrumentedMutex> lock(mutex_);
+        stopping_ = false;
+        while (workers_.size() < threads) {
+            workers_.emplace_back([this] { run(); });
+        }
+    }
+
+    // Runs what is already queued, then joins the threads
+    void stop() {
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& worker : workers_) {
+            if (worker.joinable()) worker.join();
+        }
+        workers_.clear();
+    }
+
+    void post(std::coroutine_handle<> h) {
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex_);
+            queue_.push_back(h);
+        }
+        wake_.notify_one();
+    }
+
+    auto schedule() {
+        struct Awaiter {
+            ThreadPool& pool;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { pool.post(h); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    size_t threads() const { return workers_.size(); }
+
+    size_t queued() {
+        std::lock_guard<InstrumentedMutex> lock(mutex_);
+        return queue_.size();
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::coroutine_handle<> next;
+            {
+                std::unique_lock<InstrumentedMutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                next = queue_.front();
+                queue_.pop_front();
+            }
+            next.resume();
+        }
+    }
+
+    InstrumentedMutex mutex_{"coro_pool"};
+    std::condition_variable_any wake_;
+    std::deque<std::coroutine_handle<>> queue_;
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+};
+
+}  // namespace coro
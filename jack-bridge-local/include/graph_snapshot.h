@@ -0,0 +1,110 @@
+// jack-bridge-local/include/graph_snapshot.h
+// Immutable view of the JACK port graph shared between request threads
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "port_name.h"
+
+// Edges reference ports by index so a snapshot stores each name exactly once
+struct PortEdge {
+    uint32_t from;
+    uint32_t to;
+};
+
+struct GraphSnapshot {
+    static constexpr uint32_t kNoPort = UINT32_MAX;
+
+    uint64_t generation = 0;
+    std::vector<PortName> ports;    // jack_get_ports() order
+    std::vector<PortEdge> edges;    // output -> input, sorted by (from, to)
+    std::vector<uint32_t> byName;   // port indices sorted by name
+
+    // Per-port adjacency, compressed: port p's outgoing edges are
+    // edges[outStart[p], outStart[p + 1]), and its incoming ones are the
+    // edge indices inEdges[inStart[p], inStart[p + 1]), ordered by source
+    std::vector<uint32_t> outStart;
+    std::vector<uint32_t> inStart;
+    std::vector<uint32_t> inEdges;
+
+    // Empties the snapshot but keeps vector capacity for the next rebuild
+    void clear() {
+        generation = 0;
+        ports.clear();
+        edges.clear();
+        byName.clear();
+        outStart.clear();
+        inStart.clear();
+        inEdges.clear();
+    }
+
+    void buildIndex() {
+        byName.resize(ports.size());
+        for (uint32_t i = 0; i < byName.size(); i++) {
+            byName[i] = i;
+        }
+        std::sort(byName.begin(), byName.end(), [this](uint32_t a, uint32_t b) {
+            return ports[a].view() < ports[b].view();
+        });
+    }
+
+    // After the edges are in; sorts them
+    void buildAdjacency() {
+        std::sort(edges.begin(), edges.end(), [](const PortEdge& a, const PortEdge& b) {
+            return a.from != b.from ? a.from < b.from : a.to < b.to;
+        });
+        size_t count = ports.size();
+        outStart.assign(count + 1, 0);
+        inStart.assign(count + 1, 0);
+        for (const PortEdge& edge : edges) {
+            outStart[edge.from + 1]++;
+            inStart[edge.to]++;
+        }
+        for (size_t p = 1; p <= count; p++) {
+            outStart[p] += outStart[p - 1];
+            inStart[p] += inStart[p - 1];
+        }
+        // inStart[p] is the end of p's range here; filling backwards leaves
+        // it at the start, and each range in source order
+        inEdges.resize(edges.size());
+        for (size_t i = edges.size(); i-- > 0;) {
+            inEdges[--inStart[edges[i].to]] = static_cast<uint32_t>(i);
+        }
+    }
+
+    std::span<const PortEdge> outgoing(uint32_t port) const {
+        if (port + 1 >= outStart.size()) return {};
+        return {edges.data() + outStart[port], edges.data() + outStart[port + 1]};
+    }
+
+    // Indices into edges
+    std::span<const uint32_t> incoming(uint32_t port) const {
+        if (port + 1 >= inStart.size()) return {};
+        return {inEdges.data() + inStart[port], inEdges.data() + inStart[port + 1]};
+    }
+
+    uint32_t findPort(std::string_view name) const {
+        auto it = std::lower_bound(byName.begin(), byName.end(), name,
+            [this](uint32_t index, std::string_view key) { return ports[index].view() < key; });
+        if (it != byName.end() && ports[*it].view() == name) {
+            return *it;
+        }
+        return kNoPort;
+    }
+
+    bool connected(std::string_view from, std::string_view to) const {
+        uint32_t a = findPort(from), b = findPort(to);
+        if (a == kNoPort || b == kNoPort) return false;
+        std::span<const PortEdge> out = outgoing(a);
+        return std::binary_search(out.begin(), out.end(), PortEdge{a, b},
+                                  [](const PortEdge& x, const PortEdge& y) { return x.to < y.to; });
+    }
+
+    const PortName& fromName(const PortEdge& edge) const { return ports[edge.from]; }
+    const PortName& toName(const PortEdge& edge) const { return ports[edge.to]; }
+};
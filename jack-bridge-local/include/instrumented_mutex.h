@@ -0,0 +1,293 @@
+// jack-bridge-local/include/instrumented_mutex.h
+// Mutex wrapper that records contention and hold-time statistics
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// Where a lock was taken; captured with LOCK_SITE at the lock call
+struct LockSite {
+    const char* file = nullptr;
+    int line = 0;
+    const char* function = nullptr;
+};
+
+#define LOCK_SITE (LockSite{__FILE__, __LINE__, __func__})
+
+// Drop-in replacement for std::mutex. With statistics disabled (the default)
+// lock() costs one relaxed atomic load on top of the plain mutex; enabled, it
+// adds two clock reads per acquisition and records:
+//   - acquisition and contention counts
+//   - log2-nanosecond histograms of wait and hold times
+//   - the call sites of the longest holds seen
+// Every instance registers itself so /stats/locks picks up new locks for free.
+class InstrumentedMutex {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kHistogramBuckets = 32; // bucket i: [2^i, 2^(i+1)) ns
+    static constexpr size_t kLongestHolds = 8;
+
+    struct LongHold {
+        uint64_t holdNs = 0;
+        LockSite site;
+    };
+
+    struct Stats {
+        const char* name = nullptr;
+        uint64_t acquisitions = 0;
+        uint64_t contended = 0;
+        uint64_t waitTotalNs = 0;
+        uint64_t waitMaxNs = 0;
+        uint64_t holdTotalNs = 0;
+        uint64_t holdMaxNs = 0;
+        std::array<uint64_t, kHistogramBuckets> waitHistogram{};
+        std::array<uint64_t, kHistogramBuckets> holdHistogram{};
+        std::vector<LongHold> longestHolds;
+    };
+
+    explicit InstrumentedMutex(const char* name) : name_(name) {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry().push_back(this);
+    }
+
+    ~InstrumentedMutex() {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto& all = registry();
+        all.erase(std::remove(all.begin(), all.end(), this), all.end());
+    }
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+    static void setEnabled(bool enabled) { enabledFlag().store(enabled, std::memory_order_relaxed); }
+    static bool enabled() { return enabledFlag().load(std::memory_order_relaxed); }
+
+    void lock() { lock(LockSite{}); }
+
+    void lock(const LockSite& site) {
+        if (!enabled()) {
+            mutex_.lock();
+            return;
+        }
+
+        Clock::time_point start = Clock::now();
+        bool contended = !mutex_.try_lock();
+        if (contended) {
+            mutex_.lock();
+        }
+        Clock::time_point acquired = Clock::now();
+
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        if (contended) {
+            contended_.fetch_add(1, std::memory_order_relaxed);
+        }
+        record(elapsedNs(start, acquired), waitTotalNs_, waitMaxNs_, waitHistogram_);
+
+        // Only the holder touches these until unlock()
+        holdStart_ = acquired;
+        holderSite_ = site;
+        instrumentedHold_ = true;
+    }
+
+    bool try_lock() {
+        if (!mutex_.try_lock()) {
+            return false;
+        }
+        if (enabled()) {
+            acquisitions_.fetch_add(1, std::memory_order_relaxed);
+            holdStart_ = Clock::now();
+            holderSite_ = LockSite{};
+            instrumentedHold_ = true;
+        }
+        return true;
+    }
+
+    void unlock() {
+        if (!instrumentedHold_) {
+            mutex_.unlock();
+            return;
+        }
+
+        instrumentedHold_ = false;
+        uint64_t heldNs = elapsedNs(holdStart_, Clock::now());
+        LockSite site = holderSite_;
+        mutex_.unlock();
+
+        record(heldNs, holdTotalNs_, holdMaxNs_, holdHistogram_);
+        if (heldNs > longestHoldFloorNs_.load(std::memory_order_relaxed)) {
+            recordLongHold(heldNs, site);
+        }
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.name = name_;
+        s.acquisitions = acquisitions_.load(std::memory_order_relaxed);
+        s.contended = contended_.load(std::memory_order_relaxed);
+        s.waitTotalNs = waitTotalNs_.load(std::memory_order_relaxed);
+        s.waitMaxNs = waitMaxNs_.load(std::memory_order_relaxed);
+        s.holdTotalNs = holdTotalNs_.load(std::memory_order_relaxed);
+        s.holdMaxNs = holdMaxNs_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < kHistogramBuckets; i++) {
+            s.waitHistogram[i] = waitHistogram_[i].load(std::memory_order_relaxed);
+            s.holdHistogram[i] = holdHistogram_[i].load(std::memory_order_relaxed);
+        }
+        std::lock_guard<std::mutex> lock(longHoldMutex_);
+        s.longestHolds.assign(longestHolds_.begin(), longestHolds_.begin() + longHoldCount_);
+        return s;
+    }
+
+    void reset() {
+        acquisitions_ = 0;
+        contended_ = 0;
+        waitTotalNs_ = 0;
+        waitMaxNs_ = 0;
+        holdTotalNs_ = 0;
+        holdMaxNs_ = 0;
+        for (size_t i = 0; i < kHistogramBuckets; i++) {
+            waitHistogram_[i] = 0;
+            holdHistogram_[i] = 0;
+        }
+        std::lock_guard<std::mutex> lock(longHoldMutex_);
+        longHoldCount_ = 0;
+        longestHoldFloorNs_ = 0;
+    }
+
+    // Visits every live instrumented mutex
+    template <typename Fn>
+    static void forEach(Fn&& fn) {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        for (InstrumentedMutex* m : registry()) {
+            fn(*m);
+        }
+    }
+
+    // The last bucket also takes everything longer, so it has no bound:
+    // UINT64_MAX
+    static uint64_t bucketUpperBoundNs(size_t bucket) {
+        return bucket + 1 >= kHistogramBuckets ? UINT64_MAX : (uint64_t{1} << (bucket + 1));
+    }
+
+private:
+    using Histogram = std::array<std::atomic<uint64_t>, kHistogramBuckets>;
+
+    static uint64_t elapsedNs(Clock::time_point from, Clock::time_point to) {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+    }
+
+    static size_t bucketFor(uint64_t ns) {
+        size_t bucket = 0;
+        while (ns > 1 && bucket < kHistogramBuckets - 1) {
+            ns >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    static void record(uint64_t ns, std::atomic<uint64_t>& total, std::atomic<uint64_t>& max,
+                       Histogram& histogram) {
+        total.fetch_add(ns, std::memory_order_relaxed);
+        histogram[bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t current = max.load(std::memory_order_relaxed);
+        while (ns > current && !max.compare_exchange_weak(current, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    static bool sameSite(const LockSite& a, const LockSite& b) {
+        return a.line == b.line && a.file && b.file && std::strcmp(a.file, b.file) == 0;
+    }
+
+    // Keeps the longest hold per call site, sorted longest first
+    void recordLongHold(uint64_t heldNs, const LockSite& site) {
+        std::lock_guard<std::mutex> lock(longHoldMutex_);
+
+        size_t slot = longHoldCount_;
+        for (size_t i = 0; i < longHoldCount_; i++) {
+            if (sameSite(longestHolds_[i].site, site)) {
+                if (longestHolds_[i].holdNs >= heldNs) return;
+                slot = i;
+                break;
+            }
+        }
+        if (slot == longHoldCount_) {
+            if (longHoldCount_ < kLongestHolds) {
+                longHoldCount_++;
+            } else {
+                slot = kLongestHolds - 1;
+                if (longestHolds_[slot].holdNs >= heldNs) return;
+            }
+        }
+
+        longestHolds_[slot] = LongHold{heldNs, site};
+        while (slot > 0 && longestHolds_[slot - 1].holdNs < longestHolds_[slot].holdNs) {
+            std::swap(longestHolds_[slot - 1], longestHolds_[slot]);
+            slot--;
+        }
+        if (longHoldCount_ == kLongestHolds) {
+            longestHoldFloorNs_.store(longestHolds_[kLongestHolds - 1].holdNs, std::memory_order_relaxed);
+        }
+    }
+
+    static std::atomic<bool>& enabledFlag() {
+        static std::atomic<bool> flag{false};
+        return flag;
+    }
+
+    static std::vector<InstrumentedMutex*>& registry() {
+        static std::vector<InstrumentedMutex*> all;
+        return all;
+    }
+
+    static std::mutex& registryMutex() {
+        static std::mutex m;
+        return m;
+    }
+
+    const char* name_;
+    std::mutex mutex_;
+
+    // Holder-only state
+    Clock::time_point holdStart_;
+    LockSite holderSite_;
+    bool instrumentedHold_ = false;
+
+    std::atomic<uint64_t> acquisitions_{0};
+    std::atomic<uint64_t> contended_{0};
+    std::atomic<uint64_t> waitTotalNs_{0};
+    std::atomic<uint64_t> waitMaxNs_{0};
+    std::atomic<uint64_t> holdTotalNs_{0};
+    std::atomic<uint64_t> holdMaxNs_{0};
+    Histogram waitHistogram_{};
+    Histogram holdHistogram_{};
+
+    mutable std::mutex longHoldMutex_;
+    std::array<LongHold, kLongestHolds> longestHolds_{};
+    size_t longHoldCount_ = 0;
+    std::atomic<uint64_t> longestHoldFloorNs_{0};
+};
+
+// Scoped lock that tags the acquisition with its call site
+class InstrumentedLockGuard {
+public:
+    InstrumentedLockGuard(InstrumentedMutex& mutex, const LockSite& site) : mutex_(mutex) {
+        mutex_.lock(site);
+    }
+
+    ~InstrumentedLockGuard() { mutex_.unlock(); }
+
+    InstrumentedLockGuard(const InstrumentedLockGuard&) = delete;
+    InstrumentedLockGuard& operator=(const InstrumentedLockGuard&) = delete;
+
+private:
+    InstrumentedMutex& mutex_;
+};
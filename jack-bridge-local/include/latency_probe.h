@@ -0,0 +1,155 @@
+// jack-bridge-local/include/latency_probe.h
+// Round-trip latency measurement through an external loopback
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+    #include <jack/jack.h>
+}
+
+#include "rt_processor.h"
+
+// One measurement: plays a maximum-length sequence out of `out` once while
+// recording `in` from the same frame on, then sits idle. Both buffers are
+// allocated up front; the RT thread only copies.
+class LatencyProbe : public RtProcessor {
+public:
+    static constexpr unsigned kOrder = 14;   // 16383-frame sequence
+
+    LatencyProbe(jack_port_t* out, jack_port_t* in, float amplitude, size_t maxLagFrames)
+        : out_(out), in_(in), sequence_(maximumLengthSequence(kOrder)) {
+        for (float& s : sequence_) s *= amplitude;
+        captured_.assign(sequence_.size() + maxLagFrames, 0.0f);
+    }
+
+    // RT thread
+    void process(jack_nframes_t nframes) override {
+        float* out = static_cast<float*>(jack_port_get_buffer(out_, nframes));
+        const float* in = static_cast<const float*>(jack_port_get_buffer(in_, nframes));
+
+        size_t played = std::min<size_t>(nframes, sequence_.size() - std::min(position_, sequence_.size()));
+        if (played) std::memcpy(out, sequence_.data() + position_, played * sizeof(float));
+        std::memset(out + played, 0, (nframes - played) * sizeof(float));
+
+        size_t recorded = std::min<size_t>(nframes, captured_.size() - std::min(position_, captured_.size()));
+        if (recorded) std::memcpy(captured_.data() + position_, in, recorded * sizeof(float));
+
+        position_ += nframes;
+        if (position_ >= captured_.size()) {
+            done_.store(true, std::memory_order_release);
+        }
+    }
+
+    bool done() const { return done_.load(std::memory_order_acquire); }
+    size_t durationFrames() const { return captured_.size(); }
+
+    // Valid once done()
+    const std::vector<float>& sequence() const { return sequence_; }
+    const std::vector<float>& captured() const { return captured_; }
+
+    // +1/-1 sequence of period 2^order - 1 from a Fibonacci LFSR (taps for
+    // orders 10-16 from the usual maximal-length tables)
+    static std::vector<float> maximumLengthSequence(unsigned order) {
+        static const uint32_t kTaps[] = {
+            (1u << 9) | (1u << 6),                               // 10: 10,7
+            (1u << 10) | (1u << 8),                              // 11: 11,9
+            (1u << 11) | (1u << 5) | (1u << 3) | (1u << 0),      // 12: 12,6,4,1
+            (1u << 12) | (1u << 3) | (1u << 2) | (1u << 0),      // 13: 13,4,3,1
+            (1u << 13) | (1u << 4) | (1u << 2) | (1u << 0),      // 14: 14,5,3,1
+            (1u << 14) | (1u << 13),                             // 15: 15,14
+            (1u << 15) | (1u << 14) | (1u << 12) | (1u << 3),    // 16: 16,15,13,4
+        };
+        uint32_t taps = kTaps[order - 10];
+        uint32_t state = 1;
+        std::vector<float> out((size_t(1) << order) - 1);
+        for (float& s : out) {
+            s = (state & 1) ? 1.0f : -1.0f;
+            uint32_t parity = state & taps;
+            parity ^= parity >> 16;
+            parity ^= parity >> 8;
+            parity ^= parity >> 4;
+            parity ^= parity >> 2;
+            parity ^= parity >> 1;
+            state = ((state << 1) | (parity & 1)) & ((1u << order) - 1);
+        }
+        return out;
+    }
+
+private:
+    jack_port_t* out_;
+    jack_port_t* in_;
+    std::vector<float> sequence_;
+    std::vector<float> captured_;
+    size_t position_ = 0;           // RT thread only
+    std::atomic<bool> done_{false};
+};
+
+struct LoopbackDelay {
+    bool found = false;
+    uint64_t frames = 0;
+    double preciseFrames = 0;   // parabolic interpolation around the peak
+    bool inverted = false;
+    double peakToNoiseDb = 0;
+};
+
+// Cross-correlates the recording against the sequence at every lag the
+// recording covers. A loop that returns the sequence puts a single peak at
+// the round-trip delay; off-peak correlation of an MLS is nearly flat, so
+// the peak's height over the correlation RMS says how clean the loop is.
+inline LoopbackDelay findLoopbackDelay(const std::vector<float>& sequence, const std::vector<float>& captured,
+                                       double minPeakToNoiseDb = 20.0) {
+    LoopbackDelay result;
+    if (captured.size() <= sequence.size()) return result;
+
+    size_t lags = captured.size() - sequence.size() + 1;
+    std::vector<double> correlation(lags);
+    const float* ref = sequence.data();
+    size_t n = sequence.size(), blocked = n - n % 8;
+    for (size_t lag = 0; lag < lags; lag++) {
+        // Eight independent sums so the compiler can keep them in one vector
+        // register without reassociating floating point
+        const float* x = captured.data() + lag;
+        float acc[8] = {};
+        for (size_t i = 0; i < blocked; i += 8) {
+            for (size_t k = 0; k < 8; k++) {
+                acc[k] += ref[i + k] * x[i + k];
+            }
+        }
+        double sum = 0;
+        for (size_t i = blocked; i < n; i++) sum += ref[i] * x[i];
+        for (float a : acc) sum += a;
+        correlation[lag] = sum;
+    }
+
+    size_t best = 0;
+    double sumSquares = 0;
+    for (size_t lag = 0; lag < lags; lag++) {
+        sumSquares += correlation[lag] * correlation[lag];
+        if (std::fabs(correlation[lag]) > std::fabs(correlation[best])) best = lag;
+    }
+    double peak = std::fabs(correlation[best]);
+    double noiseSquares = sumSquares - peak * peak;
+    double noise = lags > 1 ? std::sqrt(std::max(noiseSquares, 0.0) / (lags - 1)) : 0.0;
+    result.peakToNoiseDb = noise > 0 ? 20.0 * std::log10(peak / noise) : (peak > 0 ? 200.0 : 0.0);
+    if (peak == 0 || result.peakToNoiseDb < minPeakToNoiseDb) return result;
+
+    result.found = true;
+    result.frames = best;
+    result.inverted = correlation[best] < 0;
+    result.preciseFrames = static_cast<double>(best);
+    if (best > 0 && best + 1 < lags) {
+        double a = std::fabs(correlation[best - 1]), b = peak, c = std::fabs(correlation[best + 1]);
+        double denominator = a - 2 * b + c;
+        if (denominator != 0) {
+            result.preciseFrames += 0.5 * (a - c) / denominator;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,265 @@
+// jack-bridge-local/include/lossless_codec.h
+// Lossless block codec for float audio captured from integer converters
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Samples arriving from 16/24/32-bit converters are exact multiples of 2^-31,
+// so they survive a round trip through int32. Each channel block is coded as:
+//   kRaw       float bits verbatim (anything that is not integer-exact)
+//   kConstant  one value repeated (silence)
+//   kRice      wasted low bits removed, order-2 fixed predictor, Rice-coded
+//              residuals with one parameter per block (as in FLAC)
+// The encoder falls back to kRaw whenever coding would not save space, so the
+// worst case is one header byte over the raw size.
+class LosslessCodec {
+public:
+    enum Mode : uint8_t { kRaw = 0, kConstant = 1, kRice = 2 };
+
+    static constexpr unsigned kEscapeQuotient = 32;
+
+    static size_t maxEncodedBytes(uint32_t frames) {
+        return 1 + static_cast<size_t>(frames) * sizeof(float);
+    }
+
+    explicit LosslessCodec(uint32_t maxFrames) : ints_(maxFrames) {}
+
+    // Encodes frames samples read from src with the given stride (interleaved
+    // input). dst must hold maxEncodedBytes(frames). Returns bytes written.
+    size_t encode(const float* src, size_t stride, uint32_t frames, uint8_t* dst) {
+        if (frames == 0) return 0;
+
+        bool constant = true;
+        for (uint32_t i = 1; i < frames && constant; i++) {
+            constant = std::memcmp(&src[i * stride], &src[0], sizeof(float)) == 0;
+        }
+        if (constant) {
+            dst[0] = kConstant;
+            std::memcpy(dst + 1, &src[0], sizeof(float));
+            return 1 + sizeof(float);
+        }
+
+        if (frames >= 3 && frames <= ints_.size() && toIntegers(src, stride, frames)) {
+            size_t bytes = encodeRice(frames, dst);
+            if (bytes > 0) return bytes;
+        }
+        return encodeRaw(src, stride, frames, dst);
+    }
+
+    // Inverse of encode(); writes frames samples to dst with the given stride
+    static bool decode(const uint8_t* src, size_t bytes, uint32_t frames, float* dst, size_t stride) {
+        if (bytes < 1) return false;
+
+        switch (src[0]) {
+        case kRaw:
+            if (bytes < 1 + static_cast<size_t>(frames) * sizeof(float)) return false;
+            for (uint32_t i = 0; i < frames; i++) {
+                std::memcpy(&dst[i * stride], src + 1 + i * sizeof(float), sizeof(float));
+            }
+            return true;
+
+        case kConstant: {
+            if (bytes < 1 + sizeof(float)) return false;
+            float value;
+            std::memcpy(&value, src + 1, sizeof(float));
+            for (uint32_t i = 0; i < frames; i++) {
+                dst[i * stride] = value;
+            }
+            return true;
+        }
+
+        case kRice:
+            return decodeRice(src, bytes, frames, dst, stride);
+
+        default:
+            return false;
+        }
+    }
+
+private:
+    static constexpr double kScale = 2147483648.0; // 2^31
+
+    bool toIntegers(const float* src, size_t stride, uint32_t frames) {
+        for (uint32_t i = 0; i < frames; i++) {
+            double scaled = static_cast<double>(src[i * stride]) * kScale;
+            if (!(scaled >= -kScale && scaled < kScale)) return false;
+            int32_t value = static_cast<int32_t>(scaled);
+            if (static_cast<double>(value) != scaled) return false;
+            ints_[i] = value;
+        }
+        return true;
+    }
+
+    size_t encodeRaw(const float* src, size_t stride, uint32_t frames, uint8_t* dst) {
+        dst[0] = kRaw;
+        for (uint32_t i = 0; i < frames; i++) {
+            std::memcpy(dst + 1 + i * sizeof(float), &src[i * stride], sizeof(float));
+        }
+        return 1 + static_cast<size_t>(frames) * sizeof(float);
+    }
+
+    static uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+    static int64_t unzigzag(uint64_t u) { return static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1); }
+
+    // Header: mode, shift, k, two warm-up samples; then the residual bitstream
+    static constexpr size_t kRiceHeader = 3 + 2 * sizeof(int32_t);
+
+    size_t encodeRice(uint32_t frames, uint8_t* dst) {
+        // Wasted bits: zeros shared by the low end of every sample
+        uint32_t combined = 0;
+        for (uint32_t i = 0; i < frames; i++) combined |= static_cast<uint32_t>(ints_[i]);
+        unsigned shift = 0;
+        while (shift < 31 && combined && !(combined & (1u << shift))) shift++;
+
+        uint64_t sum = 0;
+        for (uint32_t i = 2; i < frames; i++) {
+            sum += zigzag(residual(i, shift)) >> 1;
+        }
+        unsigned k = 0;
+        uint64_t count = frames - 2;
+        while (k < 40 && (count << (k + 1)) <= sum) k++;
+
+        size_t limit = maxEncodedBytes(frames) - 1;
+        dst[0] = kRice;
+        dst[1] = static_cast<uint8_t>(shift);
+        dst[2] = static_cast<uint8_t>(k);
+        int32_t warm0 = ints_[0] >> shift, warm1 = ints_[1] >> shift;
+        std::memcpy(dst + 3, &warm0, sizeof(warm0));
+        std::memcpy(dst + 7, &warm1, sizeof(warm1));
+
+        BitWriter writer(dst + kRiceHeader, limit - kRiceHeader);
+        for (uint32_t i = 2; i < frames; i++) {
+            uint64_t u = zigzag(residual(i, shift));
+            uint64_t q = u >> k;
+            if (q < kEscapeQuotient) {
+                writer.ones(static_cast<unsigned>(q));
+                writer.bits(0, 1);
+                writer.bits(u, k);
+            } else {
+                writer.ones(kEscapeQuotient);
+                writer.bits(u, 64);
+            }
+            if (writer.overflowed()) return 0;
+        }
+        size_t bytes = writer.finish();
+        return writer.overflowed() ? 0 : kRiceHeader + bytes;
+    }
+
+    int64_t residual(uint32_t i, unsigned shift) const {
+        int64_t s0 = ints_[i] >> shift, s1 = ints_[i - 1] >> shift, s2 = ints_[i - 2] >> shift;
+        return s0 - 2 * s1 + s2;
+    }
+
+    static bool decodeRice(const uint8_t* src, size_t bytes, uint32_t frames, float* dst, size_t stride) {
+        if (bytes < kRiceHeader || frames < 3) return false;
+        unsigned shift = src[1], k = src[2];
+        int32_t warm0, warm1;
+        std::memcpy(&warm0, src + 3, sizeof(warm0));
+        std::memcpy(&warm1, src + 7, sizeof(warm1));
+
+        int64_t s2 = warm0, s1 = warm1;
+        auto emit = [&](uint32_t i, int64_t value) {
+            int64_t full = value * (int64_t{1} << shift);
+            dst[i * stride] = static_cast<float>(static_cast<double>(full) / kScale);
+        };
+        emit(0, s2);
+        emit(1, s1);
+
+        BitReader reader(src + kRiceHeader, bytes - kRiceHeader);
+        for (uint32_t i = 2; i < frames; i++) {
+            unsigned q = reader.unary(kEscapeQuotient);
+            uint64_t u = q < kEscapeQuotient ? (static_cast<uint64_t>(q) << k) | reader.bits(k) : reader.bits(64);
+            if (reader.exhausted()) return false;
+            int64_t s0 = unzigzag(u) + 2 * s1 - s2;
+            emit(i, s0);
+            s2 = s1;
+            s1 = s0;
+        }
+        return true;
+    }
+
+    class BitWriter {
+    public:
+        BitWriter(uint8_t* dst, size_t capacity) : dst_(dst), capacity_(capacity) {}
+
+        void ones(unsigned count) {
+            while (count >= 32) { bits(0xFFFFFFFFu, 32); count -= 32; }
+            if (count) bits((uint64_t{1} << count) - 1, count);
+        }
+
+        void bits(uint64_t value, unsigned count) {
+            if (count > 32) {
+                bits(value >> 32, count - 32);
+                value &= 0xFFFFFFFFu;
+                count = 32;
+            }
+            if (count == 0) return;
+            acc_ = (acc_ << count) | (value & ((uint64_t{1} << count) - 1));
+            used_ += count;
+            while (used_ >= 8) {
+                used_ -= 8;
+                put(static_cast<uint8_t>(acc_ >> used_));
+            }
+        }
+
+        size_t finish() {
+            if (used_ > 0) {
+                put(static_cast<uint8_t>(acc_ << (8 - used_)));
+                used_ = 0;
+            }
+            return size_;
+        }
+
+        bool overflowed() const { return overflow_; }
+
+    private:
+        void put(uint8_t byte) {
+            if (size_ >= capacity_) { overflow_ = true; return; }
+            dst_[size_++] = byte;
+        }
+
+        uint8_t* dst_;
+        size_t capacity_;
+        size_t size_ = 0;
+        uint64_t acc_ = 0;
+        unsigned used_ = 0;
+        bool overflow_ = false;
+    };
+
+    class BitReader {
+    public:
+        BitReader(const uint8_t* src, size_t bytes) : src_(src), bytes_(bytes) {}
+
+        unsigned unary(unsigned limit) {
+            unsigned count = 0;
+            while (count < limit && bit()) count++;
+            return count;
+        }
+
+        uint64_t bits(unsigned count) {
+            uint64_t value = 0;
+            for (unsigned i = 0; i < count; i++) value = (value << 1) | bit();
+            return value;
+        }
+
+        bool exhausted() const { return exhausted_; }
+
+    private:
+        unsigned bit() {
+            if (pos_ >= bytes_ * 8) { exhausted_ = true; return 0; }
+            unsigned b = (src_[pos_ >> 3] >> (7 - (pos_ & 7))) & 1;
+            pos_++;
+            return b;
+        }
+
+        const uint8_t* src_;
+        size_t bytes_;
+        size_t pos_ = 0;
+        bool exhausted_ = false;
+    };
+
+    std::vector<int32_t> ints_;
+};
@@ -0,0 +1,302 @@
+// jack-bridge-local/include/loudness.h
+// EBU R128 / ITU-R BS.1770-4 loudness and true-peak metering
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Single-writer value that readers copy without locking: the writer bumps
+// the sequence to odd, stores, bumps to even; a reader retries if the
+// sequence moved underneath it. Payload words are atomics, so a torn read is
+// detected rather than undefined.
+template <typename T>
+class SeqlockValue {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqlockValue needs a trivially copyable type");
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+public:
+    void store(const T& value) {
+        uint64_t words[kWords] = {};
+        std::memcpy(words, &value, sizeof(T));
+        uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; i++) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        uint64_t words[kWords];
+        for (;;) {
+            uint64_t before = sequence_.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            for (size_t i = 0; i < kWords; i++) {
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == before) break;
+        }
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    std::atomic<uint64_t> sequence_{0};
+    std::array<std::atomic<uint64_t>, kWords> words_{};
+};
+
+struct LoudnessReading {
+    static constexpr double kSilence = -200.0;   // no measurement / below every gate
+
+    double momentary = kSilence;      // LUFS, 400 ms
+    double shortTerm = kSilence;      // LUFS, 3 s
+    double integrated = kSilence;     // LUFS, gated, since reset
+    double momentaryMax = kSilence;
+    double shortTermMax = kSilence;
+    double truePeak = kSilence;       // dBTP, max since reset
+    double samplePeak = kSilence;     // dBFS, max since reset
+    double seconds = 0;               // audio measured since reset
+};
+
+// K-weighting (pre-filter shelf + RLB high-pass) and true-peak oversampling
+// for up to kMaxChannels channels. Filters run channel-interleaved: each
+// sample step is one short loop across channels over structure-of-arrays
+// state, and each oversampled phase is a dot product over contiguous
+// history, so both vectorise. Not thread-safe; one worker feeds it.
+class LoudnessMeter {
+public:
+    static constexpr size_t kMaxChannels = 8;
+    static constexpr size_t kTapsPerPhase = 12;
+    static constexpr double kAbsoluteGate = -70.0;
+    static constexpr double kHistogramTop = 5.0;
+    static constexpr double kHistogramStep = 0.01;
+    static constexpr size_t kHistogramBins =
+        static_cast<size_t>((kHistogramTop - kAbsoluteGate) / kHistogramStep) + 1;
+
+    LoudnessMeter(uint32_t sampleRate, size_t channels)
+        : sampleRate_(sampleRate), channels_(std::min(channels, kMaxChannels)),
+          subBlockFrames_(sampleRate / 10), histogram_(kHistogramBins, 0) {
+        designKWeighting();
+        designOversampler();
+        reset();
+    }
+
+    size_t channels() const { return channels_; }
+    unsigned oversampling() const { return factor_; }
+
+    void reset() {
+        std::fill(std::begin(s1_), std::end(s1_), 0.0);
+        std::fill(std::begin(s2_), std::end(s2_), 0.0);
+        std::fill(std::begin(t1_), std::end(t1_), 0.0);
+        std::fill(std::begin(t2_), std::end(t2_), 0.0);
+        std::fill(history_.begin(), history_.end(), 0.0f);
+        std::fill(histogram_.begin(), histogram_.end(), 0);
+        subBlocks_.fill(0.0);
+        subBlockCount_ = 0;
+        subBlockSum_ = 0;
+        subBlockFill_ = 0;
+        head_ = 0;
+        framesMeasured_ = 0;
+        reading_ = LoudnessReading();
+        truePeakLinear_ = 0;
+        samplePeakLinear_ = 0;
+    }
+
+    // channels[c] points at frames samples of channel c
+    void process(const float* const* channels, size_t frames) {
+        size_t taps = kTapsPerPhase;
+        for (size_t i = 0; i < frames; i++) {
+            double energy = 0;
+            for (size_t c = 0; c < channels_; c++) {
+                double x = channels[c][i];
+
+                // Shelf then high-pass, transposed direct form II
+                double y = shelf_.b0 * x + s1_[c];
+                s1_[c] = shelf_.b1 * x - shelf_.a1 * y + s2_[c];
+                s2_[c] = shelf_.b2 * x - shelf_.a2 * y;
+                double z = highPass_.b0 * y + t1_[c];
+                t1_[c] = highPass_.b1 * y - highPass_.a1 * z + t2_[c];
+                t2_[c] = highPass_.b2 * y - highPass_.a2 * z;
+                energy += z * z;
+
+                float* h = history_.data() + c * taps * 2;
+                h[head_] = h[head_ + taps] = static_cast<float>(x);
+                samplePeakLinear_ = std::max(samplePeakLinear_, std::fabs(static_cast<float>(x)));
+            }
+            head_ = head_ + 1 == taps ? 0 : head_ + 1;
+
+            if (factor_ > 1) {
+                for (size_t c = 0; c < channels_; c++) {
+                    const float* window = history_.data() + c * taps * 2 + head_;
+                    for (unsigned phase = 0; phase < factor_; phase++) {
+                        const float* coefficients = phases_.data() + phase * taps;
+                        float acc = 0;
+                        for (size_t t = 0; t < taps; t++) {
+                            acc += coefficients[t] * window[t];
+                        }
+                        truePeakLinear_ = std::max(truePeakLinear_, std::fabs(acc));
+                    }
+                }
+            }
+
+            subBlockSum_ += energy;
+            if (++subBlockFill_ == subBlockFrames_) {
+                closeSubBlock();
+            }
+        }
+        framesMeasured_ += frames;
+        reading_.seconds = static_cast<double>(framesMeasured_) / sampleRate_;
+        reading_.samplePeak = toDb(samplePeakLinear_);
+        reading_.truePeak = toDb(std::max(truePeakLinear_, samplePeakLinear_));
+    }
+
+    const LoudnessReading& reading() const { return reading_; }
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    static double toDb(float linear) {
+        return linear > 0 ? 20.0 * std::log10(linear) : LoudnessReading::kSilence;
+    }
+
+    static double lufs(double meanSquare) {
+        return meanSquare > 0 ? -0.691 + 10.0 * std::log10(meanSquare) : LoudnessReading::kSilence;
+    }
+
+    // BS.1770 analogue prototypes mapped to this sample rate (matches the
+    // published 48 kHz coefficients)
+    void designKWeighting() {
+        const double pi = 3.14159265358979323846;
+        double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+        double k = std::tan(pi * f0 / sampleRate_);
+        double vh = std::pow(10.0, gain / 20.0);
+        double vb = std::pow(vh, 0.4996667741545416);
+        double a0 = 1.0 + k / q + k * k;
+        shelf_ = Biquad{(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0,
+                        (vh - vb * k / q + k * k) / a0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+
+        f0 = 38.13547087602444;
+        q = 0.5003270373238773;
+        k = std::tan(pi * f0 / sampleRate_);
+        a0 = 1.0 + k / q + k * k;
+        highPass_ = Biquad{1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+    }
+
+    // 4x below 96 kHz, 2x below 192 kHz, as BS.1770 Annex 2 suggests.
+    // Windowed-sinc interpolator split into polyphase branches whose taps
+    // are stored reversed so each branch is a forward dot product.
+    void designOversampler() {
+        factor_ = sampleRate_ < 96000 ? 4 : sampleRate_ < 192000 ? 2 : 1;
+        size_t taps = kTapsPerPhase;
+        history_.assign(kMaxChannels * taps * 2, 0.0f);
+        if (factor_ == 1) return;
+
+        const double pi = 3.14159265358979323846;
+        size_t length = taps * factor_;
+        double middle = (length - 1) / 2.0;
+        phases_.assign(length, 0.0f);
+        for (unsigned phase = 0; phase < factor_; phase++) {
+            for (size_t t = 0; t < taps; t++) {
+                size_t n = t * factor_ + phase;
+                double x = (n - middle) / factor_;
+                double sinc = x == 0 ? 1.0 : std::sin(pi * x) / (pi * x);
+                double window = 0.42 - 0.5 * std::cos(2 * pi * (n + 0.5) / length) +
+                                0.08 * std::cos(4 * pi * (n + 0.5) / length);
+                phases_[phase * taps + (taps - 1 - t)] = static_cast<float>(sinc * window);
+            }
+        }
+    }
+
+    // Every 100 ms: momentary/short-term from the last 4/30 sub-blocks and a
+    // 400 ms gating block (75% overlap) into the integrated histogram.
+    void closeSubBlock() {
+        subBlocks_[subBlockCount_ % subBlocks_.size()] = subBlockSum_ / subBlockFrames_;
+        subBlockCount_++;
+        subBlockSum_ = 0;
+        subBlockFill_ = 0;
+
+        if (subBlockCount_ >= 4) {
+            double momentary = lufs(meanOfLast(4));
+            reading_.momentary = momentary;
+            reading_.momentaryMax = std::max(reading_.momentaryMax, momentary);
+            if (momentary >= kAbsoluteGate) {
+                double clipped = std::min(momentary, kHistogramTop);
+                histogram_[static_cast<size_t>(std::lround((clipped - kAbsoluteGate) / kHistogramStep))]++;
+                reading_.integrated = integrated();
+            }
+        }
+        if (subBlockCount_ >= subBlocks_.size()) {
+            double shortTerm = lufs(meanOfLast(subBlocks_.size()));
+            reading_.shortTerm = shortTerm;
+            reading_.shortTermMax = std::max(reading_.shortTermMax, shortTerm);
+        }
+    }
+
+    double meanOfLast(size_t count) const {
+        double sum = 0;
+        for (size_t i = 0; i < count; i++) {
+            sum += subBlocks_[(subBlockCount_ - 1 - i) % subBlocks_.size()];
+        }
+        return sum / count;
+    }
+
+    static double binEnergy(size_t bin) {
+        return std::pow(10.0, (kAbsoluteGate + bin * kHistogramStep + 0.691) / 10.0);
+    }
+
+    // Relative gate at -10 LU below the absolute-gated mean
+    double integrated() const {
+        double sum = 0;
+        uint64_t count = 0;
+        for (size_t bin = 0; bin < histogram_.size(); bin++) {
+            sum += histogram_[bin] * binEnergy(bin);
+            count += histogram_[bin];
+        }
+        if (count == 0) return LoudnessReading::kSilence;
+
+        double relativeGate = lufs(sum / count) - 10.0;
+        size_t first = relativeGate > kAbsoluteGate
+                           ? static_cast<size_t>(std::ceil((relativeGate - kAbsoluteGate) / kHistogramStep))
+                           : 0;
+        sum = 0;
+        count = 0;
+        for (size_t bin = first; bin < histogram_.size(); bin++) {
+            sum += histogram_[bin] * binEnergy(bin);
+            count += histogram_[bin];
+        }
+        return count ? lufs(sum / count) : LoudnessReading::kSilence;
+    }
+
+    uint32_t sampleRate_;
+    size_t channels_;
+    size_t subBlockFrames_;
+    Biquad shelf_{}, highPass_{};
+    double s1_[kMaxChannels], s2_[kMaxChannels], t1_[kMaxChannels], t2_[kMaxChannels];
+
+    unsigned factor_ = 1;
+    std::vector<float> phases_;       // factor_ branches of kTapsPerPhase taps
+    std::vector<float> history_;      // per channel, mirrored
+    size_t head_ = 0;
+    float truePeakLinear_ = 0;
+    float samplePeakLinear_ = 0;
+
+    std::array<double, 30> subBlocks_{};  // mean square per 100 ms, newest last
+    uint64_t subBlockCount_ = 0;
+    double subBlockSum_ = 0;
+    size_t subBlockFill_ = 0;
+    std::vector<uint32_t> histogram_;
+    uint64_t framesMeasured_ = 0;
+    LoudnessReading reading_;
+};
@@ -0,0 +1,162 @@
+// jack-bridge-local/include/midi_trigger.h
+// MIDI program/CC recognition in the process callback
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <semaphore>
+
+extern "C" {
+    #include <jack/jack.h>
+    #include <jack/midiport.h>
+}
+
+#include "rt_processor.h"
+
+// Bounded single-producer/single-consumer queue. Push and pop never block or
+// allocate, so the RT thread can be the producer.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(const T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == Capacity) return false;
+        items_[head & (Capacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return false;
+        item = items_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> items_{};
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+// Wakes a consumer thread when an SpscQueue gains items. post() never
+// blocks, so the RT thread can call it; repeated posts before the consumer
+// wakes collapse into one.
+class WakeSignal {
+public:
+    // RT thread
+    void post() {
+        if (!pending_.exchange(true, std::memory_order_acq_rel)) semaphore_.release();
+    }
+
+    // Consumer thread. Returns false on timeout; drain the queue after a
+    // true return, anything pushed later posts again.
+    bool wait(std::chrono::milliseconds timeout) {
+        if (!semaphore_.try_acquire_for(timeout)) return false;
+        pending_.store(false, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::binary_semaphore semaphore_{0};
+    std::atomic<bool> pending_{false};
+};
+
+// Which messages mean something. Actions are indices the control side
+// resolves; -1 leaves a number unmapped.
+struct MidiMap {
+    static constexpr int16_t kUnmapped = -1;
+
+    int channel = 0;    // 1-16, 0 = any
+    std::array<int16_t, 128> program;
+    std::array<int16_t, 128> cc;    // fires on values >= 64 (footswitch press)
+
+    MidiMap() {
+        program.fill(kUnmapped);
+        cc.fill(kUnmapped);
+    }
+};
+
+struct MidiTriggerEvent {
+    int16_t action = MidiMap::kUnmapped;
+    uint8_t status = 0;
+    uint8_t data1 = 0;
+    uint8_t data2 = 0;
+    jack_time_t receivedUsecs = 0;  // jack_get_time() in the cycle that saw it
+};
+
+// Parses the bridge's MIDI input every period and queues the messages the
+// current map cares about. Everything else is dropped on the RT thread.
+class MidiTrigger : public RtProcessor {
+public:
+    static constexpr size_t kQueueSize = 256;
+
+    // wake is posted whenever an event is queued; it must outlive the trigger
+    MidiTrigger(jack_port_t* port, WakeSignal* wake) : port_(port), wake_(wake) {}
+
+    // Control thread; the previous map may be read until the next
+    // RtProcessorTable::synchronize()
+    const MidiMap* setMap(const MidiMap* map) { return map_.exchange(map); }
+
+    // RT thread
+    void process(jack_nframes_t nframes) override {
+        void* buffer = jack_port_get_buffer(port_, nframes);
+        uint32_t count = jack_midi_get_event_count(buffer);
+        const MidiMap* map = map_.load(std::memory_order_acquire);
+        if (count == 0 || !map) return;
+
+        jack_time_t now = jack_get_time();
+        bool woken = false;
+        for (uint32_t i = 0; i < count; i++) {
+            jack_midi_event_t event;
+            if (jack_midi_event_get(&event, buffer, i) != 0 || event.size < 2) continue;
+
+            uint8_t status = event.buffer[0];
+            int channel = (status & 0x0F) + 1;
+            if (map->channel != 0 && map->channel != channel) continue;
+
+            int16_t action = MidiMap::kUnmapped;
+            if ((status & 0xF0) == 0xC0) {
+                action = map->program[event.buffer[1] & 0x7F];
+            } else if ((status & 0xF0) == 0xB0 && event.size >= 3 && event.buffer[2] >= 64) {
+                action = map->cc[event.buffer[1] & 0x7F];
+            }
+            if (action == MidiMap::kUnmapped) continue;
+
+            MidiTriggerEvent queued;
+            queued.action = action;
+            queued.status = status;
+            queued.data1 = event.buffer[1];
+            queued.data2 = event.size >= 3 ? event.buffer[2] : 0;
+            queued.receivedUsecs = now;
+            if (queue_.push(queued)) {
+                matched_.fetch_add(1, std::memory_order_relaxed);
+                woken = true;
+            } else {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (woken) wake_->post();
+    }
+
+    // Single consumer thread
+    bool pop(MidiTriggerEvent& event) { return queue_.pop(event); }
+
+    uint64_t matched() const { return matched_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    jack_port_t* port_;
+    WakeSignal* wake_;
+    std::atomic<const MidiMap*> map_{nullptr};
+    SpscQueue<MidiTriggerEvent, kQueueSize> queue_;
+    std::atomic<uint64_t> matched_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
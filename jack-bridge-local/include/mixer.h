@@ -0,0 +1,221 @@
+// jack-bridge-local/include/mixer.h
+// Crosspoint mixer with sample-accurate MIDI control
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+    #include <jack/jack.h>
+    #include <jack/midiport.h>
+}
+
+#include "midi_trigger.h"
+#include "rt_processor.h"
+
+struct MixerCommand {
+    enum Type : uint8_t { SetGain, SetMute, ToggleMute };
+
+    Type type = SetGain;
+    uint8_t output = 0;
+    uint8_t input = 0;
+    float value = 0.0f;     // linear gain, or 0/1 for SetMute
+};
+
+struct MixerBinding {
+    enum Target : uint8_t { None, Gain, Mute };
+
+    Target target = None;
+    uint8_t channel = 0;    // 1-16, 0 = any
+    uint8_t output = 0;
+    uint8_t input = 0;
+};
+
+using MixerBindings = std::array<MixerBinding, 128>;   // by CC number
+
+// A CC seen while learning
+struct LearnedCc {
+    uint8_t cc = 0;
+    uint8_t channel = 0;
+};
+
+// Every output is the sum of every input times its crosspoint gain. Changes
+// arrive as MixerCommands: from control threads through a queue drained at
+// the top of each period, and from CCs on the mixer's own MIDI port, which
+// take effect at the exact frame the message carries. A change ramps over
+// kRampFrames so faders do not click.
+class CrosspointMixer : public RtProcessor {
+public:
+    static constexpr size_t kMaxInputs = 16;
+    static constexpr size_t kMaxOutputs = 16;
+    static constexpr uint32_t kRampFrames = 64;
+
+    // learnedWake is posted when learn mode catches a CC; it must outlive the mixer
+    CrosspointMixer(std::vector<jack_port_t*> inputs, std::vector<jack_port_t*> outputs, jack_port_t* midi,
+                    WakeSignal* learnedWake)
+        : inputs_(std::move(inputs)), outputs_(std::move(outputs)), midi_(midi), learnedWake_(learnedWake) {
+        // Input n feeds output n at unity to start with
+        for (size_t o = 0; o < outputs_.size(); o++) {
+            for (size_t i = 0; i < inputs_.size(); i++) {
+                Crosspoint& x = cross(o, i);
+                x.level = x.gain = x.target = (o == i) ? 1.0f : 0.0f;
+                levelMirror_[o * kMaxInputs + i].store(x.level, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t inputs() const { return inputs_.size(); }
+    size_t outputs() const { return outputs_.size(); }
+
+    // Single control producer
+    bool post(const MixerCommand& command) { return commands_.push(command); }
+
+    // Control thread; the previous table may be read until the next
+    // RtProcessorTable::synchronize()
+    const MixerBindings* setBindings(const MixerBindings* bindings) { return bindings_.exchange(bindings); }
+
+    // The next CC on the MIDI port is reported through learned() instead of
+    // being applied
+    void learn(bool armed) { learning_.store(armed); }
+    bool learned(LearnedCc& cc) { return learned_.pop(cc); }
+
+    // Latest level and mute of a crosspoint as the RT thread applied them
+    float level(size_t output, size_t input) const {
+        return levelMirror_[output * kMaxInputs + input].load(std::memory_order_relaxed);
+    }
+    bool muted(size_t output, size_t input) const {
+        return muteMirror_[output * kMaxInputs + input].load(std::memory_order_relaxed);
+    }
+
+    // CC value to gain: 0 is off, 1-127 spans -60 to +6 dB
+    static float ccToGain(uint8_t value) {
+        if (value == 0) return 0.0f;
+        return static_cast<float>(std::pow(10.0, (-60.0 + 66.0 * value / 127.0) / 20.0));
+    }
+
+    // RT thread
+    void process(jack_nframes_t nframes) override {
+        for (size_t o = 0; o < outputs_.size(); o++) {
+            out_[o] = static_cast<float*>(jack_port_get_buffer(outputs_[o], nframes));
+            std::memset(out_[o], 0, nframes * sizeof(float));
+        }
+        for (size_t i = 0; i < inputs_.size(); i++) {
+            in_[i] = static_cast<const float*>(jack_port_get_buffer(inputs_[i], nframes));
+        }
+
+        MixerCommand command;
+        while (commands_.pop(command)) {
+            apply(command);
+        }
+
+        jack_nframes_t rendered = 0;
+        void* midiBuffer = midi_ ? jack_port_get_buffer(midi_, nframes) : nullptr;
+        uint32_t events = midiBuffer ? jack_midi_get_event_count(midiBuffer) : 0;
+        const MixerBindings* bindings = bindings_.load(std::memory_order_acquire);
+        for (uint32_t e = 0; e < events; e++) {
+            jack_midi_event_t event;
+            if (jack_midi_event_get(&event, midiBuffer, e) != 0 || event.size < 3) continue;
+            if ((event.buffer[0] & 0xF0) != 0xB0) continue;
+
+            uint8_t cc = event.buffer[1] & 0x7F;
+            uint8_t channel = (event.buffer[0] & 0x0F) + 1;
+            if (learning_.load(std::memory_order_relaxed)) {
+                learning_.store(false, std::memory_order_relaxed);
+                if (learned_.push(LearnedCc{cc, channel})) learnedWake_->post();
+                continue;
+            }
+            if (!bindings) continue;
+            const MixerBinding& binding = (*bindings)[cc];
+            if (binding.target == MixerBinding::None || (binding.channel != 0 && binding.channel != channel)) continue;
+
+            jack_nframes_t at = std::min(event.time, nframes);
+            render(rendered, at);
+            rendered = at;
+
+            command.output = binding.output;
+            command.input = binding.input;
+            if (binding.target == MixerBinding::Gain) {
+                command.type = MixerCommand::SetGain;
+                command.value = ccToGain(event.buffer[2]);
+            } else if (event.buffer[2] >= 64) {
+                command.type = MixerCommand::ToggleMute;
+            } else {
+                continue;
+            }
+            apply(command);
+        }
+        render(rendered, nframes);
+    }
+
+private:
+    struct Crosspoint {
+        float level = 0.0f;     // set gain, kept while muted
+        bool muted = false;
+        float gain = 0.0f;      // being applied
+        float target = 0.0f;
+        float step = 0.0f;
+        uint32_t rampLeft = 0;
+    };
+
+    Crosspoint& cross(size_t output, size_t input) { return matrix_[output * kMaxInputs + input]; }
+
+    void apply(const MixerCommand& command) {
+        if (command.output >= outputs_.size() || command.input >= inputs_.size()) return;
+        Crosspoint& x = cross(command.output, command.input);
+        switch (command.type) {
+        case MixerCommand::SetGain: x.level = command.value; break;
+        case MixerCommand::SetMute: x.muted = command.value != 0.0f; break;
+        case MixerCommand::ToggleMute: x.muted = !x.muted; break;
+        }
+        x.target = x.muted ? 0.0f : x.level;
+        x.step = (x.target - x.gain) / kRampFrames;
+        x.rampLeft = kRampFrames;
+
+        size_t index = command.output * kMaxInputs + command.input;
+        levelMirror_[index].store(x.level, std::memory_order_relaxed);
+        muteMirror_[index].store(x.muted, std::memory_order_relaxed);
+    }
+
+    // Mixes frames [from, to) with the crosspoint gains as they stand
+    void render(jack_nframes_t from, jack_nframes_t to) {
+        for (size_t o = 0; o < outputs_.size(); o++) {
+            float* out = out_[o];
+            for (size_t i = 0; i < inputs_.size(); i++) {
+                Crosspoint& x = cross(o, i);
+                if (x.rampLeft == 0 && x.gain == 0.0f) continue;
+
+                const float* in = in_[i];
+                jack_nframes_t f = from;
+                for (; f < to && x.rampLeft > 0; f++) {
+                    out[f] += x.gain * in[f];
+                    x.gain += x.step;
+                    if (--x.rampLeft == 0) x.gain = x.target;
+                }
+                float gain = x.gain;
+                for (; f < to; f++) {
+                    out[f] += gain * in[f];
+                }
+            }
+        }
+    }
+
+    std::vector<jack_port_t*> inputs_;
+    std::vector<jack_port_t*> outputs_;
+    jack_port_t* midi_;
+    WakeSignal* learnedWake_;
+    std::array<Crosspoint, kMaxInputs * kMaxOutputs> matrix_{};
+    std::array<const float*, kMaxInputs> in_{};
+    std::array<float*, kMaxOutputs> out_{};
+    SpscQueue<MixerCommand, 256> commands_;
+    SpscQueue<LearnedCc, 16> learned_;
+    std::atomic<const MixerBindings*> bindings_{nullptr};
+    std::atomic<bool> learning_{false};
+    std::array<std::atomic<float>, kMaxInputs * kMaxOutputs> levelMirror_{};
+    std::array<std::atomic<bool>, kMaxInputs * kMaxOutputs> muteMirror_{};
+};
@@ -0,0 +1,180 @@
+// jack-bridge-local/include/monitor_tap.h
+// Shared capture tap for live monitoring streams
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+    #include <jack/jack.h>
+}
+
+#include "rt_processor.h"
+
+// Every monitored port owns a slot: a single-channel ring the process callback
+// overwrites in place. All slots advance on one frame clock, so a stream that
+// mixes several ports reads them at the same position. Readers keep their own
+// cursor and copy optimistically; being lapped means the reader was too slow,
+// never that the RT thread waited.
+class MonitorTap : public RtProcessor {
+public:
+    static constexpr size_t kMaxSlots = 16;
+    static constexpr jack_nframes_t kMaxPeriodFrames = 8192;
+    static constexpr double kRingSeconds = 2.0;
+
+    explicit MonitorTap(uint32_t sampleRate)
+        : sampleRate_(sampleRate),
+          capacityFrames_(static_cast<size_t>(sampleRate * kRingSeconds) + 2 * kMaxPeriodFrames),
+          rings_(kMaxSlots * capacityFrames_, 0.0f) {}
+
+    // Control thread; nullptr stops feeding the slot
+    void setPort(size_t slot, jack_port_t* port) { ports_[slot].store(port); }
+
+    // RT thread
+    void process(jack_nframes_t nframes) override {
+        if (nframes > kMaxPeriodFrames) return;
+
+        uint64_t frame = writeFrame_.load(std::memory_order_relaxed);
+        size_t pos = static_cast<size_t>(frame % capacityFrames_);
+        size_t first = std::min<size_t>(nframes, capacityFrames_ - pos);
+        for (size_t slot = 0; slot < kMaxSlots; slot++) {
+            jack_port_t* port = ports_[slot].load(std::memory_order_acquire);
+            if (!port) continue;
+
+            const float* in = static_cast<const float*>(jack_port_get_buffer(port, nframes));
+            float* ring = rings_.data() + slot * capacityFrames_;
+            std::memcpy(ring + pos, in, first * sizeof(float));
+            std::memcpy(ring, in + first, (nframes - first) * sizeof(float));
+        }
+        writeFrame_.store(frame + nframes, std::memory_order_release);
+    }
+
+    uint32_t sampleRate() const { return sampleRate_; }
+    uint64_t writeFrame() const { return writeFrame_.load(std::memory_order_acquire); }
+
+    // Furthest a reader may trail the clock and still read intact frames
+    uint64_t readableFrames() const { return capacityFrames_ - 2 * kMaxPeriodFrames; }
+
+    // Copies [from, from + count) of a slot; false if the RT thread
+    // overwrote any of it during the copy.
+    bool read(size_t slot, uint64_t from, size_t count, float* dst) const {
+        const float* ring = rings_.data() + slot * capacityFrames_;
+        size_t pos = static_cast<size_t>(from % capacityFrames_);
+        size_t first = std::min(count, capacityFrames_ - pos);
+        std::memcpy(dst, ring + pos, first * sizeof(float));
+        std::memcpy(dst + first, ring, (count - first) * sizeof(float));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return writeFrame_.load(std::memory_order_acquire) + kMaxPeriodFrames <= from + capacityFrames_;
+    }
+
+    // Set when the JACK client behind the slots went away
+    void close() { closed_.store(true); }
+    bool closed() const { return closed_.load(); }
+
+private:
+    uint32_t sampleRate_;
+    size_t capacityFrames_;
+    std::vector<float> rings_;   // slot-major
+    std::array<std::atomic<jack_port_t*>, kMaxSlots> ports_{};
+    std::atomic<uint64_t> writeFrame_{0};
+    std::atomic<bool> closed_{false};
+};
+
+// Integer-factor decimator: Blackman-windowed sinc low-pass at 90% of the
+// new Nyquist, evaluated only at the kept output samples. Factor 1 passes
+// samples through untouched.
+class Decimator {
+public:
+    static constexpr unsigned kTapsPerFactor = 24;
+
+    Decimator(unsigned factor, size_t channels) : factor_(factor), channels_(channels) {
+        if (factor_ <= 1) return;
+
+        size_t taps = kTapsPerFactor * factor_ + 1;
+        double cutoff = 0.45 / factor_;   // cycles per input sample
+        double middle = (taps - 1) / 2.0;
+        const double pi = 3.14159265358979323846;
+        coefficients_.resize(taps);
+        double sum = 0;
+        for (size_t n = 0; n < taps; n++) {
+            double x = n - middle;
+            double sinc = x == 0 ? 2 * cutoff : std::sin(2 * pi * cutoff * x) / (pi * x);
+            double window = 0.42 - 0.5 * std::cos(2 * pi * n / (taps - 1)) + 0.08 * std::cos(4 * pi * n / (taps - 1));
+            coefficients_[n] = static_cast<float>(sinc * window);
+            sum += coefficients_[n];
+        }
+        for (float& c : coefficients_) c = static_cast<float>(c / sum);
+        history_.assign(channels_ * taps * 2, 0.0f);
+    }
+
+    unsigned factor() const { return factor_; }
+
+    // Interleaved in, interleaved out; out must hold frames / factor + 1
+    // frames. Returns frames written.
+    size_t process(const float* in, size_t frames, float* out) {
+        if (factor_ <= 1) {
+            std::memcpy(out, in, frames * channels_ * sizeof(float));
+            return frames;
+        }
+
+        size_t taps = coefficients_.size();
+        size_t produced = 0;
+        for (size_t i = 0; i < frames; i++) {
+            // Each channel's history is mirrored so a window is always contiguous
+            for (size_t ch = 0; ch < channels_; ch++) {
+                float* h = history_.data() + ch * taps * 2;
+                h[head_] = h[head_ + taps] = in[i * channels_ + ch];
+            }
+            head_ = head_ + 1 == taps ? 0 : head_ + 1;
+
+            if (++phase_ < factor_) continue;
+            phase_ = 0;
+            for (size_t ch = 0; ch < channels_; ch++) {
+                const float* window = history_.data() + ch * taps * 2 + head_;
+                float acc = 0;
+                for (size_t t = 0; t < taps; t++) {
+                    acc += coefficients_[t] * window[t];
+                }
+                out[produced * channels_ + ch] = acc;
+            }
+            produced++;
+        }
+        return produced;
+    }
+
+private:
+    unsigned factor_;
+    size_t channels_;
+    std::vector<float> coefficients_;
+    std::vector<float> history_;
+    size_t head_ = 0;
+    unsigned phase_ = 0;
+};
+
+// 44-byte WAV header for a stream of unknown length (sizes set to the maximum)
+inline void streamingWavHeader(char* h, uint32_t sampleRate, uint16_t channels, bool floatSamples) {
+    auto put16 = [](char* p, uint16_t v) { p[0] = static_cast<char>(v & 0xFF); p[1] = static_cast<char>(v >> 8); };
+    auto put32 = [](char* p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = static_cast<char>((v >> (8 * i)) & 0xFF); };
+
+    uint16_t bits = floatSamples ? 32 : 16;
+    uint16_t blockAlign = static_cast<uint16_t>(channels * bits / 8);
+    std::memcpy(h, "RIFF", 4);
+    put32(h + 4, UINT32_MAX);
+    std::memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 16);
+    put16(h + 20, floatSamples ? 3 : 1);
+    put16(h + 22, channels);
+    put32(h + 24, sampleRate);
+    put32(h + 28, sampleRate * blockAlign);
+    put16(h + 32, blockAlign);
+    put16(h + 34, bits);
+    std::memcpy(h + 36, "data", 4);
+    put32(h + 40, UINT32_MAX);
+}
@@ -0,0 +1,191 @@
+// jack-bridge-local/include/mqtt_packet.h
+// MQTT 3.1.1 packet encoding and framing (no I/O)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mqtt {
+
+enum PacketType : uint8_t {
+    Connect = 1,
+    ConnAck = 2,
+    Publish = 3,
+    PubAck = 4,
+    Subscribe = 8,
+    SubAck = 9,
+    PingReq = 12,
+    PingResp = 13,
+    Disconnect = 14,
+};
+
+struct Packet {
+    PacketType type = Connect;
+    uint8_t flags = 0;
+    std::string body;   // everything after the fixed header
+};
+
+struct Message {
+    std::string topic;
+    std::string payload;
+    int qos = 0;
+    bool retain = false;
+    uint16_t packetId = 0;
+};
+
+inline void appendRemainingLength(std::string& out, size_t length) {
+    do {
+        uint8_t byte = length % 128;
+        length /= 128;
+        if (length > 0) byte |= 0x80;
+        out.push_back(static_cast<char>(byte));
+    } while (length > 0);
+}
+
+inline void appendU16(std::string& out, uint16_t value) {
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value & 0xFF));
+}
+
+inline void appendString(std::string& out, std::string_view text) {
+    appendU16(out, static_cast<uint16_t>(text.length()));
+    out.append(text);
+}
+
+inline std::string frame(uint8_t firstByte, const std::string& body) {
+    std::string out;
+    out.reserve(body.length() + 5);
+    out.push_back(static_cast<char>(firstByte));
+    appendRemainingLength(out, body.length());
+    out += body;
+    return out;
+}
+
+// Clean session; the will is published retained at QoS 1 if the broker
+// loses the connection
+inline std::string connect(std::string_view clientId, uint16_t keepAliveSeconds,
+                           std::string_view username, std::string_view password,
+                           std::string_view willTopic, std::string_view willPayload) {
+    std::string body;
+    appendString(body, "MQTT");
+    body.push_back(4);  // protocol level 3.1.1
+    uint8_t flags = 0x02;
+    if (!willTopic.empty()) flags |= 0x04 | 0x08 | 0x20;
+    if (!username.empty()) flags |= 0x80;
+    if (!username.empty() && !password.empty()) flags |= 0x40;
+    body.push_back(static_cast<char>(flags));
+    appendU16(body, keepAliveSeconds);
+    appendString(body, clientId);
+    if (!willTopic.empty()) {
+        appendString(body, willTopic);
+        appendString(body, willPayload);
+    }
+    if (!username.empty()) {
+        appendString(body, username);
+        if (!password.empty()) appendString(body, password);
+    }
+    return frame(Connect << 4, body);
+}
+
+inline std::string subscribe(uint16_t packetId, const std::vector<std::string>& filters, uint8_t qos) {
+    std::string body;
+    appendU16(body, packetId);
+    for (const std::string& filter : filters) {
+        appendString(body, filter);
+        body.push_back(static_cast<char>(qos));
+    }
+    return frame((Subscribe << 4) | 0x02, body);
+}
+
+inline std::string publish(std::string_view topic, std::string_view payload, int qos, bool retain,
+                           uint16_t packetId = 0) {
+    std::string body;
+    appendString(body, topic);
+    if (qos > 0) appendU16(body, packetId);
+    body.append(payload);
+    return frame(static_cast<uint8_t>((Publish << 4) | (qos << 1) | (retain ? 1 : 0)), body);
+}
+
+inline std::string pubAck(uint16_t packetId) {
+    std::string body;
+    appendU16(body, packetId);
+    return frame(PubAck << 4, body);
+}
+
+inline std::string pingReq() { return frame(PingReq << 4, std::string()); }
+inline std::string disconnect() { return frame(Disconnect << 4, std::string()); }
+
+inline bool parsePublish(const Packet& packet, Message& message) {
+    const std::string& b = packet.body;
+    if (b.length() < 2) return false;
+    size_t topicLength = (static_cast<uint8_t>(b[0]) << 8) | static_cast<uint8_t>(b[1]);
+    size_t pos = 2 + topicLength;
+    message.qos = (packet.flags >> 1) & 0x03;
+    message.retain = (packet.flags & 0x01) != 0;
+    if (pos > b.length() || message.qos == 3) return false;
+    message.topic.assign(b, 2, topicLength);
+    message.packetId = 0;
+    if (message.qos > 0) {
+        if (pos + 2 > b.length()) return false;
+        message.packetId = static_cast<uint16_t>((static_cast<uint8_t>(b[pos]) << 8) | static_cast<uint8_t>(b[pos + 1]));
+        pos += 2;
+    }
+    message.payload.assign(b, pos, std::string::npos);
+    return true;
+}
+
+// Splits a byte stream into packets. Bytes are appended as they arrive and
+// complete packets taken off the front.
+class PacketReader {
+public:
+    explicit PacketReader(size_t maxPacket = 1 << 20) : maxPacket_(maxPacket) {}
+
+    void feed(const char* data, size_t length) { buffer_.append(data, length); }
+
+    // False when no complete packet is buffered. Sets malformed() when the
+    // stream cannot be a valid MQTT stream; the connection should be dropped.
+    bool next(Packet& packet) {
+        if (buffer_.length() < 2) return false;
+        size_t length = 0, multiplier = 1, pos = 1;
+        for (;;) {
+            if (pos >= buffer_.length()) return false;
+            uint8_t byte = static_cast<uint8_t>(buffer_[pos++]);
+            length += (byte & 0x7F) * multiplier;
+            if (!(byte & 0x80)) break;
+            multiplier *= 128;
+            if (pos > 4) {
+                malformed_ = true;
+                return false;
+            }
+        }
+        if (length > maxPacket_) {
+            malformed_ = true;
+            return false;
+        }
+        if (buffer_.length() < pos + length) return false;
+
+        uint8_t first = static_cast<uint8_t>(buffer_[0]);
+        packet.type = static_cast<PacketType>(first >> 4);
+        packet.flags = first & 0x0F;
+        packet.body.assign(buffer_, pos, length);
+        buffer_.erase(0, pos + length);
+        return true;
+    }
+
+    bool malformed() const { return malformed_; }
+    void reset() {
+        buffer_.clear();
+        malformed_ = false;
+    }
+
+private:
+    std::string buffer_;
+    size_t maxPacket_;
+    bool malformed_ = false;
+};
+
+}  // namespace mqtt
@@ -0,0 +1,70 @@
+// jack-bridge-local/include/port_name.h
+// Fixed-capacity JACK port name stored inline
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <type_traits>
+
+// JACK bounds full port names ("client:port") by jack_port_name_size(),
+// which is 320 + 1 on current JACK2 builds. PortName keeps the name inline
+// in six cache lines so snapshots can be copied and stored without touching
+// the heap. JackManager::initialize() warns if the server reports a larger
+// limit; longer names are rejected by assign().
+class alignas(64) PortName {
+public:
+    static constexpr size_t kStorageBytes = 384;
+    static constexpr size_t kMaxLength = kStorageBytes - sizeof(uint16_t) - 1;
+
+    PortName() : data_{0}, length_(0) {}
+
+    explicit PortName(std::string_view name) : PortName() {
+        assign(name);
+    }
+
+    // Returns false (and leaves the name empty) if it does not fit
+    bool assign(std::string_view name) {
+        if (name.length() > kMaxLength) {
+            clear();
+            return false;
+        }
+        std::memcpy(data_, name.data(), name.length());
+        data_[name.length()] = '\0';
+        length_ = static_cast<uint16_t>(name.length());
+        return true;
+    }
+
+    void clear() {
+        data_[0] = '\0';
+        length_ = 0;
+    }
+
+    const char* c_str() const { return data_; }
+    std::string_view view() const { return std::string_view(data_, length_); }
+    size_t size() const { return length_; }
+    bool empty() const { return length_ == 0; }
+
+    friend bool operator==(const PortName& a, const PortName& b) { return a.view() == b.view(); }
+    friend bool operator!=(const PortName& a, const PortName& b) { return !(a == b); }
+    friend bool operator<(const PortName& a, const PortName& b) { return a.view() < b.view(); }
+
+private:
+    char data_[kMaxLength + 1];
+    uint16_t length_;
+};
+
+static_assert(sizeof(PortName) == PortName::kStorageBytes, "PortName must stay cache-line sized");
+static_assert(std::is_trivially_copyable_v<PortName>, "PortName must be trivially copyable");
+
+namespace std {
+    template <>
+    struct hash<PortName> {
+        size_t operator()(const PortName& name) const noexcept {
+            return std::hash<std::string_view>()(name.view());
+        }
+    };
+}
@@ -0,0 +1,144 @@
+// jack-bridge-local/include/recorder.h
+// Captures bridge input ports to disk without blocking the RT thread
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+    #include <jack/jack.h>
+    #include <jack/ringbuffer.h>
+}
+
+#include "rt_processor.h"
+#include "wav_file.h"
+
+// The process callback interleaves the capture ports into a jack_ringbuffer;
+// a writer thread drains it into a WavFileWriter. If the writer falls behind
+// the RT side drops whole periods and counts them as overruns instead of
+// waiting.
+class Recording : public RtProcessor {
+public:
+    static constexpr jack_nframes_t kMaxPeriodFrames = 8192;
+    static constexpr double kRingSeconds = 4.0;
+
+    Recording(std::vector<jack_port_t*> ports, uint32_t sampleRate)
+        : ports_(std::move(ports)),
+          sampleRate_(sampleRate),
+          scratch_(static_cast<size_t>(kMaxPeriodFrames) * ports_.size()) {
+        size_t ringBytes = static_cast<size_t>(sampleRate * kRingSeconds) * frameBytes();
+        ring_ = jack_ringbuffer_create(ringBytes);
+        jack_ringbuffer_mlock(ring_);
+        drain_.resize(static_cast<size_t>(sampleRate / 10) * ports_.size());
+    }
+
+    ~Recording() override {
+        stop();
+        jack_ringbuffer_free(ring_);
+    }
+
+    bool start(const std::string& path) {
+        path_ = path;
+        if (!file_.open(path, sampleRate_, static_cast<uint16_t>(ports_.size()))) {
+            return false;
+        }
+        running_ = true;
+        writer_ = std::thread(&Recording::writerLoop, this);
+        return true;
+    }
+
+    // Drains what the RT thread already queued, then finalizes the file
+    void stop() {
+        if (!running_.exchange(false)) return;
+        if (writer_.joinable()) {
+            writer_.join();
+        }
+        file_.close();
+    }
+
+    // RT thread
+    void process(jack_nframes_t nframes) override {
+        size_t channels = ports_.size();
+        size_t bytes = static_cast<size_t>(nframes) * frameBytes();
+
+        if (nframes > kMaxPeriodFrames || jack_ringbuffer_write_space(ring_) < bytes) {
+            overrunFrames_.fetch_add(nframes, std::memory_order_relaxed);
+            overruns_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        for (size_t ch = 0; ch < channels; ch++) {
+            const float* in = static_cast<const float*>(jack_port_get_buffer(ports_[ch], nframes));
+            float* out = scratch_.data() + ch;
+            for (jack_nframes_t i = 0; i < nframes; i++) {
+                out[i * channels] = in[i];
+            }
+        }
+        jack_ringbuffer_write(ring_, reinterpret_cast<const char*>(scratch_.data()), bytes);
+        capturedFrames_.fetch_add(nframes, std::memory_order_relaxed);
+    }
+
+    const std::string& path() const { return path_; }
+    size_t channels() const { return ports_.size(); }
+    uint32_t sampleRate() const { return sampleRate_; }
+    bool running() const { return running_; }
+    bool writeFailed() const { return writeFailed_; }
+    uint64_t capturedFrames() const { return capturedFrames_.load(std::memory_order_relaxed); }
+    uint64_t writtenFrames() const { return writtenFrames_.load(std::memory_order_relaxed); }
+    uint64_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+    uint64_t overrunFrames() const { return overrunFrames_.load(std::memory_order_relaxed); }
+
+    // Fill level of the RT->writer ring, 0..1
+    double ringFill() const {
+        return static_cast<double>(jack_ringbuffer_read_space(ring_)) / static_cast<double>(ring_->size);
+    }
+
+private:
+    size_t frameBytes() const { return ports_.size() * sizeof(float); }
+
+    void writerLoop() {
+        while (running_) {
+            drainRing();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        drainRing();
+    }
+
+    void drainRing() {
+        size_t chunkBytes = drain_.size() * sizeof(float);
+        for (;;) {
+            size_t available = jack_ringbuffer_read_space(ring_);
+            available -= available % frameBytes();
+            if (available == 0) break;
+
+            size_t bytes = available < chunkBytes ? available : chunkBytes;
+            jack_ringbuffer_read(ring_, reinterpret_cast<char*>(drain_.data()), bytes);
+            size_t frames = bytes / frameBytes();
+            file_.write(drain_.data(), frames);
+            writtenFrames_.fetch_add(frames, std::memory_order_relaxed);
+        }
+        if (file_.failed()) {
+            writeFailed_ = true;
+        }
+    }
+
+    std::vector<jack_port_t*> ports_;
+    uint32_t sampleRate_;
+    std::vector<float> scratch_;   // RT interleave buffer
+    std::vector<float> drain_;     // writer-side copy buffer
+    jack_ringbuffer_t* ring_ = nullptr;
+    WavFileWriter file_;
+    std::string path_;
+    std::thread writer_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> writeFailed_{false};
+    std::atomic<uint64_t> capturedFrames_{0};
+    std::atomic<uint64_t> writtenFrames_{0};
+    std::atomic<uint64_t> overruns_{0};
+    std::atomic<uint64_t> overrunFrames_{0};
+};
@@ -0,0 +1,375 @@
+// jack-bridge-local/include/replay_buffer.h
+// Retroactive capture: the last N seconds of a set of inputs, kept in memory
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+    #include <jack/jack.h>
+}
+
+#include "lossless_codec.h"
+#include "rt_processor.h"
+#include "wav_file.h"
+
+// The process callback copies each period into a preallocated interleaved
+// ring and publishes the new frame count; it never waits and never fails.
+//
+// Uncompressed, that ring is the whole history. Compressed, the ring is a
+// short staging area: a background thread codes kBlockFrames at a time with
+// LosslessCodec into a fixed byte store, evicting the oldest blocks when the
+// store or the window is full. Either way every buffer is sized up front, so
+// memory use does not change while armed.
+//
+// Readers copy out of the ring optimistically and then check that the RT
+// thread has not lapped them in the meantime (a seqlock on the frame count).
+class ReplayBuffer : public RtProcessor {
+public:
+    static constexpr jack_nframes_t kMaxPeriodFrames = 8192;
+    static constexpr uint32_t kBlockFrames = 4096;
+    static constexpr double kStagingSeconds = 20.0;
+
+    struct Stats {
+        size_t channels = 0;
+        uint32_t sampleRate = 0;
+        bool compressed = false;
+        double windowSeconds = 0;
+        double retainedSeconds = 0;
+        size_t memoryBytes = 0;     // everything allocated at construction
+        size_t storeUsedBytes = 0;  // compressed bytes currently held
+        uint64_t storeRawBytes = 0; // the same audio as raw float
+        uint64_t capturedFrames = 0;
+        uint64_t lostFrames = 0;    // compressor fell behind the staging ring
+    };
+
+    // storeBytes only applies when compress is set
+    ReplayBuffer(std::vector<jack_port_t*> ports, uint32_t sampleRate, double seconds,
+                 bool compress, size_t storeBytes)
+        : ports_(std::move(ports)),
+          sampleRate_(sampleRate),
+          compress_(compress),
+          windowFrames_(static_cast<uint64_t>(seconds * sampleRate)) {
+        double ringSeconds = compress ? std::min(seconds, kStagingSeconds) : seconds;
+        capacityFrames_ = static_cast<uint64_t>(ringSeconds * sampleRate) + 2 * kMaxPeriodFrames;
+        ring_.assign(capacityFrames_ * channels(), 0.0f);
+
+        if (compress_) {
+            store_.assign(storeBytes, 0);
+            blocks_.resize(windowFrames_ / kBlockFrames + 2);
+            blockSamples_.resize(static_cast<size_t>(kBlockFrames) * channels());
+            encoded_.resize(channels() * (sizeof(uint32_t) + LosslessCodec::maxEncodedBytes(kBlockFrames)));
+            codec_ = std::make_unique<LosslessCodec>(kBlockFrames);
+        }
+    }
+
+    ~ReplayBuffer() override {
+        stop();
+    }
+
+    // Smallest store that can hold a handful of worst-case (raw) blocks
+    static size_t minimumStoreBytes(size_t channels) {
+        return 8 * channels * (sizeof(uint32_t) + LosslessCodec::maxEncodedBytes(kBlockFrames));
+    }
+
+    void start() {
+        if (compress_ && !running_.exchange(true)) {
+            compressor_ = std::thread(&ReplayBuffer::compressorLoop, this);
+        }
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) return;
+        if (compressor_.joinable()) {
+            compressor_.join();
+        }
+    }
+
+    // RT thread
+    void process(jack_nframes_t nframes) override {
+        if (nframes > kMaxPeriodFrames) return;
+
+        size_t channels = ports_.size();
+        uint64_t frame = writeFrame_.load(std::memory_order_relaxed);
+        size_t pos = static_cast<size_t>(frame % capacityFrames_);
+        for (size_t ch = 0; ch < channels; ch++) {
+            const float* in = static_cast<const float*>(jack_port_get_buffer(ports_[ch], nframes));
+            size_t p = pos;
+            for (jack_nframes_t i = 0; i < nframes; i++) {
+                ring_[p * channels + ch] = in[i];
+                if (++p == capacityFrames_) p = 0;
+            }
+        }
+        writeFrame_.store(frame + nframes, std::memory_order_release);
+    }
+
+    size_t channels() const { return ports_.size(); }
+    uint32_t sampleRate() const { return sampleRate_; }
+    bool compressed() const { return compress_; }
+
+    Stats stats() {
+        Stats s;
+        s.channels = channels();
+        s.sampleRate = sampleRate_;
+        s.compressed = compress_;
+        s.windowSeconds = static_cast<double>(windowFrames_) / sampleRate_;
+        s.memoryBytes = ring_.size() * sizeof(float) + store_.size() + blocks_.size() * sizeof(Block) +
+                        blockSamples_.size() * sizeof(float) + encoded_.size();
+        s.capturedFrames = writeFrame_.load(std::memory_order_acquire);
+        s.lostFrames = lostFrames_.load(std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(storeMutex_);
+        uint64_t first = firstFrame(s.capturedFrames);
+        s.retainedSeconds = static_cast<double>(s.capturedFrames - first) / sampleRate_;
+        for (size_t i = 0; i < blockCount_; i++) {
+            const Block& block = blocks_[(blockTail_ + i) % blocks_.size()];
+            s.storeUsedBytes += block.bytes;
+            s.storeRawBytes += static_cast<uint64_t>(block.frames) * channels() * sizeof(float);
+        }
+        return s;
+    }
+
+    // Writes frames [end - seconds, end) to a WAV file, where end lies
+    // offsetSeconds before the newest captured frame. The start is clamped to
+    // the oldest frame still held. Returns false with error set on failure.
+    bool dump(double offsetSeconds, double seconds, const std::string& path,
+              uint64_t& framesWritten, std::string& error) {
+        uint64_t newest = writeFrame_.load(std::memory_order_acquire);
+        uint64_t offset = static_cast<uint64_t>(offsetSeconds * sampleRate_);
+        uint64_t length = static_cast<uint64_t>(seconds * sampleRate_);
+        uint64_t first;
+        {
+            std::lock_guard<std::mutex> lock(storeMutex_);
+            first = firstFrame(newest);
+        }
+        uint64_t end = offset < newest - first ? newest - offset : first;
+        uint64_t begin = length < end - first ? end - length : first;
+        if (begin >= end) {
+            error = "Requested window is not in the buffer";
+            return false;
+        }
+
+        WavFileWriter file;
+        if (!file.open(path, sampleRate_, static_cast<uint16_t>(channels()))) {
+            error = "Cannot open " + path;
+            return false;
+        }
+
+        std::vector<float> chunk(static_cast<size_t>(kBlockFrames) * channels());
+        std::vector<uint8_t> coded;
+        uint64_t frame = begin;
+
+        // Compressed blocks first, then whatever is still only in the ring.
+        // Each block is copied out under the lock but decoded and written
+        // without it, so a slow disk never stalls the compressor.
+        while (frame < end) {
+            Block block;
+            {
+                std::lock_guard<std::mutex> lock(storeMutex_);
+                if (!findBlock(frame, block)) break;
+                coded.assign(store_.begin() + block.offset, store_.begin() + block.offset + block.bytes);
+            }
+            uint64_t blockEnd = block.startFrame + block.frames;
+
+            if (!decodeBlock(block, coded.data(), chunk.data())) {
+                error = "Corrupt replay block";
+                return false;
+            }
+            uint64_t stop = std::min(end, blockEnd);
+            file.write(chunk.data() + (frame - block.startFrame) * channels(), static_cast<size_t>(stop - frame));
+            frame = stop;
+        }
+
+        while (frame < end) {
+            uint64_t count = std::min<uint64_t>(end - frame, kBlockFrames);
+            if (!copyFromRing(frame, count, chunk.data())) {
+                error = "Replay window was overwritten while dumping";
+                file.close();
+                return false;
+            }
+            file.write(chunk.data(), static_cast<size_t>(count));
+            frame += count;
+        }
+
+        framesWritten = file.frames();
+        file.close();
+        if (file.failed()) {
+            error = "Write failed: " + path;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Block {
+        uint64_t startFrame = 0;
+        uint32_t frames = 0;
+        uint32_t offset = 0;    // into store_
+        uint32_t bytes = 0;
+    };
+
+    // Oldest frame a reader may still ask for. The ring keeps two periods
+    // in reserve so a reader never races the write in progress.
+    uint64_t firstFrame(uint64_t newest) const {
+        uint64_t ringFrames = capacityFrames_ - 2 * kMaxPeriodFrames;
+        uint64_t first = newest > ringFrames ? newest - ringFrames : 0;
+        if (compress_ && blockCount_ > 0) {
+            first = std::min(first, blocks_[blockTail_].startFrame);
+        }
+        if (newest - first > windowFrames_) {
+            first = newest - windowFrames_;
+        }
+        return first;
+    }
+
+    // Copies [from, from + count) out of the ring; false if the RT thread
+    // overwrote any of it during the copy.
+    bool copyFromRing(uint64_t from, uint64_t count, float* dst) const {
+        size_t channels = ports_.size();
+        size_t pos = static_cast<size_t>(from % capacityFrames_);
+        size_t first = std::min<size_t>(static_cast<size_t>(count), capacityFrames_ - pos);
+        std::copy_n(ring_.data() + pos * channels, first * channels, dst);
+        std::copy_n(ring_.data(), (count - first) * channels, dst + first * channels);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t newest = writeFrame_.load(std::memory_order_acquire);
+        return newest + kMaxPeriodFrames <= from + capacityFrames_;
+    }
+
+    void compressorLoop() {
+        while (running_) {
+            while (running_ && compressBlock()) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+
+    // Codes the next staged block into the store; false when none is ready
+    bool compressBlock() {
+        uint64_t newest = writeFrame_.load(std::memory_order_acquire);
+        uint64_t oldest = newest + 2 * kMaxPeriodFrames > capacityFrames_
+                              ? newest + 2 * kMaxPeriodFrames - capacityFrames_ : 0;
+        if (encodedFrame_ < oldest) {
+            // Fell a whole staging ring behind; the store is no longer contiguous
+            lostFrames_.fetch_add(oldest - encodedFrame_, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(storeMutex_);
+            blockCount_ = 0;
+            encodedFrame_ = oldest;
+        }
+        if (newest - encodedFrame_ < kBlockFrames) {
+            return false;
+        }
+
+        if (!copyFromRing(encodedFrame_, kBlockFrames, blockSamples_.data())) {
+            return true; // lapped mid-copy; the check above resynchronizes
+        }
+
+        size_t bytes = 0;
+        for (size_t ch = 0; ch < channels(); ch++) {
+            uint8_t* out = encoded_.data() + bytes;
+            uint32_t size = static_cast<uint32_t>(
+                codec_->encode(blockSamples_.data() + ch, channels(), kBlockFrames, out + sizeof(uint32_t)));
+            std::memcpy(out, &size, sizeof(size));
+            bytes += sizeof(uint32_t) + size;
+        }
+
+        std::lock_guard<std::mutex> lock(storeMutex_);
+        appendBlock(encodedFrame_, bytes);
+        encodedFrame_ += kBlockFrames;
+        return true;
+    }
+
+    // Store is a circular byte arena written in block order, so the blocks
+    // that stand in the way of a new one are always the oldest.
+    void appendBlock(uint64_t startFrame, size_t bytes) {
+        size_t offset = storeHead_;
+        if (offset + bytes > store_.size()) {
+            while (blockCount_ > 0 && blocks_[blockTail_].offset >= offset) dropOldest();
+            offset = 0;
+        }
+        while (blockCount_ > 0 && overlaps(blocks_[blockTail_], offset, bytes)) dropOldest();
+        while (blockCount_ > 0 &&
+               (blockCount_ == blocks_.size() ||
+                startFrame + kBlockFrames - blocks_[blockTail_].startFrame > windowFrames_ + kBlockFrames)) {
+            dropOldest();
+        }
+
+        std::memcpy(store_.data() + offset, encoded_.data(), bytes);
+        Block& block = blocks_[(blockTail_ + blockCount_) % blocks_.size()];
+        block.startFrame = startFrame;
+        block.frames = kBlockFrames;
+        block.offset = static_cast<uint32_t>(offset);
+        block.bytes = static_cast<uint32_t>(bytes);
+        blockCount_++;
+        storeHead_ = offset + bytes;
+    }
+
+    static bool overlaps(const Block& block, size_t offset, size_t bytes) {
+        return block.offset < offset + bytes && offset < block.offset + block.bytes;
+    }
+
+    void dropOldest() {
+        blockTail_ = (blockTail_ + 1) % blocks_.size();
+        blockCount_--;
+    }
+
+    // Caller holds storeMutex_. Finds the stored block holding frame.
+    bool findBlock(uint64_t frame, Block& found) const {
+        for (size_t i = 0; i < blockCount_; i++) {
+            const Block& block = blocks_[(blockTail_ + i) % blocks_.size()];
+            if (block.startFrame > frame) break;
+            if (frame < block.startFrame + block.frames) {
+                found = block;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // p holds the block's coded bytes, copied out of store_
+    bool decodeBlock(const Block& block, const uint8_t* p, float* dst) const {
+        const uint8_t* end = p + block.bytes;
+        for (size_t ch = 0; ch < channels(); ch++) {
+            uint32_t size;
+            if (end - p < static_cast<ptrdiff_t>(sizeof(size))) return false;
+            std::memcpy(&size, p, sizeof(size));
+            p += sizeof(size);
+            if (end - p < static_cast<ptrdiff_t>(size)) return false;
+            if (!LosslessCodec::decode(p, size, block.frames, dst + ch, channels())) return false;
+            p += size;
+        }
+        return true;
+    }
+
+    std::vector<jack_port_t*> ports_;
+    uint32_t sampleRate_;
+    bool compress_;
+    uint64_t windowFrames_;
+    uint64_t capacityFrames_ = 0;
+    std::vector<float> ring_;   // interleaved, written by the RT thread only
+    std::atomic<uint64_t> writeFrame_{0};
+
+    // Compressor state; blocks_/store_ are shared with readers under storeMutex_
+    std::mutex storeMutex_;
+    std::vector<uint8_t> store_;
+    std::vector<Block> blocks_;
+    size_t blockTail_ = 0;
+    size_t blockCount_ = 0;
+    size_t storeHead_ = 0;
+    uint64_t encodedFrame_ = 0;
+    std::vector<float> blockSamples_;
+    std::vector<uint8_t> encoded_;
+    std::unique_ptr<LosslessCodec> codec_;
+    std::thread compressor_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> lostFrames_{0};
+};
@@ -0,0 +1,71 @@
+// jack-bridge-local/include/request_arena.h
+// Per-request monotonic arena and heap allocation accounting
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+// Heap allocation counters, bumped by the global operator new replacement
+// in main.cpp. Thread-local so the hot path never touches a shared cache line;
+// request handlers sample them before and after a request to get a delta.
+namespace alloc_stats {
+    inline thread_local uint64_t t_allocations = 0;
+    inline thread_local uint64_t t_bytes = 0;
+
+    struct Sample {
+        uint64_t allocations;
+        uint64_t bytes;
+    };
+
+    inline Sample sample() {
+        return { t_allocations, t_bytes };
+    }
+}
+
+// Upstream for the arena: forwards to the heap but counts how often the
+// inline buffer was too small, so overflow shows up in /stats.
+class ArenaUpstream : public std::pmr::memory_resource {
+public:
+    uint64_t overflows() const { return overflows_.load(std::memory_order_relaxed); }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        overflows_.fetch_add(1, std::memory_order_relaxed);
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::atomic<uint64_t> overflows_{0};
+};
+
+// Monotonic arena backed by an inline buffer. All request-scoped strings and
+// containers allocate from here; reset() drops everything at once after the
+// response has been sent. Lives on the connection thread's stack.
+class RequestArena {
+public:
+    static constexpr std::size_t kInlineBytes = 32 * 1024;
+
+    explicit RequestArena(ArenaUpstream* upstream)
+        : resource_(buffer_, sizeof(buffer_), upstream) {}
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &resource_; }
+
+    void reset() { resource_.release(); }
+
+private:
+    alignas(std::max_align_t) std::byte buffer_[kInlineBytes];
+    std::pmr::monotonic_buffer_resource resource_;
+};
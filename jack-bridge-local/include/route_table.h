@@ -0,0 +1,371 @@
+// jack-bridge-local/include/route_table.h
+// Compile-time HTTP route table with perfect-hash dispatch
+//
+// Routes are declared as a constexpr array of { method, pattern, handler }.
+// A pattern is a path whose segments are literals or parameters:
+//
+//   /ports/{name}/connections     {name} matches any non-empty segment
+//   /recordings/{id:int}          {id:int} matches an optional '-' and digits
+//
+// Router builds a perfect hash over the distinct patterns at
+// compile time (hash and displace: a first hash picks a bucket, the bucket's
+// displacement picks a free slot). A lookup hashes the path once, reads one
+// displacement and one slot and compares one pattern, whatever the number of
+// routes. Paths that only match a parameterised pattern cost one more probe
+// per distinct parameter layout ("shape") in the table, not per route.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace http {
+
+enum class Method : uint8_t {
+    Any,        // matches every method without a route of its own
+    Get,
+    Post,
+    Put,
+    Delete,
+    Other,
+};
+
+constexpr size_t kMethods = 6;
+
+constexpr Method parseMethod(std::string_view method) {
+    if (method == "GET") return Method::Get;
+    if (method == "POST") return Method::Post;
+    if (method == "PUT") return Method::Put;
+    if (method == "DELETE") return Method::Delete;
+    return Method::Other;
+}
+
+constexpr size_t kMaxParams = 4;
+constexpr size_t kMaxSegments = 16;
+
+// Values of the parameter segments of a matched path, in pattern order.
+// Text values are raw (still percent-encoded) views into the path.
+class RouteParams {
+public:
+    constexpr size_t size() const { return count_; }
+    constexpr std::string_view operator[](size_t i) const { return text_[i]; }
+    // Value of an {x:int} parameter; 0 for text parameters
+    constexpr long long number(size_t i) const { return number_[i]; }
+
+    constexpr void clear() { count_ = 0; }
+    constexpr void add(std::string_view text, long long number) {
+        text_[count_] = text;
+        number_[count_] = number;
+        count_++;
+    }
+
+private:
+    std::array<std::string_view, kMaxParams> text_{};
+    std::array<long long, kMaxParams> number_{};
+    size_t count_ = 0;
+};
+
+template <typename Handler>
+struct Route {
+    Method method;
+    std::string_view pattern;
+    Handler handler;
+};
+
+namespace detail {
+    // Takes the next '/'-separated segment off the front of rest
+    constexpr std::string_view nextSegment(std::string_view& rest) {
+        size_t slash = rest.find('/');
+        std::string_view segment = rest.substr(0, slash);
+        rest = slash == std::string_view::npos ? std::string_view() : rest.substr(slash + 1);
+        return segment;
+    }
+
+    constexpr bool isParam(std::string_view segment) {
+        return segment.length() >= 3 && segment.front() == '{' && segment.back() == '}';
+    }
+
+    constexpr bool isIntParam(std::string_view segment) {
+        return segment.length() > 6 && segment.substr(segment.length() - 5) == ":int}";
+    }
+
+    // Segments in a path with its leading '/' removed ("" is one segment)
+    constexpr size_t segmentCount(std::string_view path) {
+        return static_cast<size_t>(std::count(path.begin(), path.end(), '/')) + 1;
+    }
+
+    // Bit i set when segment i of the pattern is a parameter
+    constexpr uint32_t paramMask(std::string_view pattern) {
+        uint32_t mask = 0;
+        size_t i = 0;
+        do {
+            if (isParam(nextSegment(pattern))) mask |= 1u << i;
+            i++;
+        } while (!pattern.empty());
+        return mask;
+    }
+
+    constexpr uint64_t mixByte(uint64_t hash, char c) {
+        return (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+
+    // FNV-1a of the path with the segments in mask hashed as "{}", so a
+    // pattern and every path it matches hash alike
+    constexpr uint64_t hashPath(std::string_view path, uint32_t mask) {
+        uint64_t hash = mixByte(14695981039346656037ull, '/');
+        if (mask == 0) {
+            for (char c : path) hash = mixByte(hash, c);
+            return hash;
+        }
+        hash = 14695981039346656037ull;
+        size_t i = 0;
+        do {
+            std::string_view segment = nextSegment(path);
+            hash = mixByte(hash, '/');
+            if (i < kMaxSegments && (mask & (1u << i))) {
+                hash = mixByte(mixByte(hash, '{'), '}');
+            } else {
+                for (char c : segment) hash = mixByte(hash, c);
+            }
+            i++;
+        } while (!path.empty());
+        return hash;
+    }
+
+    constexpr uint64_t finalize(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    constexpr bool parseInt(std::string_view text, long long& value) {
+        bool negative = !text.empty() && text.front() == '-';
+        if (negative) text.remove_prefix(1);
+        if (text.empty() || text.length() > 18) return false;
+        value = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') return false;
+            value = value * 10 + (c - '0');
+        }
+        if (negative) value = -value;
+        return true;
+    }
+
+    // Whether path (leading '/' removed) matches pattern (likewise) with the
+    // parameters exactly where mask says; fills params when it does
+    constexpr bool matchPath(std::string_view pattern, std::string_view path, uint32_t mask, RouteParams& params) {
+        params.clear();
+        size_t segments = segmentCount(pattern);
+        if (segmentCount(path) != segments) return false;
+        for (size_t i = 0; i < segments; i++) {
+            std::string_view want = nextSegment(pattern);
+            std::string_view have = nextSegment(path);
+            bool param = isParam(want);
+            if (param != ((mask & (1u << i)) != 0)) return false;
+            if (param) {
+                long long number = 0;
+                if (have.empty() || (isIntParam(want) && !parseInt(have, number))) return false;
+                params.add(have, number);
+            } else if (want != have) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Same routing key: equal literals, parameters in the same places
+    constexpr bool samePattern(std::string_view a, std::string_view b) {
+        size_t segments = segmentCount(a);
+        if (segmentCount(b) != segments) return false;
+        for (size_t i = 0; i < segments; i++) {
+            std::string_view x = nextSegment(a);
+            std::string_view y = nextSegment(b);
+            if (isParam(x) != isParam(y) || (!isParam(x) && x != y)) return false;
+        }
+        return true;
+    }
+}
+
+template <typename Handler, size_t N>
+class Router {
+public:
+    // Invalid tables (a pattern without a leading '/', too many segments or
+    // parameters, the same method and pattern twice) fail to compile
+    consteval explicit Router(const std::array<Route<Handler>, N>& routes) : routes_(routes) {
+        std::array<uint64_t, N> hashes{};
+        for (size_t r = 0; r < N; r++) {
+            std::string_view pattern = routes[r].pattern;
+            if (pattern.empty() || pattern.front() != '/') throw "route pattern must start with '/'";
+            pattern.remove_prefix(1);
+            size_t segments = detail::segmentCount(pattern);
+            uint32_t mask = detail::paramMask(pattern);
+            if (segments > kMaxSegments) throw "route pattern has too many segments";
+            if (static_cast<size_t>(std::popcount(mask)) > kMaxParams) throw "route pattern has too many parameters";
+
+            uint64_t hash = detail::finalize(detail::hashPath(pattern, mask));
+            size_t k = 0;
+            while (k < keyCount_ && !(hashes[k] == hash && detail::samePattern(keys_[k].pattern, pattern))) k++;
+            if (k == keyCount_) {
+                keys_[k].pattern = pattern;
+                keys_[k].mask = mask;
+                hashes[k] = hash;
+                keyCount_++;
+                if (mask != 0) addShape(mask, segments);
+            }
+            uint16_t& slot = keys_[k].routes[static_cast<size_t>(routes[r].method)];
+            if (slot != 0) throw "duplicate route";
+            slot = static_cast<uint16_t>(r + 1);
+        }
+        place(hashes);
+    }
+
+    // Handler for method and path (query string already removed), or null.
+    // params receives the parameter segments of the matched pattern.
+    constexpr const Handler* find(Method method, std::string_view path, RouteParams& params) const {
+        if (path.empty() || path.front() != '/') return nullptr;
+        path.remove_prefix(1);
+        if (const Key* key = lookup(path, 0, params)) return handlerFor(*key, method);
+
+        size_t segments = shapeCount_ ? detail::segmentCount(path) : 0;
+        for (size_t s = 0; s < shapeCount_; s++) {
+            if (shapes_[s].segments != segments) continue;
+            if (const Key* key = lookup(path, shapes_[s].mask, params)) return handlerFor(*key, method);
+        }
+        return nullptr;
+    }
+
+    constexpr size_t patterns() const { return keyCount_; }
+    constexpr size_t shapes() const { return shapeCount_; }
+    static constexpr size_t slots() { return kSlots; }
+
+private:
+    static constexpr size_t kBuckets = std::bit_ceil(N);
+    static constexpr size_t kSlots = 2 * kBuckets;          // at most half full
+
+    struct Key {
+        std::string_view pattern;                           // leading '/' removed
+        uint32_t mask = 0;
+        std::array<uint16_t, kMethods> routes{};            // route index + 1 by method
+    };
+
+    struct Shape {
+        uint32_t mask = 0;
+        size_t segments = 0;
+    };
+
+    static constexpr size_t bucketOf(uint64_t hash) { return hash & (kBuckets - 1); }
+    static constexpr size_t slotOf(uint64_t hash, uint16_t displacement) {
+        return detail::finalize(hash ^ (displacement * 0x9e3779b97f4a7c15ull)) & (kSlots - 1);
+    }
+
+    consteval void addShape(uint32_t mask, size_t segments) {
+        for (size_t s = 0; s < shapeCount_; s++) {
+            if (shapes_[s].mask == mask && shapes_[s].segments == segments) return;
+        }
+        shapes_[shapeCount_++] = Shape{mask, segments};
+    }
+
+    // Largest buckets first, each with the smallest displacement that puts
+    // all of its keys in free slots
+    consteval void place(const std::array<uint64_t, N>& hashes) {
+        std::array<size_t, kBuckets> sizes{};
+        size_t largest = 0;
+        for (size_t k = 0; k < keyCount_; k++) {
+            largest = std::max(largest, ++sizes[bucketOf(hashes[k])]);
+        }
+        for (size_t size = largest; size > 0; size--) {
+            for (size_t b = 0; b < kBuckets; b++) {
+                if (sizes[b] != size) continue;
+                std::array<size_t, N> members{};
+                size_t count = 0;
+                for (size_t k = 0; k < keyCount_; k++) {
+                    if (bucketOf(hashes[k]) == b) members[count++] = k;
+                }
+                for (uint32_t d = 0;; d++) {
+                    if (d > 0xFFFF) throw "no perfect hash for the route table";
+                    bool fits = true;
+                    for (size_t i = 0; i < count && fits; i++) {
+                        size_t slot = slotOf(hashes[members[i]], static_cast<uint16_t>(d));
+                        if (slots_[slot] != 0) fits = false;
+                        for (size_t j = 0; j < i && fits; j++) {
+                            fits = slotOf(hashes[members[j]], static_cast<uint16_t>(d)) != slot;
+                        }
+                    }
+                    if (!fits) continue;
+                    displacements_[b] = static_cast<uint16_t>(d);
+                    for (size_t i = 0; i < count; i++) {
+                        slots_[slotOf(hashes[members[i]], static_cast<uint16_t>(d))] = static_cast<uint16_t>(members[i] + 1);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    constexpr const Key* lookup(std::string_view path, uint32_t mask, RouteParams& params) const {
+        uint64_t hash = detail::finalize(detail::hashPath(path, mask));
+        uint16_t k = slots_[slotOf(hash, displacements_[bucketOf(hash)])];
+        if (k == 0) return nullptr;
+        const Key& key = keys_[k - 1];
+        if (key.mask != mask) return nullptr;
+        if (mask == 0) {
+            params.clear();
+            if (key.pattern != path) return nullptr;
+        } else if (!detail::matchPath(key.pattern, path, mask, params)) {
+            return nullptr;
+        }
+        return &key;
+    }
+
+    constexpr const Handler* handlerFor(const Key& key, Method method) const {
+        uint16_t r = key.routes[static_cast<size_t>(method)];
+        if (r == 0) r = key.routes[static_cast<size_t>(Method::Any)];
+        return r ? &routes_[r - 1].handler : nullptr;
+    }
+
+    std::array<Route<Handler>, N> routes_;
+    std::array<Key, N> keys_{};
+    size_t keyCount_ = 0;
+    std::array<Shape, N> shapes_{};
+    size_t shapeCount_ = 0;
+    std::array<uint16_t, kBuckets> displacements_{};
+    std::array<uint16_t, kSlots> slots_{};
+};
+
+template <typename Handler, size_t N>
+Router(const std::array<Route<Handler>, N>&) -> Router<Handler, N>;
+
+namespace detail {
+    constexpr bool routerSelfCheck() {
+        constexpr std::array<Route<int>, 5> routes{{
+            {Method::Any, "/stats", 1},
+            {Method::Post, "/stats/locks/reset", 2},
+            {Method::Get, "/ports/{name}/connections", 3},
+            {Method::Delete, "/ports/{name}/connections", 4},
+            {Method::Get, "/recordings/{id:int}", 5},
+        }};
+        Router router(routes);
+        RouteParams params;
+        auto found = [&](Method method, std::string_view path) {
+            const int* handler = router.find(method, path, params);
+            return handler ? *handler : 0;
+        };
+        return found(Method::Put, "/stats") == 1 && found(Method::Post, "/stats/locks/reset") == 2 &&
+               found(Method::Get, "/stats/locks/reset") == 0 && found(Method::Get, "/stats/") == 0 &&
+               found(Method::Delete, "/ports/system:capture_1/connections") == 4 &&
+               params.size() == 1 && params[0] == "system:capture_1" &&
+               found(Method::Get, "/ports//connections") == 0 &&
+               found(Method::Get, "/recordings/42") == 5 && params.number(0) == 42 &&
+               found(Method::Get, "/recordings/x42") == 0 && found(Method::Get, "stats") == 0;
+    }
+    static_assert(routerSelfCheck(), "route table dispatch");
+}
+
+}  // namespace http
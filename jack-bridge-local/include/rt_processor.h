@@ -0,0 +1,96 @@
+// jack-bridge-local/include/rt_processor.h
+// Work run inside the JACK process callback
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+extern "C" {
+    #include <jack/types.h>
+}
+
+// Implementations run on the JACK real-time thread and must not lock, allocate,
+// log or touch the disk. Anything slow is handed to a worker via a ring buffer.
+class RtProcessor {
+public:
+    virtual ~RtProcessor() = default;
+    virtual void process(jack_nframes_t nframes) = 0;
+};
+
+// Fixed table the process callback walks every cycle. Control threads publish
+// and retract processors with atomics only; remove() additionally waits until
+// the RT thread has left any cycle that might still be using the processor,
+// after which the caller may free it.
+class RtProcessorTable {
+public:
+    static constexpr size_t kMaxProcessors = 32;
+
+    // RT thread
+    void run(jack_nframes_t nframes) {
+        cycle_.fetch_add(1); // odd: inside a cycle
+        for (auto& slot : slots_) {
+            if (RtProcessor* processor = slot.load(std::memory_order_acquire)) {
+                processor->process(nframes);
+            }
+        }
+        cycle_.fetch_add(1); // even: idle
+    }
+
+    bool add(RtProcessor* processor) {
+        for (auto& slot : slots_) {
+            RtProcessor* expected = nullptr;
+            if (slot.compare_exchange_strong(expected, processor)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns false if the RT thread did not finish its cycle within the
+    // timeout (JACK wedged); the caller must then leak rather than free.
+    bool remove(RtProcessor* processor,
+                std::chrono::milliseconds timeout = std::chrono::milliseconds(500)) {
+        for (auto& slot : slots_) {
+            RtProcessor* expected = processor;
+            slot.compare_exchange_strong(expected, nullptr);
+        }
+        return synchronize(timeout);
+    }
+
+    // Waits until any cycle in progress has finished, so a pointer the RT
+    // thread could have loaded before this call is no longer in use. Same
+    // timeout contract as remove().
+    bool synchronize(std::chrono::milliseconds timeout = std::chrono::milliseconds(500)) {
+        uint64_t seen = cycle_.load();
+        if ((seen & 1) == 0) {
+            return true;
+        }
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (cycle_.load() == seen) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        return true;
+    }
+
+    // Drops every processor without waiting; only valid once the JACK client
+    // has been closed and the process callback can no longer run.
+    void clear() {
+        for (auto& slot : slots_) {
+            slot.store(nullptr);
+        }
+    }
+
+    // Completed process cycles, for callers that need to wait a period
+    uint64_t cycles() const { return cycle_.load() / 2; }
+
+private:
+    std::array<std::atomic<RtProcessor*>, kMaxProcessors> slots_{};
+    std::atomic<uint64_t> cycle_{0};
+};
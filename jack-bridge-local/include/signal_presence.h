@@ -0,0 +1,97 @@
+// jack-bridge-local/include/signal_presence.h
+// Per-input signal presence with level and time hysteresis
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+extern "C" {
+    #include <jack/jack.h>
+}
+
+#include "rt_processor.h"
+
+// Watches up to kMaxInputs bridge-owned input ports. Each period costs one
+// peak scan per input: an input turns active when a period peaks at or above
+// its on-level, and only turns inactive once no period has reached the lower
+// off-level for holdFrames. Control threads only read the outcome.
+class PresenceDetector : public RtProcessor {
+public:
+    static constexpr size_t kMaxInputs = 16;
+
+    // Control thread, on a slot that is cleared and synchronized. The input
+    // counts as active from now, so silence is only reported after a full hold.
+    void setInput(size_t slot, jack_port_t* port, float onLevel, float offLevel, uint64_t holdFrames) {
+        Input& in = inputs_[slot];
+        in.onLevel = onLevel;
+        in.offLevel = offLevel;
+        in.holdFrames = holdFrames;
+        in.peak.store(0.0f, std::memory_order_relaxed);
+        in.lastAboveFrame.store(frame_.load(), std::memory_order_relaxed);
+        in.active.store(true, std::memory_order_relaxed);
+        in.port.store(port, std::memory_order_release);
+    }
+
+    // Control thread; the RT thread may use the port until the next synchronize
+    void clearInput(size_t slot) { inputs_[slot].port.store(nullptr); }
+
+    // RT thread
+    void process(jack_nframes_t nframes) override {
+        uint64_t now = frame_.load(std::memory_order_relaxed) + nframes;
+        for (Input& in : inputs_) {
+            jack_port_t* port = in.port.load(std::memory_order_acquire);
+            if (!port) continue;
+
+            const float* samples = static_cast<const float*>(jack_port_get_buffer(port, nframes));
+            float peak = 0.0f;
+            for (jack_nframes_t i = 0; i < nframes; i++) {
+                float magnitude = std::fabs(samples[i]);
+                peak = magnitude > peak ? magnitude : peak;
+            }
+            in.peak.store(peak, std::memory_order_relaxed);
+
+            bool active = in.active.load(std::memory_order_relaxed);
+            if (peak >= (active ? in.offLevel : in.onLevel)) {
+                in.lastAboveFrame.store(now, std::memory_order_relaxed);
+                if (!active) {
+                    in.active.store(true, std::memory_order_release);
+                    in.onsets.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else if (active && now - in.lastAboveFrame.load(std::memory_order_relaxed) > in.holdFrames) {
+                in.active.store(false, std::memory_order_release);
+            }
+        }
+        frame_.store(now, std::memory_order_release);
+    }
+
+    bool active(size_t slot) const { return inputs_[slot].active.load(std::memory_order_acquire); }
+    float peak(size_t slot) const { return inputs_[slot].peak.load(std::memory_order_relaxed); }
+    uint64_t onsets(size_t slot) const { return inputs_[slot].onsets.load(std::memory_order_relaxed); }
+
+    // Frames since the input last reached its off-level
+    uint64_t silentFrames(size_t slot) const {
+        return frame_.load(std::memory_order_acquire) - inputs_[slot].lastAboveFrame.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Input {
+        std::atomic<jack_port_t*> port{nullptr};
+        float onLevel = 0.0f;       // written only while port is null
+        float offLevel = 0.0f;
+        uint64_t holdFrames = 0;
+        std::atomic<float> peak{0.0f};
+        std::atomic<uint64_t> lastAboveFrame{0};
+        std::atomic<uint64_t> onsets{0};
+        std::atomic<bool> active{false};
+    };
+
+    std::array<Input, kMaxInputs> inputs_;
+    std::atomic<uint64_t> frame_{0};
+};
+
+inline float dbToLinear(double db) {
+    return static_cast<float>(std::pow(10.0, db / 20.0));
+}
@@ -0,0 +1,193 @@
+// jack-bridge-local/include/spectrum.h
+// Real-input FFT and averaged magnitude spectra for the analyser
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Radix-2 Stockham FFT on split (separate real/imaginary) arrays. Every stage
+// is a pair of straight loops over contiguous memory with no bit reversal,
+// which compilers turn into packed SIMD; the twiddles come from a table
+// shared by every transform of the same size. A real signal of N samples is
+// transformed as N/2 complex points and then separated.
+class RealFft {
+public:
+    static constexpr size_t kMinSize = 16;
+    static constexpr size_t kMaxSize = 65536;
+
+    static bool validSize(size_t n) {
+        return n >= kMinSize && n <= kMaxSize && (n & (n - 1)) == 0;
+    }
+
+    explicit RealFft(size_t size)
+        : size_(size),
+          half_(size / 2),
+          twiddles_(twiddles(size)),
+          re_(half_), im_(half_), scratchRe_(half_), scratchIm_(half_) {}
+
+    size_t size() const { return size_; }
+    size_t bins() const { return half_ + 1; }
+
+    // in: size() samples; re/im: bins() outputs, DC to Nyquist
+    void forward(const float* in, float* re, float* im) {
+        for (size_t k = 0; k < half_; k++) {
+            re_[k] = in[2 * k];
+            im_[k] = in[2 * k + 1];
+        }
+
+        const float* cosTable = twiddles_->cos.data();
+        const float* sinTable = twiddles_->sin.data();
+        float* srcRe = re_.data();
+        float* srcIm = im_.data();
+        float* dstRe = scratchRe_.data();
+        float* dstIm = scratchIm_.data();
+
+        for (size_t n = half_, s = 1; n > 1; n /= 2, s *= 2) {
+            size_t m = n / 2;
+            for (size_t p = 0; p < m; p++) {
+                // W_{N/2}^{p*s} == W_N^{2*p*s}
+                float wr = cosTable[2 * p * s];
+                float wi = -sinTable[2 * p * s];
+                const float* aRe = srcRe + s * p;
+                const float* aIm = srcIm + s * p;
+                const float* bRe = srcRe + s * (p + m);
+                const float* bIm = srcIm + s * (p + m);
+                float* sumRe = dstRe + s * 2 * p;
+                float* sumIm = dstIm + s * 2 * p;
+                float* difRe = dstRe + s * (2 * p + 1);
+                float* difIm = dstIm + s * (2 * p + 1);
+                for (size_t q = 0; q < s; q++) {
+                    float dr = aRe[q] - bRe[q];
+                    float di = aIm[q] - bIm[q];
+                    sumRe[q] = aRe[q] + bRe[q];
+                    sumIm[q] = aIm[q] + bIm[q];
+                    difRe[q] = dr * wr - di * wi;
+                    difIm[q] = dr * wi + di * wr;
+                }
+            }
+            std::swap(srcRe, dstRe);
+            std::swap(srcIm, dstIm);
+        }
+
+        // Split the packed even/odd transform into the real spectrum
+        re[0] = srcRe[0] + srcIm[0];
+        im[0] = 0;
+        re[half_] = srcRe[0] - srcIm[0];
+        im[half_] = 0;
+        for (size_t k = 1; k < half_; k++) {
+            float zr = srcRe[k], zi = srcIm[k];
+            float cr = srcRe[half_ - k], ci = -srcIm[half_ - k];
+            float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+            float orr = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+            float wr = cosTable[k], wi = -sinTable[k];
+            re[k] = er + orr * wr - oi * wi;
+            im[k] = ei + orr * wi + oi * wr;
+        }
+    }
+
+private:
+    struct Twiddles {
+        std::vector<float> cos;   // cos(2*pi*k/N), k < N/2
+        std::vector<float> sin;
+    };
+
+    static std::shared_ptr<const Twiddles> twiddles(size_t n) {
+        static std::mutex mutex;
+        static std::map<size_t, std::shared_ptr<const Twiddles>> cache;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& entry = cache[n];
+        if (!entry) {
+            auto table = std::make_shared<Twiddles>();
+            table->cos.resize(n / 2);
+            table->sin.resize(n / 2);
+            const double pi = 3.14159265358979323846;
+            for (size_t k = 0; k < n / 2; k++) {
+                table->cos[k] = static_cast<float>(std::cos(2 * pi * k / n));
+                table->sin[k] = static_cast<float>(std::sin(2 * pi * k / n));
+            }
+            entry = table;
+        }
+        return entry;
+    }
+
+    size_t size_;
+    size_t half_;
+    std::shared_ptr<const Twiddles> twiddles_;
+    std::vector<float> re_, im_, scratchRe_, scratchIm_;
+};
+
+enum class SpectrumWindow { Rectangular, Hann, BlackmanHarris };
+
+inline const char* spectrumWindowName(SpectrumWindow window) {
+    switch (window) {
+    case SpectrumWindow::Rectangular: return "rect";
+    case SpectrumWindow::BlackmanHarris: return "blackman";
+    default: return "hann";
+    }
+}
+
+// Windowed, power-averaged magnitude spectrum. The first `average` frames
+// are a plain mean, after which averaging becomes exponential with the same
+// time constant. Magnitudes are scaled so a full-scale sine reads 0 dBFS.
+class SpectrumAverager {
+public:
+    SpectrumAverager(size_t size, SpectrumWindow window, unsigned average)
+        : fft_(size), window_(size), windowed_(size), re_(fft_.bins()), im_(fft_.bins()),
+          power_(fft_.bins(), 0.0f), average_(average < 1 ? 1 : average) {
+        const double pi = 3.14159265358979323846;
+        double sum = 0;
+        for (size_t n = 0; n < size; n++) {
+            double x = 2 * pi * n / size;
+            double w = 1.0;
+            if (window == SpectrumWindow::Hann) {
+                w = 0.5 - 0.5 * std::cos(x);
+            } else if (window == SpectrumWindow::BlackmanHarris) {
+                w = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+            }
+            window_[n] = static_cast<float>(w);
+            sum += w;
+        }
+        // Amplitude of a bin-centred sine of peak 1.0 after windowing is sum/2
+        scale_ = static_cast<float>(2.0 / sum);
+    }
+
+    size_t bins() const { return fft_.bins(); }
+    uint64_t frames() const { return frames_; }
+
+    void add(const float* samples) {
+        for (size_t n = 0; n < window_.size(); n++) {
+            windowed_[n] = samples[n] * window_[n];
+        }
+        fft_.forward(windowed_.data(), re_.data(), im_.data());
+
+        frames_++;
+        float weight = 1.0f / static_cast<float>(frames_ < average_ ? frames_ : average_);
+        for (size_t k = 0; k < power_.size(); k++) {
+            float p = (re_[k] * re_[k] + im_[k] * im_[k]) * scale_ * scale_;
+            power_[k] += (p - power_[k]) * weight;
+        }
+    }
+
+    // dBFS per bin, floored at -200
+    void magnitudesDb(std::vector<float>& out) const {
+        out.resize(power_.size());
+        for (size_t k = 0; k < power_.size(); k++) {
+            out[k] = power_[k] > 1e-20f ? 10.0f * std::log10(power_[k]) : -200.0f;
+        }
+    }
+
+private:
+    RealFft fft_;
+    std::vector<float> window_, windowed_, re_, im_, power_;
+    unsigned average_;
+    float scale_ = 1.0f;
+    uint64_t frames_ = 0;
+};
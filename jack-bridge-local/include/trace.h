@@ -0,0 +1,230 @@
+// jack-bridge-local/include/trace.h
+// Scoped tracing spans recorded into per-thread ring buffers
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// One completed span. Names must be string literals; they are stored by pointer.
+struct TraceEvent {
+    const char* name;
+    uint64_t startNs;
+    uint64_t durationNs;
+    uint32_t threadId;
+    uint32_t requestId;
+};
+
+// Fixed-size ring written by one thread at a time. The mutex is only ever
+// contended while /trace is copying the buffer out.
+class TraceBuffer {
+public:
+    static constexpr size_t kCapacity = 2048;
+
+    void push(const TraceEvent& event) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_[head_ % kCapacity] = event;
+        head_++;
+    }
+
+    // Appends events that started at or after sinceNs
+    template <typename Vector>
+    void collect(uint64_t sinceNs, Vector& out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t count = head_ < kCapacity ? head_ : kCapacity;
+        for (uint64_t i = head_ - count; i < head_; i++) {
+            const TraceEvent& event = events_[i % kCapacity];
+            if (event.startNs >= sinceNs) {
+                out.push_back(event);
+            }
+        }
+    }
+
+private:
+    mutable std::mutex mutex_;
+    TraceEvent events_[kCapacity];
+    uint64_t head_ = 0;
+};
+
+// Owns every trace buffer. Threads borrow a buffer on their first span and
+// hand it back when they exit, so short-lived connection threads reuse a
+// bounded set of buffers and their history survives for /trace.
+class TraceRegistry {
+public:
+    static constexpr size_t kMaxBuffers = 64;
+    using Clock = std::chrono::steady_clock;
+
+    static TraceRegistry& instance() {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    static void setEnabled(bool enabled) { enabledFlag().store(enabled, std::memory_order_relaxed); }
+    static bool enabled() { return enabledFlag().load(std::memory_order_relaxed); }
+
+    // Nanoseconds since the registry was created
+    uint64_t now() const {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch_).count());
+    }
+
+    TraceBuffer* acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty()) {
+            TraceBuffer* buffer = free_.back();
+            free_.pop_back();
+            return buffer;
+        }
+        if (buffers_.size() >= kMaxBuffers) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        buffers_.push_back(std::make_unique<TraceBuffer>());
+        return buffers_.back().get();
+    }
+
+    void release(TraceBuffer* buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(buffer);
+    }
+
+    template <typename Vector>
+    void collect(uint64_t sinceNs, Vector& out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& buffer : buffers_) {
+            buffer->collect(sinceNs, out);
+        }
+    }
+
+    size_t bufferCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return buffers_.size();
+    }
+
+    // Threads that found every buffer in use and are not being traced
+    uint64_t droppedThreads() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    TraceRegistry() : epoch_(Clock::now()) {}
+
+    static std::atomic<bool>& enabledFlag() {
+        static std::atomic<bool> flag{true};
+        return flag;
+    }
+
+    Clock::time_point epoch_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers_;
+    std::vector<TraceBuffer*> free_;
+    std::atomic<uint64_t> dropped_{0};
+};
+
+// Per-request phase totals for the Server-Timing header
+struct RequestTiming {
+    struct Phase {
+        const char* name;
+        uint64_t durationNs;
+    };
+
+    static constexpr size_t kMaxPhases = 16;
+
+    Phase phases[kMaxPhases];
+    size_t count = 0;
+
+    void add(const char* name, uint64_t durationNs) {
+        for (size_t i = 0; i < count; i++) {
+            if (phases[i].name == name || std::strcmp(phases[i].name, name) == 0) {
+                phases[i].durationNs += durationNs;
+                return;
+            }
+        }
+        if (count < kMaxPhases) {
+            phases[count++] = Phase{name, durationNs};
+        }
+    }
+};
+
+namespace trace_detail {
+    // Returns the thread's buffer to the registry on thread exit
+    struct ThreadBuffer {
+        TraceBuffer* buffer = nullptr;
+        bool acquired = false;
+
+        ~ThreadBuffer() {
+            if (buffer) {
+                TraceRegistry::instance().release(buffer);
+            }
+        }
+    };
+
+    inline thread_local ThreadBuffer t_buffer;
+    inline thread_local uint32_t t_threadId = 0;
+    inline thread_local uint32_t t_requestId = 0;
+    inline thread_local RequestTiming* t_timing = nullptr;
+    inline std::atomic<uint32_t> g_nextThreadId{1};
+
+    inline TraceBuffer* threadBuffer() {
+        if (!t_buffer.acquired) {
+            t_buffer.acquired = true;
+            t_buffer.buffer = TraceRegistry::instance().acquire();
+            t_threadId = g_nextThreadId.fetch_add(1, std::memory_order_relaxed);
+        }
+        return t_buffer.buffer;
+    }
+}
+
+// Marks the calling thread as serving one request until destroyed: spans
+// are tagged with the request id and their durations summed per name.
+class RequestTraceScope {
+public:
+    RequestTraceScope(uint32_t requestId, RequestTiming* timing) {
+        trace_detail::t_requestId = requestId;
+        trace_detail::t_timing = timing;
+    }
+
+    ~RequestTraceScope() {
+        trace_detail::t_requestId = 0;
+        trace_detail::t_timing = nullptr;
+    }
+};
+
+// RAII span: TraceSpan span("jack_connect");
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) : name_(name) {
+        if (TraceRegistry::enabled()) {
+            startNs_ = TraceRegistry::instance().now();
+            active_ = true;
+        }
+    }
+
+    ~TraceSpan() { end(); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // Closes the span early; later calls are no-ops
+    void end() {
+        if (!active_) return;
+        active_ = false;
+
+        uint64_t durationNs = TraceRegistry::instance().now() - startNs_;
+        if (trace_detail::t_timing) {
+            trace_detail::t_timing->add(name_, durationNs);
+        }
+        if (TraceBuffer* buffer = trace_detail::threadBuffer()) {
+            buffer->push(TraceEvent{name_, startNs_, durationNs,
+                                    trace_detail::t_threadId, trace_detail::t_requestId});
+        }
+    }
+
+private:
+    const char* name_;
+    uint64_t startNs_ = 0;
+    bool active_ = false;
+};
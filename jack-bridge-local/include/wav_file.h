@@ -0,0 +1,181 @@
+// jack-bridge-local/include/wav_file.h
+// Streaming 32-bit float WAV writer that upgrades to RF64 past 4 GiB
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+
+// Layout (EBU Tech 3306 style):
+//   RIFF/RF64 | JUNK->ds64 placeholder | fmt | fact | JUNK padding | data
+// The padding puts the first sample at kHeaderBytes so every block write
+// lands on a 4 KiB file offset. Samples are staged in an aligned buffer and
+// written in kBlockBytes chunks; the tail is flushed by close().
+class WavFileWriter {
+public:
+    static constexpr size_t kHeaderBytes = 4096;
+    static constexpr size_t kBlockBytes = 1024 * 1024;
+    static constexpr size_t kAlignment = 4096;
+
+    WavFileWriter() = default;
+    WavFileWriter(const WavFileWriter&) = delete;
+    WavFileWriter& operator=(const WavFileWriter&) = delete;
+
+    ~WavFileWriter() {
+        close();
+        if (block_) {
+            ::operator delete(block_, std::align_val_t(kAlignment));
+        }
+    }
+
+    bool open(const std::string& path, uint32_t sampleRate, uint16_t channels) {
+        close();
+        if (!block_) {
+            block_ = static_cast<char*>(::operator new(kBlockBytes, std::align_val_t(kAlignment)));
+        }
+
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) {
+            return false;
+        }
+        // We already write in large blocks; skip the CRT's extra copy
+        std::setvbuf(file_, nullptr, _IONBF, 0);
+
+        sampleRate_ = sampleRate;
+        channels_ = channels;
+        dataBytes_ = 0;
+        blockUsed_ = 0;
+        failed_ = false;
+
+        char header[kHeaderBytes];
+        buildHeader(header, false);
+        if (std::fwrite(header, 1, sizeof(header), file_) != sizeof(header)) {
+            failed_ = true;
+        }
+        return !failed_;
+    }
+
+    bool isOpen() const { return file_ != nullptr; }
+    bool failed() const { return failed_; }
+    uint64_t dataBytes() const { return dataBytes_ + blockUsed_; }
+    uint64_t frames() const { return dataBytes() / frameBytes(); }
+
+    // Interleaved float frames
+    void write(const float* samples, size_t frameCount) {
+        const char* src = reinterpret_cast<const char*>(samples);
+        size_t bytes = frameCount * frameBytes();
+        while (bytes > 0 && file_) {
+            size_t chunk = kBlockBytes - blockUsed_;
+            if (chunk > bytes) chunk = bytes;
+            std::memcpy(block_ + blockUsed_, src, chunk);
+            blockUsed_ += chunk;
+            src += chunk;
+            bytes -= chunk;
+            if (blockUsed_ == kBlockBytes) {
+                flushBlock();
+            }
+        }
+    }
+
+    // Flushes the tail and patches sizes; RF64 if the file outgrew 32 bits
+    void close() {
+        if (!file_) return;
+
+        flushBlock();
+        char header[kHeaderBytes];
+        buildHeader(header, true);
+        std::fseek(file_, 0, SEEK_SET);
+        if (std::fwrite(header, 1, sizeof(header), file_) != sizeof(header)) {
+            failed_ = true;
+        }
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+private:
+    uint32_t frameBytes() const { return static_cast<uint32_t>(channels_) * sizeof(float); }
+
+    void flushBlock() {
+        if (blockUsed_ == 0 || !file_) return;
+        if (std::fwrite(block_, 1, blockUsed_, file_) != blockUsed_) {
+            failed_ = true;
+        }
+        dataBytes_ += blockUsed_;
+        blockUsed_ = 0;
+    }
+
+    static void put32(char* p, uint32_t v) {
+        for (int i = 0; i < 4; i++) p[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+    }
+
+    static void put64(char* p, uint64_t v) {
+        for (int i = 0; i < 8; i++) p[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+    }
+
+    static void put16(char* p, uint16_t v) {
+        p[0] = static_cast<char>(v & 0xFF);
+        p[1] = static_cast<char>(v >> 8);
+    }
+
+    void buildHeader(char* h, bool final) const {
+        std::memset(h, 0, kHeaderBytes);
+
+        uint64_t dataBytes = final ? dataBytes_ : 0;
+        uint64_t riffBytes = kHeaderBytes - 8 + dataBytes;
+        uint64_t frames = dataBytes / frameBytes();
+        bool rf64 = riffBytes > UINT32_MAX;
+
+        char* p = h;
+        std::memcpy(p, rf64 ? "RF64" : "RIFF", 4);
+        put32(p + 4, rf64 ? UINT32_MAX : static_cast<uint32_t>(riffBytes));
+        std::memcpy(p + 8, "WAVE", 4);
+        p += 12;
+
+        // ds64 (28 bytes); stays a JUNK chunk unless the file needs RF64
+        std::memcpy(p, rf64 ? "ds64" : "JUNK", 4);
+        put32(p + 4, 28);
+        if (rf64) {
+            put64(p + 8, riffBytes);
+            put64(p + 16, dataBytes);
+            put64(p + 24, frames);
+        }
+        p += 36;
+
+        // fmt: WAVE_FORMAT_IEEE_FLOAT
+        std::memcpy(p, "fmt ", 4);
+        put32(p + 4, 18);
+        put16(p + 8, 3);
+        put16(p + 10, channels_);
+        put32(p + 12, sampleRate_);
+        put32(p + 16, sampleRate_ * frameBytes());
+        put16(p + 20, static_cast<uint16_t>(frameBytes()));
+        put16(p + 22, 32);
+        put16(p + 24, 0);
+        p += 26;
+
+        std::memcpy(p, "fact", 4);
+        put32(p + 4, 4);
+        put32(p + 8, frames > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(frames));
+        p += 12;
+
+        // Pad so the data payload starts at kHeaderBytes
+        size_t padBytes = static_cast<size_t>(h + kHeaderBytes - p) - 16;
+        std::memcpy(p, "JUNK", 4);
+        put32(p + 4, static_cast<uint32_t>(padBytes));
+        p += 8 + padBytes;
+
+        std::memcpy(p, "data", 4);
+        put32(p + 4, rf64 ? UINT32_MAX : static_cast<uint32_t>(dataBytes));
+    }
+
+    std::FILE* file_ = nullptr;
+    char* block_ = nullptr;
+    size_t blockUsed_ = 0;
+    uint64_t dataBytes_ = 0;
+    uint32_t sampleRate_ = 0;
+    uint16_t channels_ = 0;
+    bool failed_ = false;
+};
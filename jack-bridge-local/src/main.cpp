@@ -8,16 +8,31 @@
 #include <atomic>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <sstream>
 #include <memory>
 #include <mutex>
-#include <regex>
+#include <condition_variable>
+#include <deque>
+#include <queue>
+#include <optional>
+#include <functional>
+#include <future>
+#include <new>
+#include <string_view>
+#include <memory_resource>
+#include <charconv>
+#include <type_traits>
 #include <cstdlib>
+#include <cstdio>
+#include <cctype>
 #include <cstring>
+#include <cmath>
 #include <csignal>
 #include <iomanip>
 #include <ctime>
 #include <fstream>
+#include <filesystem>
 
 // Windows includes
 #define WIN32_LEAN_AND_MEAN
@@ -30,8 +45,31 @@
 extern "C" {
     #include <jack/jack.h>
     #include <jack/types.h>
+    #include <jack/ringbuffer.h>
 }
 
+// Bridge includes
+#include "request_arena.h"
+#include "port_name.h"
+#include "graph_snapshot.h"
+#include "instrumented_mutex.h"
+#include "trace.h"
+#include "rt_processor.h"
+#include "recorder.h"
+#include "replay_buffer.h"
+#include "monitor_tap.h"
+#include "spectrum.h"
+#include "loudness.h"
+#include "signal_presence.h"
+#include "latency_probe.h"
+#include "midi_trigger.h"
+#include "mixer.h"
+#include "mqtt_packet.h"
+#include "control_protocol.h"
+#include "coro.h"
+#include "route_table.h"
+#include "circuit_breaker.h"
+
 // Link required libraries
 #pragma comment(lib, "ws2_32.lib")
 #pragma comment(lib, "wsock32.lib")
@@ -39,16 +77,55 @@ extern "C" {
 // Configuration
 struct Config {
     int apiPort = 6666;
+    int controlPort = 0;            // binary control protocol; 0 = off
+    int jackTimeoutMs = 2000;       // how long a request waits for libjack
+    int jackWatchdogMs = 10000;     // a call stuck this long reopens the client
+    int jackBreakerFailures = 3;    // timeouts or slow calls in a row that open the circuit
+    int jackBreakerSlowMs = 1000;   // a call slower than this counts as a failure
+    int jackBreakerOpenMs = 5000;   // how long an open circuit fails fast before probing
+    int httpThreads = 4;            // pool the HTTP request coroutines run on
+    int httpBlockingThreads = 4;    // pool for handlers that sleep, poll or do disk I/O
     std::string logFile = "jack-bridge.log";
     bool enableLogging = true;
     bool verbose = false;
+    bool lockStats = false;
+    bool tracing = true;
+    std::string recordDir = "recordings";
+    std::string replayPorts;        // comma separated; arms the replay buffer at startup
+    double replayMinutes = 5;
+    bool replayCompress = true;
+    size_t replayMemoryMb = 0;      // compressed store; 0 = 60% of the raw window
+    std::vector<std::string> autoRoutes;    // auto_route=source>dest,dest (one line per rule)
+    double autoRouteOnDb = -50;
+    double autoRouteOffDb = -60;
+    double autoRouteHoldSeconds = 5;
+    std::vector<std::pair<std::string, std::string>> presets;   // preset.<name>=from>to,from>to
+    std::string midiInput;          // port to connect the bridge's MIDI input to
+    int midiChannel = 0;            // 0 = any
+    std::vector<std::string> midiMaps;  // midi_map=pc3>clean or cc80>lead
+    size_t mixerInputs = 0;         // in-bridge gain stage; 0 = none
+    size_t mixerOutputs = 0;
+    std::vector<std::string> mixerCcs;  // mixer_cc=7>gain:1:1, written back by MIDI learn
+    std::string mqttHost;           // Home Assistant broker; empty = off
+    int mqttPort = 1883;
+    std::string mqttUsername;
+    std::string mqttPassword;
+    std::string mqttClientId = "jack-bridge";
+    int mqttKeepAlive = 60;
+    std::string mqttBase = "jack_audio";
+    std::vector<std::pair<std::string, std::string>> mqttInputs;    // mqtt_input.<key>=port
+    std::vector<std::pair<std::string, std::string>> mqttOutputs;   // mqtt_output.<key>=port
 };
 
 // Global variables
 jack_client_t* g_jackClient = nullptr;
 std::atomic<bool> g_jackRunning{false};
 std::atomic<bool> g_serviceRunning{true};
-std::mutex g_jackMutex;
+std::atomic<uint64_t> g_graphGeneration{1};
+std::mutex g_graphChangedMutex;
+std::condition_variable g_graphChanged;     // notified by the JACK graph callbacks
+std::atomic<uint64_t> g_jackClientGeneration{0};
+RtProcessorTable g_rtProcessors;
 Config g_config;
 std::ofstream g_logFile;
 
@@ -56,8 +133,29 @@ std::ofstream g_logFile;
 class HttpServer;
 std::unique_ptr<HttpServer> g_server;
 
+// Heap allocation accounting: every operator new bumps the calling thread's
+// counters so request handlers can report allocations per request.
+void* operator new(std::size_t size) {
+    alloc_stats::t_allocations++;
+    alloc_stats::t_bytes += size;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
 // Logging utility
 void logMessage(const std::string& level, const std::string& message) {
+    TraceSpan span("log");
     auto now = std::chrono::system_clock::now();
     auto time_t = std::chrono::system_clock::to_time_t(now);
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -89,37 +187,682 @@ void logMessage(const std::string& level, const std::string& message) {
 #define LOG_ERROR(msg) logMessage("ERROR", msg)
 #define LOG_DEBUG(msg) if(g_config.verbose) logMessage("DEBUG", msg)
 
+// Takes a processor out of g_rtProcessors. True once the RT thread is done
+// with it and the caller may free it. Otherwise the RT thread may still be
+// inside process(), so leaking is the only safe option: p lets go of it
+// without freeing and false is returned.
+template <typename Ptr>
+bool retireRtProcessor(Ptr& p, const std::string& what) {
+    if (!p || g_rtProcessors.remove(p.get())) return true;
+    LOG_ERROR(what + ": JACK cycle did not complete, leaking it");
+    if constexpr (requires { p.release(); }) {
+        p.release();
+    } else {
+        new Ptr(std::move(p)); // shared: one reference that is never dropped
+    }
+    return false;
+}
+
 // JACK callback functions
 int jackProcessCallback(jack_nframes_t nframes, void* arg) {
-    return 0; // Minimal process callback
+    // arg is the client generation; a client the watchdog abandoned may
+    // still be running cycles
+    if (reinterpret_cast<uintptr_t>(arg) != g_jackClientGeneration.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    g_rtProcessors.run(nframes);
+    return 0;
 }
 
 void jackShutdownCallback(void* arg) {
     LOG_WARN("JACK server shutdown detected");
     g_jackRunning = false;
+    g_graphGeneration++;
+    g_graphChanged.notify_all();
+}
+
+// Graph change notifications invalidate the cached snapshot and wake
+// whoever waits on g_graphChanged
+void jackPortRegistrationCallback(jack_port_id_t port, int registered, void* arg) {
+    g_graphGeneration++;
+    g_graphChanged.notify_all();
+}
+
+void jackPortConnectCallback(jack_port_id_t a, jack_port_id_t b, int connected, void* arg) {
+    g_graphGeneration++;
+    g_graphChanged.notify_all();
 }
 
-// JACK connection management
+using GraphPtr = std::shared_ptr<const GraphSnapshot>;
+
+// Deadline for the JACK calls the current thread makes. An HTTP request
+// sets one for its whole lifetime (see RequestContext) so a handler making
+// several calls still answers within jack_timeout_ms; other threads get that
+// budget per call.
+thread_local std::chrono::steady_clock::time_point t_jackDeadline{};
+thread_local bool t_jackClientDeadline = false; // t_jackDeadline is the client's X-Request-Timeout-Ms
+thread_local bool t_jackTimedOut = false;
+thread_local bool t_jackRejected = false;      // the circuit breaker turned a call away
+
+// The one thread that calls into libjack. Work is queued as closures and
+// run in batches: whatever piled up while the previous batch ran is taken
+// in one go, so a burst of mutations costs a single wakeup. Callers wait on
+// a future with a deadline instead of on a lock, so a JACK server that
+// stops answering costs them a timeout rather than a hung thread. If a
+// call never returns, replaceWorker() abandons the thread and starts
+// another; the tasks it had not started yet move to the new one. A task
+// may carry its caller's deadline: if that has passed by the time the task
+// comes up, nobody is waiting for it any more and it is dropped unrun.
+class JackExecutor {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    struct Stats {
+        uint64_t tasks = 0;
+        uint64_t batches = 0;
+        size_t largestBatch = 0;
+        size_t queued = 0;
+        uint64_t timeouts = 0;
+        uint64_t dropped = 0;       // deadline passed before the task started
+        uint64_t restarts = 0;
+        uint64_t busyMs = 0;        // age of the task running now; 0 when idle
+    };
+    
+    ~JackExecutor() { stop(); }
+    
+    void start() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (!worker) launch();
+    }
+    
+    // Joins the worker unless it is stuck in libjack; queued tasks are
+    // dropped, which breaks their promises
+    void stop() {
+        std::shared_ptr<Worker> stopping;
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            stopping = std::move(worker);
+            queue.clear();
+        }
+        if (!stopping) return;
+        stopping->abandoned = true;
+        wake.notify_all();
+        if (busyMs(*stopping) > 1000) {
+            stopping->thread.detach();
+        } else {
+            stopping->thread.join();
+        }
+    }
+    
+    // A dropped task breaks its promise
+    template <typename Fn>
+    auto submit(Fn fn, Clock::time_point deadline = {}) -> std::future<decltype(fn())> {
+        using Result = decltype(fn());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(fn));
+        std::future<Result> result = task->get_future();
+        post([task] { (*task)(); }, deadline);
+        return result;
+    }
+    
+    // Queues a task nobody waits for; it reports back on its own. With no
+    // deadline it always runs.
+    void post(std::function<void()> task, Clock::time_point deadline = {}) {
+        uint32_t requestId = trace_detail::t_requestId;
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            queue.push_back(Task{[task = std::move(task), requestId] {
+                RequestTraceScope scope(requestId, nullptr);
+                task();
+            }, deadline});
+        }
+        wake.notify_one();
+    }
+    
+    static bool onExecutor() { return t_worker != nullptr; }
+    
+    // False on the executor thread once it has been abandoned: whatever it
+    // was doing must not touch shared state any more
+    static bool current() { return !t_worker || !t_worker->abandoned; }
+    
+    // How long the running task has been going
+    std::chrono::milliseconds busyFor() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        return std::chrono::milliseconds(worker ? busyMs(*worker) : 0);
+    }
+    
+    // first runs on the new thread before anything already queued
+    void replaceWorker(std::function<void()> first) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (worker) {
+            worker->abandoned = true;
+            worker->thread.detach();
+        }
+        queue.push_front(Task{std::move(first), {}});
+        stats.restarts++;
+        launch();
+        wake.notify_all();
+    }
+    
+    void countTimeout() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        stats.timeouts++;
+    }
+    
+    Stats inspect() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        Stats copy = stats;
+        copy.queued = queue.size();
+        copy.busyMs = worker ? busyMs(*worker) : 0;
+        return copy;
+    }
+
+private:
+    struct Task {
+        std::function<void()> run;
+        Clock::time_point deadline;     // epoch = none
+    };
+    
+    struct Worker {
+        std::thread thread;
+        std::atomic<bool> abandoned{false};
+        std::atomic<Clock::rep> busySince{0};   // 0 when idle
+    };
+    
+    static inline thread_local Worker* t_worker = nullptr;
+    
+    static uint64_t busyMs(const Worker& w) {
+        Clock::rep since = w.busySince.load();
+        if (since == 0) return 0;
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            Clock::now() - Clock::time_point(Clock::duration(since))).count());
+    }
+    
+    // Caller holds mutex
+    void launch() {
+        auto next = std::make_shared<Worker>();
+        next->thread = std::thread([this, next] { run(next); });
+        worker = next;
+    }
+    
+    void run(std::shared_ptr<Worker> self) {
+        t_worker = self.get();
+        std::vector<Task> batch;
+        uint64_t dropped = 0;
+        for (;;) {
+            {
+                std::unique_lock<InstrumentedMutex> lock(mutex);
+                stats.dropped += dropped;
+                dropped = 0;
+                wake.wait(lock, [&] { return self->abandoned || !queue.empty(); });
+                if (self->abandoned) return;
+                batch.assign(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.end()));
+                queue.clear();
+                stats.batches++;
+                stats.tasks += batch.size();
+                stats.largestBatch = std::max(stats.largestBatch, batch.size());
+            }
+            
+            size_t done = 0;
+            while (done < batch.size() && !self->abandoned) {
+                Task& task = batch[done++];
+                Clock::time_point now = Clock::now();
+                if (task.deadline != Clock::time_point{} && now >= task.deadline) {
+                    dropped++;
+                    continue;
+                }
+                self->busySince = now.time_since_epoch().count();
+                task.run();
+            }
+            self->busySince = 0;
+            
+            if (self->abandoned) {
+                // Hand what we never started to the replacement, ahead of
+                // anything queued since
+                std::lock_guard<InstrumentedMutex> lock(mutex);
+                stats.dropped += dropped;
+                queue.insert(queue.begin(), std::make_move_iterator(batch.begin() + done),
+                             std::make_move_iterator(batch.end()));
+                wake.notify_all();
+                return;
+            }
+            batch.clear();
+        }
+    }
+    
+    // Named "jack" so /stats/locks keeps showing contention for JACK access
+    InstrumentedMutex mutex{"jack"};
+    std::condition_variable_any wake;
+    std::deque<Task> queue;
+    std::shared_ptr<Worker> worker;
+    Stats stats;
+};
+
+struct JackInfo {
+    jack_nframes_t sampleRate = 0;
+    jack_nframes_t bufferSize = 0;
+    char clientName[128] = {0};
+};
+
+// JACK connection management. Every libjack call runs on the executor
+// thread; the public methods queue it and wait until the caller's deadline,
+// answering with a neutral value (and setting t_jackTimedOut) if it passes.
+// A circuit breaker watches those waits: once JACK keeps timing out or
+// answering slowly, calls get the neutral value at once (and set
+// t_jackRejected) instead of queueing, until a probe call gets through.
 class JackManager {
 public:
+    JackManager() {
+        CircuitBreaker::Options options;
+        options.failureThreshold = static_cast<uint32_t>(g_config.jackBreakerFailures);
+        options.slowCall = std::chrono::milliseconds(g_config.jackBreakerSlowMs);
+        options.openFor = std::chrono::milliseconds(g_config.jackBreakerOpenMs);
+        breaker.configure(options);
+        executor.start();
+    }
+    
     bool initialize() {
-        std::lock_guard<std::mutex> lock(g_jackMutex);
+        return call(false, [this] { return openClient(); });
+    }
+    
+    void shutdown() {
+        call(false, [] {
+            if (g_jackClient) {
+                jack_client_close(g_jackClient);
+                if (!JackExecutor::current()) return false;
+                g_jackClient = nullptr;
+                g_jackRunning = false;
+                g_graphGeneration++;
+                g_rtProcessors.clear(); // their ports died with the client
+                LOG_INFO("JACK client closed");
+            }
+            return true;
+        });
+    }
+    
+    bool isRunning() {
+        return call(false, [] {
+            if (!g_jackClient) {
+                return false;
+            }
+            
+            // Test JACK responsiveness
+            TraceSpan span("jack_status");
+            try {
+                jack_nframes_t sr = jack_get_sample_rate(g_jackClient);
+                g_jackRunning = (sr > 0);
+                return g_jackRunning.load();
+            } catch (...) {
+                g_jackRunning = false;
+                return false;
+            }
+        });
+    }
+    
+    // Ports and connections come from a cached snapshot that is rebuilt only
+    // when a JACK graph callback (or one of our own mutations) has bumped
+    // g_graphGeneration. Readers share the snapshot without copying it.
+    GraphPtr getGraph() {
+        GraphPtr graph = call(GraphPtr(), [this] {
+            GraphPtr fresh = refreshGraph();
+            if (g_jackClient && JackExecutor::current()) {
+                std::lock_guard<InstrumentedMutex> lock(knownMutex);
+                known = {fresh, std::chrono::steady_clock::now()};
+            }
+            return fresh;
+        });
+        return graph ? graph : std::make_shared<const GraphSnapshot>();
+    }
+    
+    // The last graph read from an open client and when, kept so readers
+    // have something to show while JACK is down or not answering; null
+    // until the first successful read
+    struct KnownGraph {
+        GraphPtr graph;
+        std::chrono::steady_clock::time_point at;
+    };
+    KnownGraph lastKnownGraph() {
+        std::lock_guard<InstrumentedMutex> lock(knownMutex);
+        return known;
+    }
+    
+    bool connectPorts(const char* from, const char* to) {
+        return call(false, [from = std::string(from), to = std::string(to)] {
+            return connectNow(from.c_str(), to.c_str());
+        });
+    }
+    
+    bool disconnectPorts(const char* from, const char* to) {
+        return call(false, [from = std::string(from), to = std::string(to)] {
+            return disconnectNow(from.c_str(), to.c_str());
+        });
+    }
+    
+    // A whole list in one executor task; results line up with edges and an
+    // edge with an empty name fails
+    std::vector<uint8_t> setConnections(std::vector<std::pair<PortName, PortName>> edges, bool connect) {
+        size_t count = edges.size();
+        std::vector<uint8_t> done = call(std::vector<uint8_t>(), [edges = std::move(edges), connect] {
+            std::vector<uint8_t> results;
+            results.reserve(edges.size());
+            for (const auto& [from, to] : edges) {
+                bool ok = !from.empty() && !to.empty() &&
+                          (connect ? connectNow(from.c_str(), to.c_str()) : disconnectNow(from.c_str(), to.c_str()));
+                results.push_back(ok ? 1 : 0);
+            }
+            return results;
+        });
+        done.resize(count, 0);
+        return done;
+    }
+    
+    int clearAllConnections() {
+        return call(0, [this] {
+            jack_client_t* client = g_jackClient;
+            if (!client) return 0;
+            
+            GraphPtr graph = refreshGraph();
+            int cleared = 0;
+            
+            TraceSpan span("jack_clear");
+            for (const auto& edge : graph->edges) {
+                if (!JackExecutor::current()) return 0;
+                if (jack_disconnect(client, graph->fromName(edge).c_str(), graph->toName(edge).c_str()) == 0) {
+                    cleared++;
+                }
+            }
+            
+            if (!JackExecutor::current()) return 0;
+            if (cleared > 0) {
+                g_graphGeneration++;
+            }
+            LOG_INFO("Cleared " + std::to_string(cleared) + " connections");
+            return cleared;
+        });
+    }
+    
+    // Removes every connection of one port, in both directions, found
+    // through the snapshot's adjacency lists; -1 if there is no such port
+    int disconnectPort(const char* name) {
+        return call(-1, [this, name = std::string(name)] {
+            jack_client_t* client = g_jackClient;
+            if (!client) return -1;
+            
+            GraphPtr graph = refreshGraph();
+            uint32_t port = graph->findPort(name);
+            if (port == GraphSnapshot::kNoPort) return -1;
+            
+            TraceSpan span("jack_disconnect_port");
+            int disconnected = 0;
+            auto drop = [&](const PortEdge& edge) {
+                if (JackExecutor::current() &&
+                    jack_disconnect(client, graph->fromName(edge).c_str(), graph->toName(edge).c_str()) == 0) {
+                    disconnected++;
+                }
+            };
+            for (const PortEdge& edge : graph->outgoing(port)) drop(edge);
+            for (uint32_t index : graph->incoming(port)) drop(graph->edges[index]);
+            
+            if (!JackExecutor::current()) return -1;
+            if (disconnected > 0) {
+                g_graphGeneration++;
+            }
+            LOG_INFO("Disconnected " + std::to_string(disconnected) + " connections from " + name);
+            return disconnected;
+        });
+    }
+    
+    // Registers a port owned by the bridge (for RT processors). The client
+    // generation it belongs to is returned so a stale handle from before a
+    // JACK restart is never passed back to libjack.
+    jack_port_t* registerPort(const char* shortName, unsigned long flags, uint64_t& generation,
+                              const char* type = JACK_DEFAULT_AUDIO_TYPE) {
+        using Registered = std::pair<jack_port_t*, uint64_t>;
+        Registered registered = call(Registered{nullptr, 0},
+            [name = std::string(shortName), flags, type = std::string(type)] {
+                if (!g_jackClient) return Registered{nullptr, 0};
+                
+                jack_port_t* port = jack_port_register(g_jackClient, name.c_str(), type.c_str(), flags, 0);
+                if (!port) {
+                    LOG_ERROR("Failed to register port: " + name);
+                    return Registered{nullptr, 0};
+                }
+                g_graphGeneration++;
+                return Registered{port, g_jackClientGeneration.load()};
+            });
+        if (registered.first) {
+            generation = registered.second;
+        }
+        return registered.first;
+    }
+    
+    void unregisterPort(jack_port_t* port, uint64_t generation) {
+        call(false, [port, generation] {
+            if (!g_jackClient || !port || generation != g_jackClientGeneration.load()) return false;
+            
+            jack_port_unregister(g_jackClient, port);
+            g_graphGeneration++;
+            return true;
+        });
+    }
+    
+    jack_nframes_t sampleRate() {
+        return call(jack_nframes_t(0), [] {
+            return g_jackClient ? jack_get_sample_rate(g_jackClient) : jack_nframes_t(0);
+        });
+    }
+    
+    // Latency JACK reports for a port (JackCaptureLatency or
+    // JackPlaybackLatency), as the maximum of its range; 0 if unknown
+    jack_nframes_t portLatency(const char* name, jack_latency_callback_mode_t mode) {
+        return call(jack_nframes_t(0), [name = std::string(name), mode] {
+            if (!g_jackClient) return jack_nframes_t(0);
+            jack_port_t* port = jack_port_by_name(g_jackClient, name.c_str());
+            if (!port) return jack_nframes_t(0);
+            jack_latency_range_t range{0, 0};
+            jack_port_get_latency_range(port, mode, &range);
+            return range.max;
+        });
+    }
+    
+    JackInfo getJackInfo() {
+        return call(JackInfo(), [] {
+            JackInfo info;
+            
+            if (!g_jackClient) return info;
+            
+            TraceSpan span("jack_info");
+            info.sampleRate = jack_get_sample_rate(g_jackClient);
+            info.bufferSize = jack_get_buffer_size(g_jackClient);
+            strncpy_s(info.clientName, jack_get_client_name(g_jackClient), sizeof(info.clientName) - 1);
+            return info;
+        });
+    }
+    
+    // Called once a second from the service loop. A libjack call that has
+    // not returned within jack_watchdog_ms means the server (or our client
+    // inside it) is wedged. Neither the thread nor the client can be closed
+    // safely, so both are abandoned and a fresh client is opened on a new
+    // executor thread before it runs anything else that was queued; managers
+    // re-create their ports when they see the client generation change.
+    void watchdog() {
+        std::chrono::milliseconds busy = executor.busyFor();
+        if (busy.count() < g_config.jackWatchdogMs) return;
+        
+        LOG_ERROR("JACK call stuck for " + std::to_string(busy.count()) +
+                  " ms; abandoning the client and reconnecting");
+        executor.replaceWorker([this] {
+            g_jackClient = nullptr;     // leaked on purpose
+            g_jackRunning = false;
+            g_jackClientGeneration++;   // its process callback now returns at once
+            g_graphGeneration++;
+            g_rtProcessors.clear();
+            if (openClient()) {
+                LOG_INFO("JACK client reopened after the watchdog fired");
+            }
+        });
+    }
+    
+    JackExecutor::Stats executorStats() { return executor.inspect(); }
+    
+    // For coroutines, which cannot block on call(): task runs on the
+    // executor, where the methods above run inline, and must hand its
+    // result back itself. The caller keeps its own deadline and reports a
+    // miss with countTimeout(); the task is dropped unrun if it only comes
+    // up after that deadline.
+    void post(std::function<void()> task, std::chrono::steady_clock::time_point deadline) {
+        executor.post(std::move(task), deadline);
+    }
+    void countTimeout() { executor.countTimeout(); }
+    
+    // Coroutines ask before they post and report how the wait ended
+    CircuitBreaker::Admission admit() { return breaker.admit(); }
+    // A call cut short by the client's own deadline, before the slow-call
+    // threshold, says nothing about JACK: only jack_timeout_ms and
+    // jack_breaker_slow_ms judge it, so the breaker counts it neither way
+    void record(CircuitBreaker::Admission admission, bool completed, std::chrono::steady_clock::duration elapsed,
+                bool clientDeadline) {
+        if (!completed && clientDeadline && elapsed <= std::chrono::milliseconds(g_config.jackBreakerSlowMs)) {
+            breaker.release(admission);
+            return;
+        }
+        breaker.record(admission, completed, elapsed);
+    }
+    CircuitBreaker::Stats circuit() { return breaker.inspect(); }
+
+private:
+    JackExecutor executor;
+    CircuitBreaker breaker{"jack_breaker"};
+    GraphPtr graphCache;
+    std::shared_ptr<GraphSnapshot> graphSpare;
+    InstrumentedMutex knownMutex{"jack_known_graph"};
+    KnownGraph known;
+    
+    // Queues fn on the executor and waits for it until the thread's
+    // deadline; fallback is returned if that passes, the task is dropped or
+    // the breaker is open. Once a request has timed out or been turned away
+    // its remaining calls fail immediately instead of queueing behind the
+    // stuck one; threads without a request scope start afresh each call. On
+    // the executor itself (a task handed over with post()) fn simply runs.
+    template <typename Result, typename Fn>
+    Result call(Result fallback, Fn fn) {
+        if (JackExecutor::onExecutor()) return fn();
+        
+        bool scoped = t_jackDeadline != std::chrono::steady_clock::time_point{};
+        if (scoped && (t_jackTimedOut || t_jackRejected)) return fallback;
+        if (!scoped) {
+            t_jackTimedOut = false;
+            t_jackRejected = false;
+        }
+        
+        CircuitBreaker::Admission admission = breaker.admit();
+        if (admission == CircuitBreaker::Admission::Rejected) {
+            t_jackRejected = true;
+            return fallback;
+        }
+        
+        auto started = std::chrono::steady_clock::now();
+        auto deadline = scoped ? t_jackDeadline : started + std::chrono::milliseconds(g_config.jackTimeoutMs);
+        std::future<Result> result = executor.submit(std::move(fn), deadline);
+        TraceSpan wait("jack_wait");
+        bool completed = result.wait_until(deadline) == std::future_status::ready;
+        record(admission, completed, std::chrono::steady_clock::now() - started, scoped && t_jackClientDeadline);
+        if (!completed) {
+            t_jackTimedOut = true;
+            executor.countTimeout();
+            return fallback;
+        }
+        try {
+            return result.get();
+        } catch (const std::future_error&) {
+            return fallback;
+        }
+    }
+    
+    // Executor thread only
+    static bool connectNow(const char* from, const char* to) {
+        jack_client_t* client = g_jackClient;
+        if (!client) {
+            LOG_ERROR("JACK client not available for connection");
+            return false;
+        }
+        
+        TraceSpan span("jack_connect");
+        int result = jack_connect(client, from, to);
+        span.end();
+        
+        if (!JackExecutor::current()) {
+            return false; // abandoned mid-call; the new client owns the graph now
+        }
+        if (result == 0) {
+            g_graphGeneration++;
+            LOG_INFO(std::string("Connected: ") + from + " -> " + to);
+            return true;
+        } else if (result == EEXIST) {
+            LOG_DEBUG(std::string("Connection already exists: ") + from + " -> " + to);
+            return true; // Consider already connected as success
+        } else {
+            LOG_ERROR(std::string("Failed to connect: ") + from + " -> " + to);
+            return false;
+        }
+    }
+    
+    // Executor thread only
+    static bool disconnectNow(const char* from, const char* to) {
+        jack_client_t* client = g_jackClient;
+        if (!client) {
+            LOG_ERROR("JACK client not available for disconnection");
+            return false;
+        }
+        
+        TraceSpan span("jack_disconnect");
+        int result = jack_disconnect(client, from, to);
+        span.end();
         
+        if (!JackExecutor::current()) {
+            return false; // abandoned mid-call; the new client owns the graph now
+        }
+        if (result == 0) {
+            g_graphGeneration++;
+            LOG_INFO(std::string("Disconnected: ") + from + " -> " + to);
+            return true;
+        } else {
+            LOG_ERROR(std::string("Failed to disconnect: ") + from + " -> " + to);
+            return false;
+        }
+    }
+    
+    // Executor thread only
+    bool openClient() {
         if (g_jackClient) {
             return true; // Already initialized
         }
         
+        // The process callback gets the generation this client will
+        // have, so the RT thread of an abandoned client does nothing
+        uint64_t generation = g_jackClientGeneration.load() + 1;
         jack_status_t status;
-        g_jackClient = jack_client_open("jack-bridge-local", JackNoStartServer, &status);
+        jack_client_t* client = jack_client_open("jack-bridge-local", JackNoStartServer, &status);
         
-        if (!g_jackClient) {
+        if (!client) {
             LOG_ERROR("Failed to connect to JACK server");
             return false;
         }
+        if (!JackExecutor::current()) {
+            return false; // the watchdog gave up on us; leave the client be
+        }
+        g_jackClient = client;
+        
+        if (jack_port_name_size() > static_cast<int>(PortName::kMaxLength + 1)) {
+            LOG_WARN("JACK port names may exceed " + std::to_string(PortName::kMaxLength) +
+                     " characters; longer names will be skipped");
+        }
         
         // Set callbacks
-        jack_set_process_callback(g_jackClient, jackProcessCallback, nullptr);
+        jack_set_process_callback(g_jackClient, jackProcessCallback,
+                                  reinterpret_cast<void*>(static_cast<uintptr_t>(generation)));
         jack_on_shutdown(g_jackClient, jackShutdownCallback, nullptr);
+        jack_set_port_registration_callback(g_jackClient, jackPortRegistrationCallback, nullptr);
+        jack_set_port_connect_callback(g_jackClient, jackPortConnectCallback, nullptr);
         
         // Activate client
         if (jack_activate(g_jackClient) != 0) {
@@ -130,481 +873,6289 @@ public:
         }
         
         g_jackRunning = true;
+        g_graphGeneration++;
+        g_jackClientGeneration = generation;
         LOG_INFO("JACK client activated successfully");
         return true;
     }
     
-    void shutdown() {
-        std::lock_guard<std::mutex> lock(g_jackMutex);
+    // Executor thread only. A snapshot collected by an abandoned executor
+    // is returned to its caller but never published.
+    GraphPtr refreshGraph() {
+        jack_client_t* client = g_jackClient;
+        uint64_t generation = g_graphGeneration.load();
+        if (graphCache && graphCache->generation == generation) {
+            return graphCache;
+        }
         
-        if (g_jackClient) {
-            jack_client_close(g_jackClient);
-            g_jackClient = nullptr;
-            g_jackRunning = false;
-            LOG_INFO("JACK client closed");
+        // Rebuild into the spare snapshot when no reader still holds it, so
+        // steady-state refreshes reuse the previous vectors' capacity.
+        TraceSpan span("graph_refresh");
+        std::shared_ptr<GraphSnapshot> next;
+        if (graphSpare && graphSpare.use_count() == 1) {
+            next = std::move(graphSpare);
+        } else {
+            next = std::make_shared<GraphSnapshot>();
+        }
+        next->clear();
+        collectGraph(client, *next);
+        next->generation = generation;
+        if (!JackExecutor::current()) {
+            return next;
+        }
+        
+        graphSpare = std::const_pointer_cast<GraphSnapshot>(std::move(graphCache));
+        graphCache = std::move(next);
+        return graphCache;
+    }
+    
+    static void collectGraph(jack_client_t* client, GraphSnapshot& graph) {
+        if (!client) return;
+        
+        const char** jackPorts = jack_get_ports(client, nullptr, nullptr, 0);
+        if (!jackPorts) return;
+        
+        for (int i = 0; jackPorts[i]; i++) {
+            PortName name;
+            if (name.assign(jackPorts[i])) {
+                graph.ports.push_back(name);
+            }
+        }
+        jack_free(jackPorts);
+        graph.buildIndex();
+        
+        for (uint32_t from = 0; from < graph.ports.size(); from++) {
+            jack_port_t* port = jack_port_by_name(client, graph.ports[from].c_str());
+            if (!port || !(jack_port_flags(port) & JackPortIsOutput)) continue;
+            
+            const char** connectedPorts = jack_port_get_all_connections(client, port);
+            if (!connectedPorts) continue;
+            
+            for (int j = 0; connectedPorts[j]; j++) {
+                uint32_t to = graph.findPort(connectedPorts[j]);
+                if (to != GraphSnapshot::kNoPort) {
+                    graph.edges.push_back({from, to});
+                }
+            }
+            jack_free(connectedPorts);
+        }
+        graph.buildAdjacency();
+    }
+};
+
+// <prefix>-YYYYmmdd-HHMMSS-<id>.wav
+std::string timestampedFileName(const char* prefix, int id) {
+    auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    char stamp[32];
+    struct tm tm_buf;
+    if (localtime_s(&tm_buf, &now) == 0) {
+        strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_buf);
+    } else {
+        strcpy_s(stamp, "unknown");
+    }
+    return std::string(prefix) + "-" + stamp + "-" + std::to_string(id) + ".wav";
+}
+
+// Output files always land under record_dir, which is created on demand.
+// The name comes from the API, so absolute paths, drive or root names and
+// ".." components are refused rather than resolved.
+bool outputPath(const std::string& file, std::filesystem::path& path, std::string& error) {
+    std::filesystem::path name(file);
+    bool escapes = name.empty() || name.has_root_name() || name.has_root_directory() || !name.has_filename();
+    for (const auto& part : name) {
+        if (part == "..") escapes = true;
+    }
+    if (escapes) {
+        error = "File must be a relative name inside record_dir";
+        return false;
+    }
+    path = (std::filesystem::path(g_config.recordDir) / name).lexically_normal();
+    std::error_code ec;
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), ec);
+    }
+    return true;
+}
+
+// Disk recordings of bridge-owned capture ports (see /record endpoints)
+class RecordingManager {
+public:
+    struct Summary {
+        int id = 0;
+        std::string file;
+        size_t channels = 0;
+        uint64_t frames = 0;
+        uint32_t sampleRate = 0;
+        uint64_t overruns = 0;
+        uint64_t overrunFrames = 0;
+        bool writeFailed = false;
+    };
+    
+    explicit RecordingManager(JackManager* jm) : jackManager(jm) {}
+    
+    ~RecordingManager() {
+        stopAll();
+    }
+    
+    // Returns the new recording id, or 0 with error set
+    int start(const std::vector<PortName>& sources, std::string file, std::string& error) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        
+        jack_nframes_t sampleRate = jackManager->sampleRate();
+        if (sampleRate == 0) {
+            error = "JACK not running";
+            return 0;
+        }
+        
+        auto entry = std::make_unique<Entry>();
+        entry->id = nextId++;
+        entry->sources = sources;
+        
+        std::filesystem::path path;
+        if (!outputPath(file.empty() ? timestampedFileName("rec", entry->id) : file, path, error)) {
+            return 0;
+        }
+        
+        for (size_t ch = 0; ch < sources.size(); ch++) {
+            std::string shortName = "rec" + std::to_string(entry->id) + "_" + std::to_string(ch + 1);
+            jack_port_t* port = jackManager->registerPort(shortName.c_str(), JackPortIsInput, entry->clientGeneration);
+            if (!port) {
+                releasePorts(*entry);
+                error = "Failed to register capture port";
+                return 0;
+            }
+            entry->ports.push_back(port);
+            
+            if (!jackManager->connectPorts(sources[ch].c_str(), jack_port_name(port))) {
+                releasePorts(*entry);
+                error = std::string("Cannot capture from ") + sources[ch].c_str();
+                return 0;
+            }
+        }
+        
+        entry->recording = std::make_unique<Recording>(entry->ports, sampleRate);
+        if (!entry->recording->start(path.string())) {
+            releasePorts(*entry);
+            error = "Cannot open " + path.string();
+            return 0;
+        }
+        
+        if (!g_rtProcessors.add(entry->recording.get())) {
+            entry->recording->stop();
+            releasePorts(*entry);
+            error = "Too many active RT processors";
+            return 0;
+        }
+        
+        LOG_INFO("Recording " + std::to_string(entry->id) + " started: " + path.string() +
+                 " (" + std::to_string(sources.size()) + " channels)");
+        int id = entry->id;
+        entries[id] = std::move(entry);
+        return id;
+    }
+    
+    bool stop(int id, Summary& summary) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        
+        auto it = entries.find(id);
+        if (it == entries.end()) {
+            return false;
+        }
+        
+        std::unique_ptr<Entry> entry = std::move(it->second);
+        entries.erase(it);
+        finish(std::move(entry), summary);
+        return true;
+    }
+    
+    void stopAll() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        
+        for (auto& item : entries) {
+            Summary summary;
+            finish(std::move(item.second), summary);
+        }
+        entries.clear();
+    }
+    
+    // Called once a second from the service loop: reports new overruns and
+    // finalizes recordings whose JACK client has gone away.
+    void poll() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        
+        for (auto it = entries.begin(); it != entries.end();) {
+            Entry& entry = *it->second;
+            uint64_t overruns = entry.recording->overruns();
+            if (overruns > entry.reportedOverruns) {
+                LOG_WARN("Recording " + std::to_string(entry.id) + ": " +
+                         std::to_string(overruns - entry.reportedOverruns) +
+                         " overrun(s), disk writer is falling behind");
+                entry.reportedOverruns = overruns;
+            }
+            
+            if (entry.clientGeneration != g_jackClientGeneration.load()) {
+                LOG_WARN("Recording " + std::to_string(entry.id) + " stopped: JACK client restarted");
+                Summary summary;
+                std::unique_ptr<Entry> lost = std::move(it->second);
+                it = entries.erase(it);
+                finish(std::move(lost), summary);
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        for (const auto& item : entries) {
+            fn(item.first, item.second->sources, *item.second->recording);
+        }
+    }
+    
+private:
+    struct Entry {
+        int id = 0;
+        std::vector<PortName> sources;
+        std::vector<jack_port_t*> ports;
+        uint64_t clientGeneration = 0;
+        uint64_t reportedOverruns = 0;
+        std::unique_ptr<Recording> recording;
+    };
+    
+    void finish(std::unique_ptr<Entry> entry, Summary& summary) {
+        Recording& recording = *entry->recording;
+        if (!retireRtProcessor(entry->recording, "Recording " + std::to_string(entry->id))) {
+            return;
+        }
+        
+        recording.stop();
+        summary.id = entry->id;
+        summary.file = recording.path();
+        summary.channels = recording.channels();
+        summary.frames = recording.writtenFrames();
+        summary.sampleRate = recording.sampleRate();
+        summary.overruns = recording.overruns();
+        summary.overrunFrames = recording.overrunFrames();
+        summary.writeFailed = recording.writeFailed();
+        releasePorts(*entry);
+        
+        LOG_INFO("Recording " + std::to_string(summary.id) + " stopped: " + summary.file + ", " +
+                 std::to_string(summary.frames) + " frames, " + std::to_string(summary.overruns) + " overruns");
+    }
+    
+    void releasePorts(Entry& entry) {
+        for (jack_port_t* port : entry.ports) {
+            jackManager->unregisterPort(port, entry.clientGeneration);
+        }
+        entry.ports.clear();
+    }
+    
+    JackManager* jackManager;
+    InstrumentedMutex mutex{"recordings"};
+    std::map<int, std::unique_ptr<Entry>> entries;
+    int nextId = 1;
+};
+
+// Retroactive capture of a fixed set of inputs (see /replay endpoints). The
+// last settings armed are remembered so the buffer comes back by itself
+// after a JACK restart.
+class ReplayManager {
+public:
+    struct Settings {
+        std::vector<PortName> sources;
+        double seconds = 300;
+        bool compress = true;
+        size_t storeBytes = 0;  // 0: 60% of the raw window
+    };
+    
+    static constexpr double kMaxSeconds = 3600;
+    static constexpr size_t kMaxChannels = 32;
+    
+    explicit ReplayManager(JackManager* jm) : jackManager(jm) {}
+    
+    ~ReplayManager() {
+        disarm();
+    }
+    
+    // Replaces any armed buffer. Memory is allocated here, once. With
+    // keepRetrying a failure is not final: poll() tries again every second.
+    bool arm(const Settings& requested, std::string& error, bool keepRetrying = false) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        
+        wanted = false;
+        release();
+        if (!validate(requested, error)) {
+            return false;
+        }
+        settings = requested;
+        bool armed = armLocked(error);
+        wanted = armed || keepRetrying;
+        lastError = error;
+        return armed;
+    }
+    
+    void disarm() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        wanted = false;
+        release();
+    }
+    
+    // Writes a window of the buffer to file (a name under record_dir); path
+    // receives where it went.
+    bool dump(double offsetSeconds, double seconds, std::string file,
+              std::string& path, uint64_t& frames, std::string& error) {
+        // The write runs unlocked on its own reference, so a slow disk does
+        // not hold up poll() or a re-arm; release() leaves it to finish.
+        std::shared_ptr<ReplayBuffer> armed;
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            if (!buffer) {
+                error = "Replay buffer not armed";
+                return false;
+            }
+            std::filesystem::path target;
+            if (!outputPath(file.empty() ? timestampedFileName("replay", ++dumpCount) : file, target, error)) {
+                return false;
+            }
+            path = target.string();
+            armed = buffer;
+        }
+        
+        TraceSpan span("replay_dump");
+        if (!armed->dump(offsetSeconds, seconds, path, frames, error)) {
+            return false;
+        }
+        LOG_INFO("Replay dump: " + path + ", " + std::to_string(frames) + " frames");
+        return true;
+    }
+    
+    // Calls fn(settings, buffer) while armed; returns whether it did
+    template <typename Fn>
+    bool inspect(Fn&& fn) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (!buffer) return false;
+        fn(static_cast<const Settings&>(settings), *buffer);
+        return true;
+    }
+    
+    // Called once a second from the service loop: drops a buffer whose JACK
+    // client went away and re-arms the remembered settings once JACK is back.
+    void poll() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        
+        if (buffer && clientGeneration != g_jackClientGeneration.load()) {
+            LOG_WARN("Replay buffer dropped: JACK client restarted");
+            release();
+        }
+        if (buffer || !wanted || !g_jackRunning) {
+            return;
+        }
+        
+        std::string error;
+        if (!armLocked(error) && error != lastError) {
+            LOG_WARN("Replay buffer not armed: " + error);
+            lastError = error;
+        }
+    }
+    
+    static size_t defaultStoreBytes(size_t channels, uint32_t sampleRate, double seconds) {
+        return static_cast<size_t>(seconds * sampleRate * channels * sizeof(float) * 0.6);
+    }
+    
+private:
+    static bool validate(const Settings& s, std::string& error) {
+        if (s.sources.empty() || s.sources.size() > kMaxChannels) {
+            error = "Replay needs 1-" + std::to_string(kMaxChannels) + " ports";
+            return false;
+        }
+        if (!(s.seconds > 0 && s.seconds <= kMaxSeconds)) {
+            error = "Replay window must be 0-" + std::to_string(static_cast<int>(kMaxSeconds)) + " seconds";
+            return false;
+        }
+        if (s.compress && s.storeBytes != 0 && s.storeBytes < ReplayBuffer::minimumStoreBytes(s.sources.size())) {
+            error = "Replay memory budget too small";
+            return false;
+        }
+        if (s.storeBytes > UINT32_MAX) {
+            error = "Replay memory budget must be under 4 GiB";
+            return false;
+        }
+        return true;
+    }
+    
+    bool armLocked(std::string& error) {
+        jack_nframes_t sampleRate = jackManager->sampleRate();
+        if (sampleRate == 0) {
+            error = "JACK not running";
+            return false;
+        }
+        
+        clientGeneration = 0;
+        for (size_t ch = 0; ch < settings.sources.size(); ch++) {
+            std::string shortName = "replay_" + std::to_string(ch + 1);
+            jack_port_t* port = jackManager->registerPort(shortName.c_str(), JackPortIsInput, clientGeneration);
+            if (!port) {
+                releasePorts();
+                error = "Failed to register replay port";
+                return false;
+            }
+            ports.push_back(port);
+            
+            if (!jackManager->connectPorts(settings.sources[ch].c_str(), jack_port_name(port))) {
+                releasePorts();
+                error = std::string("Cannot capture from ") + settings.sources[ch].c_str();
+                return false;
+            }
+        }
+        
+        size_t storeBytes = settings.storeBytes;
+        if (settings.compress && storeBytes == 0) {
+            storeBytes = std::max(defaultStoreBytes(ports.size(), sampleRate, settings.seconds),
+                                  ReplayBuffer::minimumStoreBytes(ports.size()));
+            storeBytes = std::min<size_t>(storeBytes, UINT32_MAX);
+        }
+        
+        try {
+            buffer = std::make_shared<ReplayBuffer>(ports, sampleRate, settings.seconds, settings.compress, storeBytes);
+        } catch (const std::bad_alloc&) {
+            releasePorts();
+            error = "Not enough memory for the replay window";
+            return false;
+        }
+        buffer->start();
+        
+        if (!g_rtProcessors.add(buffer.get())) {
+            buffer.reset();
+            releasePorts();
+            error = "Too many active RT processors";
+            return false;
+        }
+        
+        lastError.clear();
+        ReplayBuffer::Stats stats = buffer->stats();
+        LOG_INFO("Replay buffer armed: " + std::to_string(ports.size()) + " channels, " +
+                 std::to_string(static_cast<int>(settings.seconds)) + " s, " +
+                 (settings.compress ? "compressed, " : "raw, ") +
+                 std::to_string(stats.memoryBytes / (1024 * 1024)) + " MiB");
+        return true;
+    }
+    
+    void release() {
+        ReplayBuffer* leaving = buffer.get();
+        if (!retireRtProcessor(buffer, "Replay buffer")) {
+            leaving->stop();
+        }
+        buffer.reset();
+        releasePorts();
+    }
+    
+    void releasePorts() {
+        for (jack_port_t* port : ports) {
+            jackManager->unregisterPort(port, clientGeneration);
+        }
+        ports.clear();
+    }
+    
+    JackManager* jackManager;
+    InstrumentedMutex mutex{"replay"};
+    Settings settings;
+    bool wanted = false;
+    std::string lastError;
+    std::vector<jack_port_t*> ports;
+    uint64_t clientGeneration = 0;
+    std::shared_ptr<ReplayBuffer> buffer;
+    int dumpCount = 0;
+};
+
+// Live monitoring streams (GET /stream). Streams share one MonitorTap; each
+// source port occupies a slot for as long as any stream uses it.
+class MonitorManager {
+public:
+    // One connected listener; owned by its connection thread
+    struct Session {
+        int id = 0;
+        std::vector<PortName> sources;
+        std::vector<size_t> slots;
+        MonitorTap* tap = nullptr;
+        uint64_t startAfter = 0;    // first frame every slot is known to carry
+        std::string format;
+        std::atomic<uint64_t> sentBytes{0};
+        std::atomic<uint64_t> droppedFrames{0};
+    };
+    
+    static constexpr size_t kMaxSessions = 16;
+    
+    explicit MonitorManager(JackManager* jm) : jackManager(jm) {}
+    
+    ~MonitorManager() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (tap) {
+            tap->close();
+        }
+    }
+    
+    bool attach(Session& session, std::string& error) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        
+        if (sessions.size() >= kMaxSessions) {
+            error = "Too many monitor streams";
+            return false;
+        }
+        if (tap && tap->closed()) {
+            error = "Monitor restarting, try again";
+            return false;
+        }
+        if (!tap && !createTap(error)) {
+            return false;
+        }
+        
+        for (const PortName& source : session.sources) {
+            size_t slot = acquireSlot(source, error);
+            if (slot == MonitorTap::kMaxSlots) {
+                releaseSlots(session);
+                destroyTapIfIdle();
+                return false;
+            }
+            session.slots.push_back(slot);
+        }
+        
+        session.id = nextId++;
+        session.tap = tap.get();
+        session.startAfter = tap->writeFrame();
+        sessions.push_back(&session);
+        LOG_INFO("Monitor stream " + std::to_string(session.id) + " started: " +
+                 std::to_string(session.sources.size()) + " port(s)");
+        return true;
+    }
+    
+    void detach(Session& session) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        
+        auto it = std::find(sessions.begin(), sessions.end(), &session);
+        if (it == sessions.end()) return;
+        sessions.erase(it);
+        
+        releaseSlots(session);
+        destroyTapIfIdle();
+        LOG_INFO("Monitor stream " + std::to_string(session.id) + " ended: " +
+                 std::to_string(session.sentBytes.load()) + " bytes, " +
+                 std::to_string(session.droppedFrames.load()) + " frames dropped");
+    }
+    
+    // Called once a second from the service loop: ends every stream once the
+    // JACK client behind the tap has gone away.
+    void poll() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (tap && !tap->closed() && clientGeneration != g_jackClientGeneration.load()) {
+            LOG_WARN("Monitor streams closed: JACK client restarted");
+            tap->close();
+            for (Slot& slot : slots) {
+                slot = Slot();
+            }
+            destroyTapIfIdle();
+        }
+    }
+    
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        for (const Session* session : sessions) {
+            fn(*session);
+        }
+    }
+    
+private:
+    struct Slot {
+        PortName source;
+        jack_port_t* port = nullptr;
+        int refs = 0;
+    };
+    
+    bool createTap(std::string& error) {
+        jack_nframes_t sampleRate = jackManager->sampleRate();
+        if (sampleRate == 0) {
+            error = "JACK not running";
+            return false;
+        }
+        tap = std::make_unique<MonitorTap>(sampleRate);
+        if (!g_rtProcessors.add(tap.get())) {
+            tap.reset();
+            error = "Too many active RT processors";
+            return false;
+        }
+        clientGeneration = g_jackClientGeneration.load();
+        return true;
+    }
+    
+    void destroyTapIfIdle() {
+        if (!tap || !sessions.empty()) return;
+        
+        retireRtProcessor(tap, "Monitor tap");
+        tap.reset();
+    }
+    
+    // Shares the slot already fed by source, or claims a free one
+    size_t acquireSlot(const PortName& source, std::string& error) {
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (slots[i].refs > 0 && slots[i].source == source) {
+                slots[i].refs++;
+                return i;
+            }
+        }
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (slots[i].refs > 0) continue;
+            
+            std::string shortName = "monitor_" + std::to_string(i + 1);
+            uint64_t generation = 0;
+            jack_port_t* port = jackManager->registerPort(shortName.c_str(), JackPortIsInput, generation);
+            if (!port) {
+                error = "Failed to register monitor port";
+                return MonitorTap::kMaxSlots;
+            }
+            if (!jackManager->connectPorts(source.c_str(), jack_port_name(port))) {
+                jackManager->unregisterPort(port, generation);
+                error = std::string("Cannot monitor ") + source.c_str();
+                return MonitorTap::kMaxSlots;
+            }
+            slots[i].source = source;
+            slots[i].port = port;
+            slots[i].refs = 1;
+            tap->setPort(i, port);
+            return i;
+        }
+        error = "Too many monitored ports";
+        return MonitorTap::kMaxSlots;
+    }
+    
+    void releaseSlots(Session& session) {
+        for (size_t index : session.slots) {
+            Slot& slot = slots[index];
+            if (slot.refs == 0 || --slot.refs > 0) continue;
+            
+            // Unregister only once the RT thread can no longer be reading the port
+            tap->setPort(index, nullptr);
+            if (g_rtProcessors.synchronize()) {
+                jackManager->unregisterPort(slot.port, clientGeneration);
+            }
+            slot = Slot();
+        }
+        session.slots.clear();
+    }
+    
+    JackManager* jackManager;
+    InstrumentedMutex mutex{"monitor"};
+    std::unique_ptr<MonitorTap> tap;
+    std::array<Slot, MonitorTap::kMaxSlots> slots;
+    std::vector<Session*> sessions;
+    uint64_t clientGeneration = 0;
+    int nextId = 1;
+};
+
+// Spectrum analysis of monitored ports (GET /spectrum). One worker thread
+// runs every analysis; an analysis lives while clients keep polling it and
+// publishes a new averaged spectrum at most kMaxUpdatesPerSecond.
+class SpectrumAnalyzer {
+public:
+    struct Params {
+        PortName port;
+        size_t size = 4096;
+        unsigned average = 8;
+        SpectrumWindow window = SpectrumWindow::Hann;
+        
+        bool operator==(const Params& other) const {
+            return port == other.port && size == other.size && average == other.average && window == other.window;
+        }
+    };
+    
+    struct Result {
+        uint64_t sequence = 0;
+        uint64_t averaged = 0;      // FFT frames folded in so far
+        uint32_t sampleRate = 0;
+        std::vector<float> db;
+    };
+    
+    static constexpr size_t kMaxAnalyses = 8;
+    static constexpr double kMaxUpdatesPerSecond = 10;
+    static constexpr std::chrono::seconds kIdleTimeout{30};
+    
+    explicit SpectrumAnalyzer(MonitorManager* m) : monitors(m) {}
+    
+    ~SpectrumAnalyzer() {
+        stop();
+    }
+    
+    void stop() {
+        if (worker.joinable()) {
+            running = false;
+            worker.join();
+        }
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        for (auto& analysis : analyses) {
+            monitors->detach(analysis->session);
+        }
+        analyses.clear();
+    }
+    
+    // Copies the newest spectrum for params, starting the analysis if needed.
+    // A new analysis is given time to fill its first FFT frame.
+    bool latest(const Params& params, Result& out, std::string& error) {
+        std::shared_ptr<Analysis> analysis = find(params, error);
+        if (!analysis) {
+            return false;
+        }
+        
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(analysis->resultMutex);
+                if (analysis->result.sequence > 0) {
+                    out = analysis->result;
+                    return true;
+                }
+            }
+            if (std::chrono::steady_clock::now() > deadline || analysis->session.tap->closed()) {
+                error = "No audio from port";
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+    
+private:
+    struct Analysis {
+        Params params;
+        MonitorManager::Session session;
+        std::unique_ptr<SpectrumAverager> averager;
+        std::vector<float> samples;     // sliding window of params.size frames
+        size_t filled = 0;
+        uint64_t cursor = 0;
+        bool started = false;
+        uint64_t published = 0;
+        std::chrono::steady_clock::time_point lastPublish;
+        std::atomic<int64_t> lastReadMs{0};
+        
+        std::mutex resultMutex;
+        Result result;
+    };
+    
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    
+    std::shared_ptr<Analysis> find(const Params& params, std::string& error) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        
+        for (auto& analysis : analyses) {
+            if (analysis->params == params && !analysis->session.tap->closed()) {
+                analysis->lastReadMs = nowMs();
+                return analysis;
+            }
+        }
+        if (analyses.size() >= kMaxAnalyses) {
+            error = "Too many spectrum analyses";
+            return nullptr;
+        }
+        
+        auto analysis = std::make_shared<Analysis>();
+        analysis->params = params;
+        analysis->session.sources.push_back(params.port);
+        analysis->session.format = "spectrum;size=" + std::to_string(params.size) +
+                                   ";average=" + std::to_string(params.average) +
+                                   ";window=" + spectrumWindowName(params.window);
+        if (!monitors->attach(analysis->session, error)) {
+            return nullptr;
+        }
+        analysis->averager = std::make_unique<SpectrumAverager>(params.size, params.window, params.average);
+        analysis->samples.assign(params.size, 0.0f);
+        analysis->lastReadMs = nowMs();
+        analyses.push_back(analysis);
+        
+        if (!worker.joinable()) {
+            running = true;
+            worker = std::thread(&SpectrumAnalyzer::workerLoop, this);
+        }
+        return analysis;
+    }
+    
+    void workerLoop() {
+        while (running) {
+            std::vector<std::shared_ptr<Analysis>> current;
+            {
+                std::lock_guard<InstrumentedMutex> lock(mutex);
+                int64_t idleBefore = nowMs() - std::chrono::milliseconds(kIdleTimeout).count();
+                for (auto it = analyses.begin(); it != analyses.end();) {
+                    Analysis& analysis = **it;
+                    if (analysis.lastReadMs.load() < idleBefore || analysis.session.tap->closed()) {
+                        monitors->detach(analysis.session);
+                        it = analyses.erase(it);
+                    } else {
+                        current.push_back(*it);
+                        ++it;
+                    }
+                }
+            }
+            
+            for (auto& analysis : current) {
+                analyse(*analysis);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    
+    // Folds every complete hop (half a frame, 50% overlap) into the average
+    void analyse(Analysis& a) {
+        MonitorTap& tap = *a.session.tap;
+        uint64_t newest = tap.writeFrame();
+        if (!a.started) {
+            if (newest > a.session.startAfter) {
+                a.cursor = newest;
+                a.started = true;
+            }
+            return;
+        }
+        
+        size_t size = a.params.size;
+        size_t hop = size / 2;
+        if (newest - a.cursor > tap.readableFrames()) {
+            uint64_t resume = newest - hop;
+            a.session.droppedFrames.fetch_add(resume - a.cursor, std::memory_order_relaxed);
+            a.cursor = resume;
+            a.filled = 0;
+        }
+        
+        while (newest - a.cursor >= hop) {
+            std::memmove(a.samples.data(), a.samples.data() + hop, (size - hop) * sizeof(float));
+            if (!tap.read(a.session.slots[0], a.cursor, hop, a.samples.data() + size - hop)) {
+                a.filled = 0;
+                a.cursor = newest;
+                break;
+            }
+            a.cursor += hop;
+            a.filled = std::min(size, a.filled + hop);
+            if (a.filled == size) {
+                a.averager->add(a.samples.data());
+            }
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        auto interval = std::chrono::duration<double>(1.0 / kMaxUpdatesPerSecond);
+        if (a.averager->frames() > a.published && now - a.lastPublish >= interval) {
+            std::lock_guard<std::mutex> lock(a.resultMutex);
+            a.averager->magnitudesDb(a.result.db);
+            a.result.sequence++;
+            a.result.averaged = a.averager->frames();
+            a.result.sampleRate = tap.sampleRate();
+            a.published = a.averager->frames();
+            a.lastPublish = now;
+        }
+    }
+    
+    MonitorManager* monitors;
+    InstrumentedMutex mutex{"spectrum"};
+    std::vector<std::shared_ptr<Analysis>> analyses;
+    std::thread worker;
+    std::atomic<bool> running{false};
+};
+
+// Loudness meters on monitored ports (see /loudness endpoints). One worker
+// thread measures every meter; readings are published through a seqlock so
+// readers never wait for it, and resets are requested with a flag the
+// worker picks up on its next pass.
+class LoudnessManager {
+public:
+    static constexpr size_t kMaxMeters = 8;
+    
+    struct Meter {
+        int id = 0;
+        std::string name;
+        MonitorManager::Session session;
+        std::unique_ptr<LoudnessMeter> meter;
+        SeqlockValue<LoudnessReading> published;
+        std::atomic<bool> resetRequested{false};
+        
+        // Worker state
+        uint64_t cursor = 0;
+        bool started = false;
+        std::vector<float> samples;
+    };
+    
+    explicit LoudnessManager(MonitorManager* m) : monitors(m) {}
+    
+    ~LoudnessManager() {
+        stopAll();
+    }
+    
+    // Returns the meter id, or 0 with error set
+    int start(const std::vector<PortName>& sources, std::string name, std::string& error) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        
+        if (meters.size() >= kMaxMeters) {
+            error = "Too many loudness meters";
+            return 0;
+        }
+        if (sources.empty() || sources.size() > LoudnessMeter::kMaxChannels) {
+            error = "Meters take 1-" + std::to_string(LoudnessMeter::kMaxChannels) + " ports";
+            return 0;
+        }
+        
+        auto entry = std::make_shared<Meter>();
+        entry->session.sources = sources;
+        entry->session.format = "loudness";
+        if (!monitors->attach(entry->session, error)) {
+            return 0;
+        }
+        entry->id = nextId++;
+        entry->name = name.empty() ? "meter" + std::to_string(entry->id) : std::move(name);
+        entry->meter = std::make_unique<LoudnessMeter>(entry->session.tap->sampleRate(), sources.size());
+        entry->samples.resize(kChunkFrames * sources.size());
+        entry->published.store(LoudnessReading());
+        meters.push_back(entry);
+        
+        if (!worker.joinable()) {
+            running = true;
+            worker = std::thread(&LoudnessManager::workerLoop, this);
+        }
+        LOG_INFO("Loudness meter " + std::to_string(entry->id) + " (" + entry->name + ") started");
+        return entry->id;
+    }
+    
+    bool stop(int id) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        for (auto it = meters.begin(); it != meters.end(); ++it) {
+            if ((*it)->id == id) {
+                monitors->detach((*it)->session);
+                meters.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    void stopAll() {
+        if (worker.joinable()) {
+            running = false;
+            worker.join();
+        }
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        for (auto& entry : meters) {
+            monitors->detach(entry->session);
+        }
+        meters.clear();
+    }
+    
+    // id 0 resets every meter; false if no meter matched
+    bool reset(int id) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        bool found = false;
+        for (auto& entry : meters) {
+            if (id == 0 || entry->id == id) {
+                entry->resetRequested = true;
+                found = true;
+            }
+        }
+        return found;
+    }
+    
+    // fn(const Meter&, const LoudnessReading&) per meter
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        std::vector<std::shared_ptr<Meter>> current;
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            current = meters;
+        }
+        for (const auto& entry : current) {
+            fn(static_cast<const Meter&>(*entry), entry->published.load());
+        }
+    }
+    
+private:
+    static constexpr size_t kChunkFrames = 4096;
+    
+    void workerLoop() {
+        while (running) {
+            std::vector<std::shared_ptr<Meter>> current;
+            {
+                std::lock_guard<InstrumentedMutex> lock(mutex);
+                for (auto it = meters.begin(); it != meters.end();) {
+                    if ((*it)->session.tap->closed()) {
+                        LOG_WARN("Loudness meter " + std::to_string((*it)->id) + " stopped: JACK client restarted");
+                        monitors->detach((*it)->session);
+                        it = meters.erase(it);
+                    } else {
+                        current.push_back(*it);
+                        ++it;
+                    }
+                }
+            }
+            
+            for (auto& entry : current) {
+                measure(*entry);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+    
+    void measure(Meter& m) {
+        if (m.resetRequested.exchange(false)) {
+            m.meter->reset();
+            m.published.store(m.meter->reading());
+        }
+        
+        MonitorTap& tap = *m.session.tap;
+        uint64_t newest = tap.writeFrame();
+        if (!m.started) {
+            if (newest > m.session.startAfter) {
+                m.cursor = newest;
+                m.started = true;
+            }
+            return;
+        }
+        if (newest - m.cursor > tap.readableFrames()) {
+            // Measurement has a gap; loudness over the rest is still valid
+            m.session.droppedFrames.fetch_add(newest - m.cursor, std::memory_order_relaxed);
+            m.cursor = newest;
+        }
+        
+        size_t channels = m.session.slots.size();
+        const float* planes[LoudnessMeter::kMaxChannels];
+        bool measured = false;
+        while (newest > m.cursor) {
+            size_t count = static_cast<size_t>(std::min<uint64_t>(newest - m.cursor, kChunkFrames));
+            bool intact = true;
+            for (size_t ch = 0; ch < channels && intact; ch++) {
+                planes[ch] = m.samples.data() + ch * kChunkFrames;
+                intact = tap.read(m.session.slots[ch], m.cursor, count, m.samples.data() + ch * kChunkFrames);
+            }
+            if (!intact) {
+                m.cursor = tap.writeFrame();
+                break;
+            }
+            m.meter->process(planes, count);
+            m.cursor += count;
+            measured = true;
+        }
+        if (measured) {
+            m.published.store(m.meter->reading());
+        }
+    }
+    
+    MonitorManager* monitors;
+    InstrumentedMutex mutex{"loudness"};
+    std::vector<std::shared_ptr<Meter>> meters;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    int nextId = 1;
+};
+
+// Signal-presence auto-routing. Each rule watches one source through the
+// PresenceDetector and connects its destinations while the source carries
+// signal, disconnecting them after the rule's hold time of silence. The RT
+// thread only classifies; a worker thread makes every graph change.
+class AutoRouter {
+public:
+    struct Rule {
+        PortName source;
+        std::vector<PortName> destinations;
+        double onDb = -50;
+        double offDb = -60;
+        double holdSeconds = 5;
+    };
+    
+    struct Status {
+        bool watching = false;  // source exists and is being measured
+        bool active = false;
+        bool routed = false;
+        double peakDb = -200;
+        double silentSeconds = 0;
+        uint64_t onsets = 0;
+    };
+    
+    static constexpr size_t kMaxRules = PresenceDetector::kMaxInputs;
+    static constexpr size_t kMaxDestinations = 16;
+    
+    explicit AutoRouter(JackManager* jm) : jackManager(jm) {}
+    
+    ~AutoRouter() {
+        stop();
+    }
+    
+    // Adds a rule, or replaces the one for the same source
+    bool add(const Rule& rule, std::string& error) {
+        if (rule.source.empty() || rule.destinations.empty() || rule.destinations.size() > kMaxDestinations) {
+            error = "A rule needs a source and 1-" + std::to_string(kMaxDestinations) + " destinations";
+            return false;
+        }
+        if (!(rule.offDb <= rule.onDb) || !(rule.onDb <= 0) || !(rule.holdSeconds >= 0.1 && rule.holdSeconds <= 3600)) {
+            error = "Need off_db <= on_db <= 0 and a hold of 0.1-3600 s";
+            return false;
+        }
+        
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [&](const Entry& e) { return e.rule.source == rule.source; });
+        if (it != entries.end()) {
+            unwatch(*it);
+            it->rule = rule;
+            it->fresh = true;
+        } else if (entries.size() >= kMaxRules) {
+            error = "Too many auto-route rules";
+            return false;
+        } else {
+            Entry entry;
+            entry.rule = rule;
+            entries.push_back(std::move(entry));
+        }
+        
+        if (!worker.joinable()) {
+            running = true;
+            worker = std::thread(&AutoRouter::workerLoop, this);
+        }
+        LOG_INFO(std::string("Auto-route rule: ") + rule.source.c_str() + " -> " +
+                 std::to_string(rule.destinations.size()) + " destination(s)");
+        return true;
+    }
+    
+    // Leaves the destinations as they are
+    bool remove(const PortName& source) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [&](const Entry& e) { return e.rule.source == source; });
+        if (it == entries.end()) return false;
+        
+        unwatch(*it);
+        entries.erase(it);
+        destroyDetectorIfIdle();
+        return true;
+    }
+    
+    void stop() {
+        if (worker.joinable()) {
+            running = false;
+            worker.join();
+        }
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        for (Entry& entry : entries) {
+            unwatch(entry);
+        }
+        destroyDetectorIfIdle(true);
+    }
+    
+    // fn(const Rule&, const Status&) per rule
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        for (const Entry& entry : entries) {
+            Status status;
+            status.routed = entry.routed;
+            if (entry.port && detector) {
+                float peak = detector->peak(entry.slot);
+                status.watching = true;
+                status.active = detector->active(entry.slot);
+                status.peakDb = peak > 1e-10f ? 20.0 * std::log10(peak) : -200.0;
+                status.silentSeconds = static_cast<double>(detector->silentFrames(entry.slot)) / sampleRate;
+                status.onsets = detector->onsets(entry.slot);
+            }
+            fn(entry.rule, static_cast<const Status&>(status));
+        }
+    }
+    
+private:
+    struct Entry {
+        Rule rule;
+        jack_port_t* port = nullptr;    // presence input fed by the source
+        size_t slot = 0;
+        bool routed = false;
+        bool fresh = true;              // not looked for yet
+    };
+    
+    static constexpr auto kTick = std::chrono::milliseconds(20);
+    static constexpr int kWatchRetryTicks = 50;
+    
+    void workerLoop() {
+        int ticks = 0;
+        while (running) {
+            std::this_thread::sleep_for(kTick);
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            
+            if (detector && clientGeneration != g_jackClientGeneration.load()) {
+                LOG_WARN("Auto-routing paused: JACK client restarted");
+                for (Entry& entry : entries) {
+                    entry.port = nullptr;
+                    entry.routed = false;
+                }
+                destroyDetectorIfIdle(true);
+            }
+            
+            // Sources that do not exist yet are looked for about once a second
+            bool retry = ++ticks >= kWatchRetryTicks;
+            if (retry) ticks = 0;
+            for (Entry& entry : entries) {
+                if (!entry.port && (retry || entry.fresh) && g_jackRunning) {
+                    entry.fresh = false;
+                    watch(entry);
+                }
+                if (entry.port) {
+                    apply(entry);
+                }
+            }
+        }
+    }
+    
+    // Hooks a presence input up to the rule's source
+    void watch(Entry& entry) {
+        GraphPtr graph = jackManager->getGraph();
+        if (graph->findPort(entry.rule.source.view()) == GraphSnapshot::kNoPort) {
+            return;
+        }
+        if (!detector && !createDetector()) {
+            return;
+        }
+        
+        std::array<bool, kMaxRules> used{};
+        for (const Entry& other : entries) {
+            if (other.port) used[other.slot] = true;
+        }
+        size_t slot = std::find(used.begin(), used.end(), false) - used.begin();
+        
+        std::string shortName = "presence_" + std::to_string(slot + 1);
+        uint64_t generation = 0;
+        jack_port_t* port = jackManager->registerPort(shortName.c_str(), JackPortIsInput, generation);
+        if (!port) return;
+        if (generation != clientGeneration ||
+            !jackManager->connectPorts(entry.rule.source.c_str(), jack_port_name(port))) {
+            jackManager->unregisterPort(port, generation);
+            return;
+        }
+        
+        detector->setInput(slot, port, dbToLinear(entry.rule.onDb), dbToLinear(entry.rule.offDb),
+                           static_cast<uint64_t>(entry.rule.holdSeconds * sampleRate));
+        entry.port = port;
+        entry.slot = slot;
+    }
+    
+    void unwatch(Entry& entry) {
+        if (!entry.port) return;
+        
+        detector->clearInput(entry.slot);
+        if (g_rtProcessors.synchronize()) {
+            jackManager->unregisterPort(entry.port, clientGeneration);
+        }
+        entry.port = nullptr;
+        entry.routed = false;
+    }
+    
+    // Brings the destinations in line with the detector's verdict
+    void apply(Entry& entry) {
+        bool active = detector->active(entry.slot);
+        if (active == entry.routed) return;
+        
+        TraceSpan span("autoroute_apply");
+        const Rule& rule = entry.rule;
+        if (active) {
+            for (const PortName& destination : rule.destinations) {
+                jackManager->connectPorts(rule.source.c_str(), destination.c_str());
+            }
+            LOG_INFO(std::string("Auto-route: signal on ") + rule.source.c_str());
+        } else {
+            GraphPtr graph = jackManager->getGraph();
+            for (const PortName& destination : rule.destinations) {
+                if (graph->connected(rule.source.view(), destination.view())) {
+                    jackManager->disconnectPorts(rule.source.c_str(), destination.c_str());
+                }
+            }
+            LOG_INFO(std::string("Auto-route: ") + rule.source.c_str() + " silent for " +
+                     std::to_string(static_cast<int>(rule.holdSeconds * 1000)) + " ms");
+        }
+        entry.routed = active;
+    }
+    
+    bool createDetector() {
+        sampleRate = jackManager->sampleRate();
+        if (sampleRate == 0) return false;
+        
+        detector = std::make_unique<PresenceDetector>();
+        if (!g_rtProcessors.add(detector.get())) {
+            detector.reset();
+            LOG_ERROR("Auto-routing: too many active RT processors");
+            return false;
+        }
+        clientGeneration = g_jackClientGeneration.load();
+        return true;
+    }
+    
+    void destroyDetectorIfIdle(bool force = false) {
+        if (!detector) return;
+        if (!force) {
+            for (const Entry& entry : entries) {
+                if (entry.port) return;
+            }
+        }
+        
+        retireRtProcessor(detector, "Presence detector");
+        detector.reset();
+    }
+    
+    JackManager* jackManager;
+    InstrumentedMutex mutex{"autoroute"};
+    std::vector<Entry> entries;
+    std::unique_ptr<PresenceDetector> detector;
+    uint64_t clientGeneration = 0;
+    jack_nframes_t sampleRate = 0;
+    std::thread worker;
+    std::atomic<bool> running{false};
+};
+
+// Round-trip latency through an external loop (POST /latency/measure): plays
+// an MLS into a playback port, records a capture port and finds the delay by
+// cross-correlation. One measurement runs at a time; the latest result per
+// playback/capture pair is kept for GET /latency.
+class LatencyMeter {
+public:
+    struct Request {
+        PortName playback;
+        PortName capture;
+        double levelDb = -12;
+        double maxMs = 500;
+    };
+    
+    struct Result {
+        PortName playback;
+        PortName capture;
+        uint32_t sampleRate = 0;
+        LoopbackDelay delay;
+        jack_nframes_t reportedFrames = 0;  // playback + capture latency JACK claims
+        std::chrono::system_clock::time_point measuredAt;
+    };
+    
+    static constexpr double kMaxLagMs = 2000;
+    static constexpr size_t kMaxResults = 32;
+    
+    explicit LatencyMeter(JackManager* jm) : jackManager(jm) {}
+    
+    bool measure(const Request& request, Result& result, std::string& error) {
+        std::unique_lock<std::mutex> busy(measuring, std::try_to_lock);
+        if (!busy.owns_lock()) {
+            error = "A latency measurement is already running";
+            return false;
+        }
+        if (!(request.levelDb <= 0 && request.levelDb >= -60) || !(request.maxMs >= 10 && request.maxMs <= kMaxLagMs)) {
+            error = "Need level_db -60..0 and max_ms 10-" + std::to_string(static_cast<int>(kMaxLagMs));
+            return false;
+        }
+        jack_nframes_t sampleRate = jackManager->sampleRate();
+        if (sampleRate == 0) {
+            error = "JACK not running";
+            return false;
+        }
+        
+        uint64_t generation = 0, inGeneration = 0;
+        jack_port_t* out = jackManager->registerPort("latency_out", JackPortIsOutput, generation);
+        jack_port_t* in = jackManager->registerPort("latency_in", JackPortIsInput, inGeneration);
+        auto releasePorts = [&] {
+            jackManager->unregisterPort(out, generation);
+            jackManager->unregisterPort(in, inGeneration);
+        };
+        if (!out || !in) {
+            releasePorts();
+            error = "Failed to register latency ports";
+            return false;
+        }
+        if (!jackManager->connectPorts(jack_port_name(out), request.playback.c_str()) ||
+            !jackManager->connectPorts(request.capture.c_str(), jack_port_name(in))) {
+            releasePorts();
+            error = "Cannot connect to the playback or capture port";
+            return false;
+        }
+        
+        auto probe = std::make_unique<LatencyProbe>(out, in, dbToLinear(request.levelDb),
+                                                    static_cast<size_t>(request.maxMs * sampleRate / 1000));
+        if (!g_rtProcessors.add(probe.get())) {
+            releasePorts();
+            error = "Too many active RT processors";
+            return false;
+        }
+        
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(2000 + 1000 * probe->durationFrames() / sampleRate);
+        while (!probe->done() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        bool completed = probe->done();
+        if (!retireRtProcessor(probe, "Latency probe")) {
+            error = "JACK stopped responding during the measurement";
+            return false;
+        }
+        releasePorts();
+        if (!completed) {
+            error = "Measurement timed out";
+            return false;
+        }
+        
+        TraceSpan span("latency_correlate");
+        result = Result();
+        result.playback = request.playback;
+        result.capture = request.capture;
+        result.sampleRate = sampleRate;
+        result.delay = findLoopbackDelay(probe->sequence(), probe->captured());
+        span.end();
+        if (!result.delay.found) {
+            error = "No loopback signal found on " + std::string(request.capture.c_str());
+            return false;
+        }
+        result.reportedFrames = jackManager->portLatency(request.playback.c_str(), JackPlaybackLatency) +
+                                jackManager->portLatency(request.capture.c_str(), JackCaptureLatency);
+        result.measuredAt = std::chrono::system_clock::now();
+        
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        auto it = std::find_if(results.begin(), results.end(), [&](const Result& r) {
+            return r.playback == result.playback && r.capture == result.capture;
+        });
+        if (it != results.end()) {
+            *it = result;
+        } else {
+            if (results.size() >= kMaxResults) results.erase(results.begin());
+            results.push_back(result);
+        }
+        LOG_INFO(std::string("Round-trip latency ") + request.playback.c_str() + " -> " + request.capture.c_str() +
+                 ": " + std::to_string(result.delay.frames) + " frames");
+        return true;
+    }
+    
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        for (const Result& result : results) {
+            fn(result);
+        }
+    }
+    
+private:
+    JackManager* jackManager;
+    std::mutex measuring;
+    InstrumentedMutex mutex{"latency"};
+    std::vector<Result> results;
+};
+
+// Named routing presets (preset.<name>= lines in the config). Applying a
+// preset only changes the difference from the preset applied before it:
+// connections of the old preset that the new one lacks are removed, missing
+// ones are made, and the rest of the graph is left alone.
+class PresetManager {
+public:
+    struct Edge {
+        PortName from;
+        PortName to;
+    };
+    
+    struct Outcome {
+        int connected = 0;
+        int disconnected = 0;
+        int failed = 0;
+    };
+    
+    explicit PresetManager(JackManager* jm) : jackManager(jm) {}
+    
+    static bool validName(std::string_view name) {
+        if (name.empty() || name.length() > 64) return false;
+        return std::all_of(name.begin(), name.end(), [](char c) {
+            return isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-';
+        });
+    }
+    
+    void define(const std::string& name, std::vector<Edge> edges) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        presets[name] = std::move(edges);
+    }
+    
+    bool contains(const std::string& name) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        return presets.count(name) != 0;
+    }
+    
+    bool apply(const std::string& name, Outcome& outcome, std::string& error) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        
+        auto it = presets.find(name);
+        if (it == presets.end()) {
+            error = "No such preset: " + name;
+            return false;
+        }
+        const std::vector<Edge>& next = it->second;
+        auto contains = [](const std::vector<Edge>& edges, const Edge& edge) {
+            return std::any_of(edges.begin(), edges.end(),
+                               [&](const Edge& e) { return e.from == edge.from && e.to == edge.to; });
+        };
+        
+        TraceSpan span("preset_apply");
+        GraphPtr graph = jackManager->getGraph();
+        auto previous = presets.find(active);
+        if (previous != presets.end() && previous != it) {
+            for (const Edge& edge : previous->second) {
+                if (contains(next, edge) || !graph->connected(edge.from.view(), edge.to.view())) continue;
+                if (jackManager->disconnectPorts(edge.from.c_str(), edge.to.c_str())) {
+                    outcome.disconnected++;
+                } else {
+                    outcome.failed++;
+                }
+            }
+        }
+        for (const Edge& edge : next) {
+            if (graph->connected(edge.from.view(), edge.to.view())) continue;
+            if (jackManager->connectPorts(edge.from.c_str(), edge.to.c_str())) {
+                outcome.connected++;
+            } else {
+                outcome.failed++;
+            }
+        }
+        
+        active = name;
+        LOG_INFO("Preset " + name + " applied: +" + std::to_string(outcome.connected) + " -" +
+                 std::to_string(outcome.disconnected) +
+                 (outcome.failed ? ", " + std::to_string(outcome.failed) + " failed" : std::string()));
+        return true;
+    }
+    
+    // fn(name, edges, isActive) per preset
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        for (const auto& [name, edges] : presets) {
+            fn(name, edges, name == active);
+        }
+    }
+    
+private:
+    JackManager* jackManager;
+    InstrumentedMutex mutex{"presets"};
+    std::map<std::string, std::vector<PresetManager::Edge>> presets;
+    std::string active;
+};
+
+// MIDI control of the bridge. A MIDI input port is parsed in the process
+// callback by MidiTrigger; mapped program changes and CCs are queued to a
+// worker that switches presets, so a footswitch needs no network hop. The
+// worker measures each switch from the cycle that saw the message to the
+// last graph change it made.
+class MidiControl {
+public:
+    struct Mapping {
+        bool program = true;    // program change, else CC
+        int number = 0;
+        std::string preset;
+    };
+    
+    struct Stats {
+        uint64_t matched = 0;       // mapped messages the RT thread queued
+        uint64_t dropped = 0;       // queue full
+        uint64_t applied = 0;
+        uint64_t superseded = 0;    // overtaken by a newer message before the worker got to them
+        uint64_t failed = 0;
+        uint64_t lastUsecs = 0;
+        uint64_t maxUsecs = 0;
+        uint64_t totalUsecs = 0;
+    };
+    
+    explicit MidiControl(JackManager* jm, PresetManager* p) : jackManager(jm), presets(p) {}
+    
+    ~MidiControl() {
+        stop();
+    }
+    
+    // Source to connect the bridge's MIDI input to (may be empty) and the
+    // channel to listen on (0 = any)
+    void configure(const PortName& midiSource, int midiChannel) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        source = midiSource;
+        channel = midiChannel;
+        publishMap();
+    }
+    
+    bool map(const Mapping& mapping, std::string& error) {
+        if (mapping.number < 0 || mapping.number > 127) {
+            error = "MIDI numbers are 0-127";
+            return false;
+        }
+        if (!presets->contains(mapping.preset)) {
+            error = "No such preset: " + mapping.preset;
+            return false;
+        }
+        
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        auto it = std::find_if(mappings.begin(), mappings.end(), [&](const Mapping& m) {
+            return m.program == mapping.program && m.number == mapping.number;
+        });
+        if (it != mappings.end()) {
+            it->preset = mapping.preset;
+        } else {
+            mappings.push_back(mapping);
+        }
+        publishMap();
+        return true;
+    }
+    
+    bool unmap(bool program, int number) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        auto it = std::find_if(mappings.begin(), mappings.end(), [&](const Mapping& m) {
+            return m.program == program && m.number == number;
+        });
+        if (it == mappings.end()) return false;
+        mappings.erase(it);
+        publishMap();
+        return true;
+    }
+    
+    // Registers the MIDI input and starts the worker; poll() keeps the port
+    // alive across JACK restarts from then on
+    void start() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        wanted = true;
+        if (!trigger && g_jackRunning) {
+            createTrigger();
+        }
+        if (!worker.joinable()) {
+            running = true;
+            worker = std::thread(&MidiControl::workerLoop, this);
+        }
+    }
+    
+    void stop() {
+        if (worker.joinable()) {
+            running = false;
+            wake.post();
+            worker.join();
+        }
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        wanted = false;
+        destroyTrigger();
+    }
+    
+    // Called once a second from the service loop
+    void poll() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (trigger && clientGeneration != g_jackClientGeneration.load()) {
+            LOG_WARN("MIDI input dropped: JACK client restarted");
+            destroyTrigger();
+        }
+        if (wanted && !trigger && g_jackRunning) {
+            createTrigger();
+        }
+    }
+    
+    // fn(source, channel, portName, mappings, stats)
+    template <typename Fn>
+    void inspect(Fn&& fn) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        Stats current = stats;
+        if (trigger) {
+            current.matched += trigger->matched();
+            current.dropped += trigger->dropped();
+        }
+        fn(static_cast<const PortName&>(source), channel, port ? jack_port_name(port) : "",
+           static_cast<const std::vector<Mapping>&>(mappings), static_cast<const Stats&>(current));
+    }
+    
+private:
+    static constexpr int16_t kCcActions = 128;   // actions: program n -> n, CC n -> 128 + n
+    
+    void workerLoop() {
+        while (running) {
+            // The trigger posts wake as it queues; the timeout only bounds
+            // how long stop() waits if nothing ever arrives
+            if (!wake.wait(std::chrono::milliseconds(100))) continue;
+            
+            // Only the newest pending message matters: presets replace each other
+            MidiTriggerEvent event, newest;
+            size_t pending = 0;
+            std::string target;
+            {
+                std::lock_guard<InstrumentedMutex> lock(mutex);
+                if (!trigger) continue;
+                while (trigger->pop(event)) {
+                    newest = event;
+                    pending++;
+                }
+                if (pending == 0) continue;
+                stats.superseded += pending - 1;
+                target = presetFor(newest.action);
+            }
+            if (target.empty()) continue;
+            
+            PresetManager::Outcome outcome;
+            std::string error;
+            bool applied = presets->apply(target, outcome, error);
+            uint64_t latency = jack_get_time() - newest.receivedUsecs;
+            
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            if (!applied) {
+                stats.failed++;
+                LOG_WARN("MIDI preset switch failed: " + error);
+                continue;
+            }
+            stats.applied++;
+            stats.lastUsecs = latency;
+            stats.maxUsecs = std::max(stats.maxUsecs, latency);
+            stats.totalUsecs += latency;
+            LOG_DEBUG("MIDI preset " + target + " in " + std::to_string(latency) + " us");
+        }
+    }
+    
+    std::string presetFor(int16_t action) const {
+        bool program = action < kCcActions;
+        int number = program ? action : action - kCcActions;
+        for (const Mapping& m : mappings) {
+            if (m.program == program && m.number == number) return m.preset;
+        }
+        return {};
+    }
+    
+    // Swaps in a map built from the current mappings
+    void publishMap() {
+        auto next = std::make_unique<MidiMap>();
+        next->channel = channel;
+        for (const Mapping& m : mappings) {
+            if (m.program) {
+                next->program[m.number] = static_cast<int16_t>(m.number);
+            } else {
+                next->cc[m.number] = static_cast<int16_t>(kCcActions + m.number);
+            }
+        }
+        if (trigger) {
+            trigger->setMap(next.get());
+            if (!g_rtProcessors.synchronize()) {
+                // The RT thread may still be reading the old map
+                midiMap.release();
+            }
+        }
+        midiMap = std::move(next);
+    }
+    
+    void createTrigger() {
+        jack_port_t* midiPort = jackManager->registerPort("midi_in", JackPortIsInput, clientGeneration,
+                                                          JACK_DEFAULT_MIDI_TYPE);
+        if (!midiPort) return;
+        if (!source.empty() && !jackManager->connectPorts(source.c_str(), jack_port_name(midiPort))) {
+            LOG_WARN(std::string("MIDI input not connected to ") + source.c_str());
+        }
+        
+        auto created = std::make_unique<MidiTrigger>(midiPort, &wake);
+        created->setMap(midiMap.get());
+        if (!g_rtProcessors.add(created.get())) {
+            jackManager->unregisterPort(midiPort, clientGeneration);
+            LOG_ERROR("MIDI input: too many active RT processors");
+            return;
+        }
+        port = midiPort;
+        trigger = std::move(created);
+        LOG_INFO(std::string("MIDI input ready: ") + jack_port_name(port));
+    }
+    
+    void destroyTrigger() {
+        if (trigger) {
+            stats.matched += trigger->matched();
+            stats.dropped += trigger->dropped();
+            retireRtProcessor(trigger, "MIDI input");
+            trigger.reset();
+        }
+        jackManager->unregisterPort(port, clientGeneration);
+        port = nullptr;
+    }
+    
+    JackManager* jackManager;
+    PresetManager* presets;
+    InstrumentedMutex mutex{"midi"};
+    PortName source;
+    int channel = 0;
+    std::vector<Mapping> mappings;
+    std::unique_ptr<MidiMap> midiMap = std::make_unique<MidiMap>();
+    std::unique_ptr<MidiTrigger> trigger;
+    WakeSignal wake;                // outlives any trigger, which may be leaked
+    jack_port_t* port = nullptr;
+    uint64_t clientGeneration = 0;
+    bool wanted = false;
+    Stats stats;
+    std::thread worker;
+    std::atomic<bool> running{false};
+};
+
+// Replaces every `key=` line of jack-bridge.conf with `key=value` lines
+// (placed where the first old one was, else appended). Written to a
+// temporary file first so a crash never leaves a half-written config.
+bool saveConfigList(const std::string& key, const std::vector<std::string>& values) {
+    const std::string prefix = key + "=";
+    std::vector<std::string> lines;
+    size_t insertAt = std::string::npos;
+    {
+        std::ifstream in("jack-bridge.conf");
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.compare(0, prefix.length(), prefix) == 0) {
+                if (insertAt == std::string::npos) insertAt = lines.size();
+                continue;
+            }
+            lines.push_back(line);
+        }
+    }
+    if (insertAt == std::string::npos) insertAt = lines.size();
+    std::vector<std::string> replacement;
+    for (const std::string& value : values) {
+        replacement.push_back(prefix + value);
+    }
+    lines.insert(lines.begin() + insertAt, replacement.begin(), replacement.end());
+    
+    {
+        std::ofstream out("jack-bridge.conf.tmp", std::ios::trunc);
+        for (const std::string& line : lines) {
+            out << line << "\n";
+        }
+        if (!out.flush()) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename("jack-bridge.conf.tmp", "jack-bridge.conf", error);
+    return !error;
+}
+
+// The bridge's own gain stage (mixer_inputs x mixer_outputs crosspoints),
+// with gains and mutes bindable to MIDI CCs by learning. Bindings are kept
+// in the config as mixer_cc= lines.
+class MixerManager {
+public:
+    struct Binding {
+        int cc = 0;
+        MixerBinding binding;
+    };
+    
+    explicit MixerManager(JackManager* jm) : jackManager(jm) {}
+    
+    ~MixerManager() {
+        stop();
+    }
+    
+    void configure(size_t inputCount, size_t outputCount, const PortName& midiSource) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        inputs = std::min(inputCount, CrosspointMixer::kMaxInputs);
+        outputs = std::min(outputCount, CrosspointMixer::kMaxOutputs);
+        source = midiSource;
+    }
+    
+    bool enabled() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        return inputs > 0 && outputs > 0;
+    }
+    
+    // Creates the ports and starts mixing; poll() rebuilds after JACK restarts
+    void start() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        wanted = inputs > 0 && outputs > 0;
+        if (wanted && !mixer && g_jackRunning) {
+            createMixer();
+        }
+    }
+    
+    void stop() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        wanted = false;
+        destroyMixer();
+    }
+    
+    void poll() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (mixer && clientGeneration != g_jackClientGeneration.load()) {
+            LOG_WARN("Mixer dropped: JACK client restarted");
+            destroyMixer();
+        }
+        if (wanted && !mixer && g_jackRunning) {
+            createMixer();
+        }
+    }
+    
+    bool post(const MixerCommand& command, std::string& error) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (!mixer) {
+            error = "Mixer not running";
+            return false;
+        }
+        if (command.output >= mixer->outputs() || command.input >= mixer->inputs()) {
+            error = "No such crosspoint";
+            return false;
+        }
+        if (!mixer->post(command)) {
+            error = "Mixer command queue full";
+            return false;
+        }
+        return true;
+    }
+    
+    // Waits for the next CC on the mixer's MIDI port and binds it to the
+    // target. Only one learn runs at a time.
+    bool learn(MixerBinding target, std::chrono::milliseconds timeout, int& cc, std::string& error) {
+        std::unique_lock<std::mutex> busy(learning, std::try_to_lock);
+        if (!busy.owns_lock()) {
+            error = "Already learning";
+            return false;
+        }
+        
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            if (!mixer) {
+                error = "Mixer not running";
+                return false;
+            }
+            if (target.output >= mixer->outputs() || target.input >= mixer->inputs()) {
+                error = "No such crosspoint";
+                return false;
+            }
+            LearnedCc stale;
+            while (mixer->learned(stale)) {}
+            mixer->learn(true);
+        }
+        
+        LearnedCc learned;
+        bool heard = false;
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!heard) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) break;
+            // Posted by the mixer as it queues the CC; bounded so a mixer
+            // torn down mid-learn is noticed
+            learnedWake.wait(std::min(left, std::chrono::milliseconds(100)));
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            if (!mixer) break;
+            heard = mixer->learned(learned);
+        }
+        
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (mixer) mixer->learn(false);
+        if (!heard) {
+            error = "No CC received";
+            return false;
+        }
+        target.channel = learned.channel;
+        bindings[learned.cc] = target;
+        cc = learned.cc;
+        publishBindings();
+        persist();
+        LOG_INFO("MIDI learn: CC " + std::to_string(cc) + " on channel " + std::to_string(learned.channel) +
+                 (target.target == MixerBinding::Gain ? " -> gain " : " -> mute ") +
+                 std::to_string(target.output + 1) + "/" + std::to_string(target.input + 1));
+        return true;
+    }
+    
+    // Bindings from the config; not persisted again
+    void bind(int cc, const MixerBinding& binding) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        bindings[cc] = binding;
+        publishBindings();
+    }
+    
+    bool unbind(int cc) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (cc < 0 || cc > 127 || bindings[cc].target == MixerBinding::None) return false;
+        bindings[cc] = MixerBinding();
+        publishBindings();
+        persist();
+        return true;
+    }
+    
+    // fn(inputs, outputs, mixer or nullptr, bindings)
+    template <typename Fn>
+    void inspect(Fn&& fn) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        fn(inputs, outputs, static_cast<const CrosspointMixer*>(mixer.get()),
+           static_cast<const MixerBindings&>(bindings));
+    }
+    
+    // mixer_cc=<cc>[:<channel>]>gain|mute:<output>:<input> (1-based)
+    static std::string formatBinding(int cc, const MixerBinding& b) {
+        return std::to_string(cc) + (b.channel ? ":" + std::to_string(b.channel) : std::string()) +
+               (b.target == MixerBinding::Gain ? ">gain:" : ">mute:") +
+               std::to_string(b.output + 1) + ":" + std::to_string(b.input + 1);
+    }
+    
+    static bool parseBinding(std::string_view text, int& cc, MixerBinding& b) {
+        unsigned values[4] = {0, 0, 0, 0};
+        char target[8] = {0};
+        std::string line(text);
+        if (sscanf(line.c_str(), "%u:%u>%4[a-z]:%u:%u", &values[0], &values[1], target, &values[2], &values[3]) != 5) {
+            values[1] = 0;
+            if (sscanf(line.c_str(), "%u>%4[a-z]:%u:%u", &values[0], target, &values[2], &values[3]) != 4) {
+                return false;
+            }
+        }
+        std::string_view kind = target;
+        if (values[0] > 127 || values[1] > 16 || values[2] < 1 || values[2] > CrosspointMixer::kMaxOutputs ||
+            values[3] < 1 || values[3] > CrosspointMixer::kMaxInputs || (kind != "gain" && kind != "mute")) {
+            return false;
+        }
+        cc = static_cast<int>(values[0]);
+        b.target = kind == "gain" ? MixerBinding::Gain : MixerBinding::Mute;
+        b.channel = static_cast<uint8_t>(values[1]);
+        b.output = static_cast<uint8_t>(values[2] - 1);
+        b.input = static_cast<uint8_t>(values[3] - 1);
+        return true;
+    }
+    
+private:
+    void publishBindings() {
+        auto next = std::make_unique<MixerBindings>(bindings);
+        if (mixer) {
+            mixer->setBindings(next.get());
+            if (!g_rtProcessors.synchronize()) {
+                // The RT thread may still be reading the old table
+                published.release();
+            }
+        }
+        published = std::move(next);
+    }
+    
+    void persist() {
+        std::vector<std::string> lines;
+        for (int cc = 0; cc < 128; cc++) {
+            if (bindings[cc].target != MixerBinding::None) {
+                lines.push_back(formatBinding(cc, bindings[cc]));
+            }
+        }
+        if (!saveConfigList("mixer_cc", lines)) {
+            LOG_WARN("Could not save MIDI bindings to jack-bridge.conf");
+        }
+    }
+    
+    void createMixer() {
+        clientGeneration = 0;
+        std::vector<jack_port_t*> in, out;
+        for (size_t i = 0; i < inputs; i++) {
+            std::string name = "mixer_in_" + std::to_string(i + 1);
+            if (jack_port_t* port = jackManager->registerPort(name.c_str(), JackPortIsInput, clientGeneration)) {
+                in.push_back(port);
+            }
+        }
+        for (size_t o = 0; o < outputs; o++) {
+            std::string name = "mixer_out_" + std::to_string(o + 1);
+            if (jack_port_t* port = jackManager->registerPort(name.c_str(), JackPortIsOutput, clientGeneration)) {
+                out.push_back(port);
+            }
+        }
+        midiPort = jackManager->registerPort("mixer_midi", JackPortIsInput, clientGeneration, JACK_DEFAULT_MIDI_TYPE);
+        ports = in;
+        ports.insert(ports.end(), out.begin(), out.end());
+        if (midiPort) ports.push_back(midiPort);
+        if (in.size() != inputs || out.size() != outputs || !midiPort) {
+            releasePorts();
+            LOG_ERROR("Mixer: failed to register ports");
+            return;
+        }
+        if (!source.empty()) {
+            jackManager->connectPorts(source.c_str(), jack_port_name(midiPort));
+        }
+        
+        auto created = std::make_unique<CrosspointMixer>(in, out, midiPort, &learnedWake);
+        created->setBindings(published.get());
+        if (!g_rtProcessors.add(created.get())) {
+            releasePorts();
+            LOG_ERROR("Mixer: too many active RT processors");
+            return;
+        }
+        mixer = std::move(created);
+        LOG_INFO("Mixer running: " + std::to_string(inputs) + " in, " + std::to_string(outputs) + " out");
+    }
+    
+    void destroyMixer() {
+        if (mixer) {
+            retireRtProcessor(mixer, "Mixer");
+            mixer.reset();
+        }
+        releasePorts();
+    }
+    
+    void releasePorts() {
+        for (jack_port_t* port : ports) {
+            jackManager->unregisterPort(port, clientGeneration);
+        }
+        ports.clear();
+        midiPort = nullptr;
+    }
+    
+    JackManager* jackManager;
+    InstrumentedMutex mutex{"mixer"};
+    std::mutex learning;
+    WakeSignal learnedWake;         // outlives any mixer, which may be leaked
+    size_t inputs = 0;
+    size_t outputs = 0;
+    PortName source;
+    bool wanted = false;
+    MixerBindings bindings{};
+    std::unique_ptr<MixerBindings> published = std::make_unique<MixerBindings>();
+    std::unique_ptr<CrosspointMixer> mixer;
+    std::vector<jack_port_t*> ports;
+    jack_port_t* midiPort = nullptr;
+    uint64_t clientGeneration = 0;
+};
+
+// Desired-state routing (PUT /routing). The worker compares the live graph
+// with the declared edge set whenever JACK reports a graph change, and makes
+// only the difference: missing edges are connected and, in exclusive mode,
+// edges outside the set are removed. Connections to the bridge's own ports
+// (taps, mixer, MIDI) are never touched. Exclusive mode is opt-in: it also
+// removes edges made by the auto-router, presets, MQTT, MIDI program changes
+// and replayed intents unless the desired set lists them, and fights those
+// managers on every pass. Divergence found while the desired set has not
+// changed is drift, caused by another client or a JACK restart.
+//
+// It also holds the one-off connects, disconnects and clears that arrived
+// while JACK could not take them, and applies them in order once it can.
+class RoutingReconciler {
+public:
+    struct Edge {
+        PortName from;
+        PortName to;
+        
+        friend bool operator<(const Edge& a, const Edge& b) {
+            return a.from != b.from ? a.from < b.from : a.to < b.to;
+        }
+        friend bool operator==(const Edge& a, const Edge& b) { return a.from == b.from && a.to == b.to; }
+    };
+    
+    struct Stats {
+        uint64_t passes = 0;
+        uint64_t driftPasses = 0;       // passes that found the graph moved away
+        uint64_t driftEdges = 0;        // edges those passes had to fix
+        uint64_t connected = 0;
+        uint64_t disconnected = 0;
+        uint64_t failed = 0;
+        size_t missing = 0;             // after the last pass
+        size_t extra = 0;
+        size_t waiting = 0;             // desired edges whose ports do not exist yet
+        bool converged = false;
+        uint64_t lastUsecs = 0;
+        uint64_t maxUsecs = 0;
+        uint64_t totalUsecs = 0;
+        std::chrono::system_clock::time_point lastDrift;
+        uint64_t deferred = 0;          // intents queued while JACK was unavailable
+        uint64_t deferredApplied = 0;
+        uint64_t deferredFailed = 0;
+    };
+    
+    struct Intent {
+        Edge edge;
+        bool connect = true;
+    };
+    
+    static constexpr size_t kMaxDeferred = 1024;
+    
+    explicit RoutingReconciler(JackManager* jm) : jackManager(jm) {}
+    
+    ~RoutingReconciler() {
+        stop();
+    }
+    
+    // Replaces the desired state and reconciles at once
+    void set(std::vector<Edge> edges, bool exclusive) {
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        auto next = std::make_shared<Desired>();
+        next->edges = std::move(edges);
+        next->exclusive = exclusive;
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            desired = std::move(next);
+            desiredVersion++;
+        }
+        wake();
+        start();
+    }
+    
+    // Stops managing the graph; connections are left as they are
+    void clear() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        desired.reset();
+        desiredVersion++;
+        settled = false;
+        stats.converged = false;
+        stats.missing = stats.extra = stats.waiting = 0;
+    }
+    
+    // Queues a change JACK could not take now. Only the latest intent per
+    // edge is kept. Returns how many intents are waiting, or 0 when the
+    // queue is full and this one was refused.
+    size_t defer(Edge edge, bool connect) {
+        size_t queued;
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            auto same = std::find_if(pending.begin(), pending.end(),
+                                     [&](const Intent& intent) { return intent.edge == edge; });
+            if (same != pending.end()) {
+                pending.erase(same);
+            } else if (pending.size() >= kMaxDeferred) {
+                return 0;
+            }
+            pending.push_back({std::move(edge), connect});
+            stats.deferred++;
+            queued = pending.size() + pendingClear;
+        }
+        start();
+        return queued;
+    }
+    
+    // A clear supersedes everything queued before it
+    size_t deferClear() {
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            pending.clear();
+            pendingClear = true;
+            stats.deferred++;
+        }
+        start();
+        return 1;
+    }
+    
+    // A change JACK took live. Intents queued before it for the same edge
+    // are older and must not undo it on replay, including in a pass already
+    // under way; a connect goes back in the queue behind a clear still to
+    // come, so the clear does not undo it either.
+    void supersede(const Edge& edge, bool connect) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        supersedeWhere([edge](const Edge& queued) { return queued == edge; });
+        if (connect && (pendingClear || passClears) && pending.size() < kMaxDeferred) {
+            pending.push_back({edge, true});
+        }
+    }
+    
+    // Same for every edge of a port after a live /disconnect_port
+    void supersedePort(const PortName& port) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        supersedeWhere([port](const Edge& queued) { return queued.from == port || queued.to == port; });
+    }
+    
+    // A live clear: everything queued before it is moot
+    void supersedeAll() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        pending.clear();
+        pendingClear = false;
+        if (applying) passSupersededAll = true;
+    }
+    
+    void stop() {
+        if (worker.joinable()) {
+            running = false;
+            wake();
+            worker.join();
+        }
+    }
+    
+    // fn(edges or nullptr, exclusive, stats)
+    template <typename Fn>
+    void inspect(Fn&& fn) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        const Desired* current = desired.get();
+        fn(current ? &current->edges : nullptr, current && current->exclusive, static_cast<const Stats&>(stats));
+    }
+    
+    // fn(deferred intents oldest first, whether a clear goes before them)
+    template <typename Fn>
+    void inspectDeferred(Fn&& fn) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        fn(static_cast<const std::vector<Intent>&>(pending), pendingClear);
+    }
+    
+private:
+    struct Desired {
+        std::vector<Edge> edges;    // sorted, unique
+        bool exclusive = false;
+    };
+    
+    // Caller holds mutex
+    void supersedeWhere(std::function<bool(const Edge&)> match) {
+        std::erase_if(pending, [&](const Intent& intent) { return match(intent.edge); });
+        if (applying) passSuperseded.push_back(std::move(match));
+    }
+    
+    void start() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (!worker.joinable()) {
+            running = true;
+            worker = std::thread(&RoutingReconciler::workerLoop, this);
+        }
+    }
+    
+    static void wake() {
+        g_graphChanged.notify_all();
+    }
+    
+    void workerLoop() {
+        uint64_t seenGeneration = 0;
+        uint64_t seenVersion = 0;
+        while (running) {
+            {
+                // Callbacks notify without the lock, so a wakeup can be
+                // missed; the timeout bounds how late that makes a pass
+                std::unique_lock<std::mutex> lock(g_graphChangedMutex);
+                g_graphChanged.wait_for(lock, std::chrono::seconds(1), [&] {
+                    return !running || g_graphGeneration.load() != seenGeneration ||
+                           desiredVersion.load() != seenVersion;
+                });
+            }
+            if (!running) break;
+            
+            std::shared_ptr<const Desired> target;
+            {
+                std::lock_guard<InstrumentedMutex> lock(mutex);
+                target = desired;
+            }
+            uint64_t version = desiredVersion.load();
+            bool changedTarget = version != seenVersion;
+            seenVersion = version;
+            seenGeneration = g_graphGeneration.load();
+            // Deferred intents are retried on every wakeup, but not while
+            // the breaker is turning calls away; once its open period is
+            // over the first retry may be the probe
+            CircuitBreaker::Stats circuit = jackManager->circuit();
+            if (g_jackRunning && (circuit.state != CircuitBreaker::State::Open || circuit.retryAfterMs == 0)) {
+                applyDeferred();
+            }
+            if (target && g_jackRunning) {
+                reconcile(*target, changedTarget);
+                // Our own changes moved the generation; the next pass confirms them
+            }
+        }
+    }
+    
+    void reconcile(const Desired& target, bool changedTarget) {
+        auto started = std::chrono::steady_clock::now();
+        TraceSpan span("reconcile");
+        
+        GraphPtr graph = jackManager->getGraph();
+        std::string ownPrefix = std::string(jackManager->getJackInfo().clientName) + ":";
+        auto own = [&](const PortName& port) { return port.view().substr(0, ownPrefix.length()) == ownPrefix; };
+        
+        std::vector<const Edge*> missing;
+        size_t waiting = 0;
+        for (const Edge& edge : target.edges) {
+            if (graph->findPort(edge.from.view()) == GraphSnapshot::kNoPort ||
+                graph->findPort(edge.to.view()) == GraphSnapshot::kNoPort) {
+                waiting++;
+            } else if (!graph->connected(edge.from.view(), edge.to.view())) {
+                missing.push_back(&edge);
+            }
+        }
+        std::vector<Edge> extra;
+        if (target.exclusive) {
+            for (const PortEdge& live : graph->edges) {
+                Edge edge{graph->fromName(live), graph->toName(live)};
+                if (own(edge.from) || own(edge.to)) continue;
+                if (!std::binary_search(target.edges.begin(), target.edges.end(), edge)) {
+                    extra.push_back(edge);
+                }
+            }
+        }
+        
+        // Removals first so an exclusive input is never briefly doubled up
+        uint64_t connected = 0, disconnected = 0, failed = 0;
+        for (const Edge& edge : extra) {
+            if (jackManager->disconnectPorts(edge.from.c_str(), edge.to.c_str())) {
+                disconnected++;
+            } else {
+                failed++;
+            }
+        }
+        for (const Edge* edge : missing) {
+            if (jackManager->connectPorts(edge->from.c_str(), edge->to.c_str())) {
+                connected++;
+            } else {
+                failed++;
+            }
+        }
+        span.end();
+        uint64_t usecs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started).count());
+        
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        size_t diff = missing.size() + extra.size();
+        stats.passes++;
+        // Retrying failures is not drift, and neither are edges whose ports
+        // have just appeared
+        size_t appeared = stats.waiting > waiting ? stats.waiting - waiting : 0;
+        size_t drift = !changedTarget && settled ? diff - std::min(diff, appeared) : 0;
+        if (drift > 0) {
+            stats.driftPasses++;
+            stats.driftEdges += drift;
+            stats.lastDrift = std::chrono::system_clock::now();
+            LOG_WARN("Routing drift: " + std::to_string(missing.size()) + " missing, " +
+                     std::to_string(extra.size()) + " extra");
+        }
+        stats.connected += connected;
+        stats.disconnected += disconnected;
+        stats.failed += failed;
+        stats.missing = missing.size() - std::min<size_t>(missing.size(), connected);
+        stats.extra = extra.size() - std::min<size_t>(extra.size(), disconnected);
+        stats.waiting = waiting;
+        settled = failed == 0;
+        stats.converged = settled && waiting == 0;
+        stats.lastUsecs = usecs;
+        stats.maxUsecs = std::max(stats.maxUsecs, usecs);
+        stats.totalUsecs += usecs;
+    }
+    
+    // Connects whose ports do not exist yet (JACK came back but their
+    // clients have not) stay queued. The first call JACK fails to answer
+    // ends the pass; what is left goes back in front of anything queued
+    // meanwhile, unless a newer intent for the same edge replaced it.
+    void applyDeferred() {
+        std::vector<Intent> work;
+        bool clearFirst;
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            if (pending.empty() && !pendingClear) return;
+            work.swap(pending);
+            clearFirst = std::exchange(pendingClear, false);
+            applying = true;
+            passClears = clearFirst;
+            passSuperseded.clear();
+            passSupersededAll = false;
+        }
+        TraceSpan span("apply_deferred");
+        auto unavailable = [] { return t_jackTimedOut || t_jackRejected; };
+        
+        bool interrupted = false;
+        uint64_t applied = 0, failed = 0;
+        if (clearFirst) {
+            jackManager->clearAllConnections();
+            interrupted = unavailable();
+            if (!interrupted) {
+                clearFirst = false;
+                applied++;
+            }
+        }
+        GraphPtr graph;
+        if (!interrupted && !work.empty()) {
+            graph = jackManager->getGraph();
+            interrupted = unavailable();
+        }
+        std::vector<Intent> keep;
+        size_t next = 0;
+        for (; !interrupted && next < work.size(); next++) {
+            const Intent& intent = work[next];
+            bool present = graph->findPort(intent.edge.from.view()) != GraphSnapshot::kNoPort &&
+                           graph->findPort(intent.edge.to.view()) != GraphSnapshot::kNoPort;
+            bool linked = present && graph->connected(intent.edge.from.view(), intent.edge.to.view());
+            if (intent.connect == linked) {
+                applied++;          // already the way it was asked for
+                continue;
+            }
+            if (!present) {
+                keep.push_back(intent);
+                continue;
+            }
+            bool ok = intent.connect ? jackManager->connectPorts(intent.edge.from.c_str(), intent.edge.to.c_str())
+                                     : jackManager->disconnectPorts(intent.edge.from.c_str(), intent.edge.to.c_str());
+            if (unavailable()) {
+                interrupted = true;
+                break;
+            }
+            ok ? applied++ : failed++;
+        }
+        keep.insert(keep.end(), work.begin() + static_cast<std::ptrdiff_t>(next), work.end());
+        
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        stats.deferredApplied += applied;
+        stats.deferredFailed += failed;
+        applying = false;
+        passClears = false;
+        if (pendingClear || passSupersededAll) return;  // a newer clear supersedes all of it
+        pendingClear = clearFirst;
+        std::erase_if(keep, [&](const Intent& old) {
+            return std::any_of(pending.begin(), pending.end(),
+                               [&](const Intent& newer) { return newer.edge == old.edge; }) ||
+                   std::any_of(passSuperseded.begin(), passSuperseded.end(),
+                               [&](const auto& match) { return match(old.edge); });
+        });
+        pending.insert(pending.begin(), keep.begin(), keep.end());
+    }
+    
+    JackManager* jackManager;
+    InstrumentedMutex mutex{"routing"};
+    std::vector<Intent> pending;    // deferred intents, oldest first
+    bool pendingClear = false;      // a deferred clear runs before them
+    bool applying = false;          // applyDeferred() holds the queue
+    bool passClears = false;        // ... and a clear it has not run yet, perhaps
+    std::vector<std::function<bool(const Edge&)>> passSuperseded;  // live changes since
+    bool passSupersededAll = false;
+    std::shared_ptr<const Desired> desired;
+    std::atomic<uint64_t> desiredVersion{0};
+    Stats stats;
+    bool settled = false;           // last pass had no failures
+    std::thread worker;
+    std::atomic<bool> running{false};
+};
+
+bool sendAll(SOCKET socket, const char* data, size_t length) {
+    while (length > 0) {
+        int sent = send(socket, data, static_cast<int>(length), 0);
+        if (sent <= 0) return false;
+        data += sent;
+        length -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// Home Assistant control over MQTT 3.1.1, on the topics services/mqttService.js
+// uses: <base>/connection/<in>_to_<out>/set (ON/OFF), <base>/preset/<name>/set
+// and <base>/clear/set (PRESS). Commands are applied straight to JACK, and
+// connection states are published retained at QoS 0 whenever the graph
+// generation moves, only for the switches whose state changed. Nothing here
+// retransmits, and a lost state is corrected by the next change or session.
+class MqttBridge {
+public:
+    struct Settings {
+        std::string host;
+        int port = 1883;
+        std::string username;
+        std::string password;
+        std::string clientId = "jack-bridge";
+        int keepAliveSeconds = 60;
+        std::string base = "jack_audio";
+        std::vector<std::pair<std::string, PortName>> inputs;   // entity key -> port
+        std::vector<std::pair<std::string, PortName>> outputs;
+    };
+    
+    struct Stats {
+        bool connected = false;
+        uint64_t sessions = 0;
+        uint64_t commands = 0;
+        uint64_t failed = 0;        // commands JACK or the preset rejected
+        uint64_t ignored = 0;       // unknown switches or payloads
+        uint64_t published = 0;
+        std::string lastError;
+    };
+    
+    explicit MqttBridge(JackManager* jm, PresetManager* p) : jackManager(jm), presets(p) {}
+    
+    ~MqttBridge() {
+        stop();
+    }
+    
+    void start(Settings next) {
+        stop();
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            settings = std::move(next);
+        }
+        running = true;
+        worker = std::thread(&MqttBridge::run, this);
+    }
+    
+    void stop() {
+        if (worker.joinable()) {
+            running = false;
+            worker.join();
+        }
+    }
+    
+    bool enabled() const { return running; }
+    
+    // fn(settings, stats)
+    template <typename Fn>
+    void inspect(Fn&& fn) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        fn(static_cast<const Settings&>(settings), static_cast<const Stats&>(stats));
+    }
+    
+private:
+    static constexpr int kConnectTimeoutMs = 5000;
+    static constexpr int kMaxBackoffSeconds = 30;
+    
+    void run() {
+        int backoffSeconds = 1;
+        while (running) {
+            if (session()) {
+                backoffSeconds = 1;
+            }
+            for (int i = 0; running && i < backoffSeconds * 10; i++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            backoffSeconds = std::min(backoffSeconds * 2, kMaxBackoffSeconds);
+        }
+    }
+    
+    void fail(const std::string& error) {
+        LOG_WARN("MQTT: " + error);
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        stats.connected = false;
+        stats.lastError = error;
+    }
+    
+    SOCKET open() {
+        struct addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* found = nullptr;
+        std::string service = std::to_string(settings.port);
+        if (getaddrinfo(settings.host.c_str(), service.c_str(), &hints, &found) != 0 || !found) {
+            fail("cannot resolve " + settings.host);
+            return INVALID_SOCKET;
+        }
+        SOCKET s = INVALID_SOCKET;
+        for (struct addrinfo* a = found; a && s == INVALID_SOCKET; a = a->ai_next) {
+            s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (s != INVALID_SOCKET && connect(s, a->ai_addr, static_cast<int>(a->ai_addrlen)) != 0) {
+                closesocket(s);
+                s = INVALID_SOCKET;
+            }
+        }
+        freeaddrinfo(found);
+        if (s == INVALID_SOCKET) {
+            fail("cannot connect to " + settings.host + ":" + service);
+            return INVALID_SOCKET;
+        }
+        BOOL noDelay = TRUE;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+        DWORD sendTimeoutMs = 2000;
+        setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&sendTimeoutMs), sizeof(sendTimeoutMs));
+        return s;
+    }
+    
+    bool write(const std::string& packet) { return sendAll(socket_, packet.data(), packet.length()); }
+    
+    // Waits up to timeoutMs for the next packet; false on timeout or a dead
+    // connection (closed set)
+    bool read(mqtt::Packet& packet, int timeoutMs, bool& closed) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (!reader.next(packet)) {
+            if (reader.malformed()) {
+                closed = true;
+                return false;
+            }
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) return false;
+            
+            WSAPOLLFD fd = {};
+            fd.fd = socket_;
+            fd.events = POLLIN;
+            int ready = WSAPoll(&fd, 1, static_cast<int>(left.count()));
+            if (ready < 0) {
+                closed = true;
+                return false;
+            }
+            if (ready == 0) return false;
+            
+            char buffer[4096];
+            int received = recv(socket_, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                closed = true;
+                return false;
+            }
+            reader.feed(buffer, static_cast<size_t>(received));
+            lastHeard = std::chrono::steady_clock::now();
+        }
+        return true;
+    }
+    
+    uint16_t nextPacketId() {
+        if (++packetId == 0) packetId = 1;
+        return packetId;
+    }
+    
+    bool publish(const std::string& topic, std::string_view payload) {
+        if (!write(mqtt::publish(topic, payload, 0, true, 0))) return false;
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        stats.published++;
+        return true;
+    }
+    
+    // One broker connection, from CONNECT to the socket closing. True if the
+    // broker accepted us, so the retry starts over at the shortest delay.
+    bool session() {
+        socket_ = open();
+        if (socket_ == INVALID_SOCKET) return false;
+        reader.reset();
+        published.clear();
+        
+        const std::string availability = settings.base + "/availability";
+        int keepAlive = std::max(settings.keepAliveSeconds, 5);
+        bool closed = false;
+        mqtt::Packet packet;
+        bool accepted = write(mqtt::connect(settings.clientId, static_cast<uint16_t>(keepAlive), settings.username,
+                                            settings.password, availability, "offline")) &&
+                        read(packet, kConnectTimeoutMs, closed) && packet.type == mqtt::ConnAck &&
+                        packet.body.length() >= 2 && packet.body[1] == 0;
+        if (!accepted) {
+            fail(packet.type == mqtt::ConnAck && packet.body.length() >= 2
+                     ? "broker refused connection (code " + std::to_string(packet.body[1]) + ")"
+                     : "no CONNACK from " + settings.host);
+            closesocket(socket_);
+            return false;
+        }
+        
+        std::vector<std::string> filters = {
+            settings.base + "/connection/+/set",
+            settings.base + "/preset/+/set",
+            settings.base + "/clear/set",
+        };
+        bool ok = write(mqtt::subscribe(nextPacketId(), filters, 1)) && publish(availability, "online");
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            stats.connected = ok;
+            stats.sessions++;
+            stats.lastError.clear();
+        }
+        LOG_INFO("MQTT connected to " + settings.host + ":" + std::to_string(settings.port));
+        
+        std::string lost = "connection to " + settings.host + " lost";
+        auto lastSent = std::chrono::steady_clock::now();
+        lastHeard = lastSent;
+        uint64_t generation = 0;
+        while (ok && running) {
+            uint64_t current = g_graphGeneration.load();
+            if (current != generation || resync ||
+                (retryAt != std::chrono::steady_clock::time_point{} && std::chrono::steady_clock::now() >= retryAt)) {
+                generation = current;
+                resync = false;
+                ok = publishStates();
+                lastSent = std::chrono::steady_clock::now();
+            }
+            
+            if (ok && read(packet, 100, closed)) {
+                if (packet.type == mqtt::Publish) {
+                    mqtt::Message message;
+                    if (!mqtt::parsePublish(packet, message)) {
+                        ok = false;
+                    } else {
+                        if (message.qos == 1) ok = write(mqtt::pubAck(message.packetId));
+                        handle(message);
+                    }
+                }
+                continue;
+            }
+            ok = ok && !closed;
+            
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastHeard > std::chrono::milliseconds(keepAlive * 1500)) {
+                lost = "broker stopped responding";
+                ok = false;
+            } else if (ok && now - lastSent > std::chrono::seconds(keepAlive) / 2) {
+                ok = write(mqtt::pingReq());
+                lastSent = now;
+            }
+        }
+        
+        if (ok) {
+            // Clean shutdown: the broker does not publish the will, so say it ourselves
+            publish(availability, "offline");
+            write(mqtt::disconnect());
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            stats.connected = false;
+        } else {
+            fail(lost);
+        }
+        closesocket(socket_);
+        socket_ = INVALID_SOCKET;
+        return true;
+    }
+    
+    // Publishes every switch whose state differs from what the broker holds.
+    // Without a fresh graph (JACK down, not answering, or no ports yet) it
+    // publishes nothing, rather than every switch OFF, and tries again in a
+    // second.
+    bool publishStates() {
+        retryAt = {};
+        GraphPtr graph = jackManager->getGraph();
+        if (t_jackTimedOut || t_jackRejected || !g_jackRunning || graph->ports.empty()) {
+            retryAt = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            return true;
+        }
+        for (const auto& [inKey, inPort] : settings.inputs) {
+            for (const auto& [outKey, outPort] : settings.outputs) {
+                std::string entity = inKey + "_to_" + outKey;
+                bool on = graph->connected(inPort.view(), outPort.view());
+                auto it = published.find(entity);
+                if (it != published.end() && it->second == on) continue;
+                if (!publish(settings.base + "/connection/" + entity + "/state", on ? "ON" : "OFF")) return false;
+                published[entity] = on;
+            }
+        }
+        return true;
+    }
+    
+    void handle(const mqtt::Message& message) {
+        std::string_view topic = message.topic;
+        const std::string& payload = message.payload;
+        std::string_view prefix = settings.base;
+        if (topic.substr(0, prefix.length()) != prefix || topic.substr(prefix.length(), 1) != "/") return;
+        topic.remove_prefix(prefix.length() + 1);
+        
+        bool known = false;
+        bool done = false;
+        std::string what;
+        if (topic.substr(0, 11) == "connection/" && topic.length() > 15 && topic.substr(topic.length() - 4) == "/set") {
+            std::string_view entity = topic.substr(11, topic.length() - 15);
+            size_t split = entity.find("_to_");
+            const PortName* from = nullptr;
+            const PortName* to = nullptr;
+            for (const auto& [key, port] : settings.inputs) {
+                if (split != std::string_view::npos && entity.substr(0, split) == key) from = &port;
+            }
+            for (const auto& [key, port] : settings.outputs) {
+                if (split != std::string_view::npos && entity.substr(split + 4) == key) to = &port;
+            }
+            known = from && to && (payload == "ON" || payload == "OFF");
+            if (known) {
+                what = std::string(entity) + "=" + payload;
+                done = payload == "ON" ? jackManager->connectPorts(from->c_str(), to->c_str())
+                                       : jackManager->disconnectPorts(from->c_str(), to->c_str());
+                if (!done) {
+                    // Home Assistant shows the switch as commanded until told otherwise
+                    published.erase(std::string(entity));
+                    resync = true;
+                }
+            }
+        } else if (topic.substr(0, 7) == "preset/" && topic.length() > 11 && topic.substr(topic.length() - 4) == "/set") {
+            std::string name(topic.substr(7, topic.length() - 11));
+            known = payload == "PRESS" && presets->contains(name);
+            if (known) {
+                what = "preset " + name;
+                PresetManager::Outcome outcome;
+                std::string error;
+                done = presets->apply(name, outcome, error) && outcome.failed == 0;
+            }
+        } else if (topic == "clear/set") {
+            known = payload == "PRESS";
+            if (known) {
+                what = "clear";
+                jackManager->clearAllConnections();
+                done = true;
+            }
+        }
+        
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        if (!known) {
+            stats.ignored++;
+            LOG_DEBUG("MQTT: ignoring " + message.topic + " " + payload);
+            return;
+        }
+        stats.commands++;
+        if (!done) {
+            stats.failed++;
+            LOG_WARN("MQTT command failed: " + what);
+        } else {
+            LOG_DEBUG("MQTT command: " + what);
+        }
+    }
+    
+    JackManager* jackManager;
+    PresetManager* presets;
+    InstrumentedMutex mutex{"mqtt"};
+    Settings settings;          // fixed while the worker runs
+    Stats stats;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    
+    // Worker thread only
+    SOCKET socket_ = INVALID_SOCKET;
+    mqtt::PacketReader reader;
+    std::chrono::steady_clock::time_point lastHeard;
+    std::map<std::string, bool> published;     // entity -> state the broker holds
+    bool resync = false;
+    std::chrono::steady_clock::time_point retryAt;  // publishStates() found no fresh graph
+    uint16_t packetId = 0;
+};
+
+struct RequestContext;
+thread_local RequestContext* t_request = nullptr;
+
+// What an HTTP request keeps in thread-locals while it runs: its trace id
+// and timing, its JACK deadline, the arena its coroutine frames come from
+// and its heap allocation count. A request coroutine may continue on another
+// pool thread after any co_await, so awaiters leave() before suspending and
+// enter() again when resumed.
+struct RequestContext {
+    uint32_t requestId = 0;
+    RequestTiming* timing = nullptr;
+    std::pmr::memory_resource* frames = nullptr;
+    std::chrono::steady_clock::time_point jackDeadline{};
+    bool clientDeadline = false;
+    bool jackTimedOut = false;
+    bool jackRejected = false;
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    alloc_stats::Sample since{};
+    
+    void enter() {
+        trace_detail::t_requestId = requestId;
+        trace_detail::t_timing = timing;
+        coro::t_frameResource = frames;
+        t_jackDeadline = jackDeadline;
+        t_jackClientDeadline = clientDeadline;
+        t_jackTimedOut = jackTimedOut;
+        t_jackRejected = jackRejected;
+        t_request = this;
+        since = alloc_stats::sample();
+    }
+    
+    void leave() {
+        alloc_stats::Sample now = alloc_stats::sample();
+        allocations += now.allocations - since.allocations;
+        bytes += now.bytes - since.bytes;
+        jackTimedOut = t_jackTimedOut;
+        jackRejected = t_jackRejected;
+        trace_detail::t_requestId = 0;
+        trace_detail::t_timing = nullptr;
+        coro::t_frameResource = nullptr;
+        t_jackDeadline = {};
+        t_jackClientDeadline = false;
+        t_jackTimedOut = false;
+        t_jackRejected = false;
+        t_request = nullptr;
+    }
+};
+
+// Socket readiness and timers for coroutines. One thread polls every socket
+// a coroutine waits on, plus a loopback socket that wakes it when the set
+// changes, and posts each coroutine back to the pool once its socket is
+// ready or its deadline has passed. Timers run their callback on the same
+// thread, so they must only hand work off.
+class IoReactor {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    ~IoReactor() { stop(); }
+    
+    bool start(coro::ThreadPool* p) {
+        pool = p;
+        wakeSocket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (wakeSocket == INVALID_SOCKET) return false;
+        
+        struct sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int length = sizeof(address);
+        u_long nonBlocking = 1;
+        if (bind(wakeSocket, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+            getsockname(wakeSocket, (struct sockaddr*)&address, &length) != 0 ||
+            connect(wakeSocket, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+            ioctlsocket(wakeSocket, FIONBIO, &nonBlocking) != 0) {
+            closesocket(wakeSocket);
+            wakeSocket = INVALID_SOCKET;
+            return false;
+        }
+        
+        running = true;
+        thread = std::thread(&IoReactor::run, this);
+        return true;
+    }
+    
+    // Everything still waiting is resumed as timed out and every timer fires
+    void stop() {
+        if (!running.exchange(false)) return;
+        wake();
+        if (thread.joinable()) thread.join();
+        closesocket(wakeSocket);
+        wakeSocket = INVALID_SOCKET;
+        
+        std::vector<Waiter> left;
+        std::vector<Timer> timers;
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            left = std::move(incoming);
+            left.insert(left.end(), waiters.begin(), waiters.end());
+            waiters.clear();
+            while (!timerQueue.empty()) {
+                timers.push_back(timerQueue.top());
+                timerQueue.pop();
+            }
+        }
+        for (Waiter& waiter : left) {
+            pool->post(waiter.handle);
+        }
+        for (Timer& timer : timers) {
+            timer.fire();
+        }
+    }
+    
+    // co_await reactor.readable(s, deadline): true once s can be read (or
+    // has failed), false if the deadline came first
+    auto readable(SOCKET s, Clock::time_point deadline) { return Wait{*this, s, POLLIN, deadline}; }
+    auto writable(SOCKET s, Clock::time_point deadline) { return Wait{*this, s, POLLOUT, deadline}; }
+    
+    // co_await reactor.sleepUntil(when): continues on the pool at when
+    auto sleepUntil(Clock::time_point when) { return Sleep{*this, when}; }
+    
+    // Once stopped, a timer fires at once
+    void at(Clock::time_point when, std::function<void()> fire) {
+        bool earliest;
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            if (!running) {
+                earliest = false;
+            } else {
+                earliest = timerQueue.empty() || when < timerQueue.top().when;
+                timerQueue.push(Timer{when, nextTimer++, std::move(fire)});
+                fire = nullptr;
+            }
+        }
+        if (fire) fire();
+        if (earliest) wake();
+    }
+    
+    size_t waiting() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        return waiters.size() + incoming.size();
+    }
+
+private:
+    struct Waiter {
+        SOCKET socket;
+        short events;
+        Clock::time_point deadline;
+        std::coroutine_handle<> handle;
+        bool* ready;
+    };
+    
+    struct Timer {
+        Clock::time_point when;
+        uint64_t sequence;
+        std::function<void()> fire;
+        
+        bool operator>(const Timer& other) const {
+            return when != other.when ? when > other.when : sequence > other.sequence;
+        }
+    };
+    
+    struct Wait {
+        IoReactor& reactor;
+        SOCKET socket;
+        short events;
+        Clock::time_point deadline;
+        bool ready = false;
+        RequestContext* context = nullptr;
+        
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            context = t_request;
+            if (context) context->leave();
+            reactor.add(Waiter{socket, events, deadline, h, &ready});
+        }
+        bool await_resume() {
+            if (context) context->enter();
+            return ready;
+        }
+    };
+    
+    struct Sleep {
+        IoReactor& reactor;
+        Clock::time_point when;
+        RequestContext* context = nullptr;
+        
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            context = t_request;
+            if (context) context->leave();
+            coro::ThreadPool* resume = reactor.pool;
+            reactor.at(when, [resume, h] { resume->post(h); });
+        }
+        void await_resume() {
+            if (context) context->enter();
+        }
+    };
+    
+    // Once stopped, a waiter resumes at once as timed out
+    void add(Waiter waiter) {
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            if (running) {
+                incoming.push_back(waiter);
+                waiter.handle = nullptr;
+            }
+        }
+        if (waiter.handle) {
+            pool->post(waiter.handle);
+            return;
+        }
+        wake();
+    }
+    
+    void wake() {
+        char byte = 0;
+        send(wakeSocket, &byte, 1, 0);
+    }
+    
+    void run() {
+        std::vector<WSAPOLLFD> fds;
+        std::vector<std::function<void()>> due;
+        while (running) {
+            Clock::time_point next = Clock::now() + std::chrono::seconds(1);
+            {
+                std::lock_guard<InstrumentedMutex> lock(mutex);
+                waiters.insert(waiters.end(), incoming.begin(), incoming.end());
+                incoming.clear();
+                if (!timerQueue.empty()) next = std::min(next, timerQueue.top().when);
+            }
+            
+            fds.resize(waiters.size() + 1);
+            fds[0] = WSAPOLLFD{};
+            fds[0].fd = wakeSocket;
+            fds[0].events = POLLIN;
+            for (size_t i = 0; i < waiters.size(); i++) {
+                fds[i + 1] = WSAPOLLFD{};
+                fds[i + 1].fd = waiters[i].socket;
+                fds[i + 1].events = waiters[i].events;
+                next = std::min(next, waiters[i].deadline);
+            }
+            
+            auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(next - Clock::now()).count();
+            WSAPoll(fds.data(), static_cast<unsigned long>(fds.size()),
+                    static_cast<int>(std::clamp<long long>(timeout + 1, 0, 1000)));
+            
+            if (fds[0].revents) {
+                char drain[64];
+                while (recv(wakeSocket, drain, sizeof(drain), 0) > 0) {}
+            }
+            
+            // Resolve from the back so the indices in fds stay valid
+            Clock::time_point now = Clock::now();
+            for (size_t i = waiters.size(); i-- > 0;) {
+                bool ready = fds[i + 1].revents != 0;
+                if (!ready && waiters[i].deadline > now) continue;
+                *waiters[i].ready = ready;
+                pool->post(waiters[i].handle);
+                waiters[i] = waiters.back();
+                waiters.pop_back();
+            }
+            
+            {
+                std::lock_guard<InstrumentedMutex> lock(mutex);
+                while (!timerQueue.empty() && timerQueue.top().when <= now) {
+                    due.push_back(std::move(const_cast<Timer&>(timerQueue.top()).fire));
+                    timerQueue.pop();
+                }
+            }
+            for (auto& fire : due) {
+                fire();
+            }
+            due.clear();
+        }
+    }
+    
+    coro::ThreadPool* pool = nullptr;
+    SOCKET wakeSocket = INVALID_SOCKET;
+    std::atomic<bool> running{false};
+    std::thread thread;
+    InstrumentedMutex mutex{"reactor"};
+    std::vector<Waiter> incoming;
+    std::vector<Waiter> waiters;    // reactor thread only
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timerQueue;
+    uint64_t nextTimer = 0;
+};
+
+// co_await JackAwait(...): runs fn on the JACK executor, where JackManager
+// calls run inline, and continues on the pool with its result, or with
+// fallback once the request's JACK deadline has passed or at once if the
+// circuit breaker is open. fn must capture by value: after a timeout the
+// request may be gone before fn runs.
+template <typename Result>
+class JackAwait {
+public:
+    JackAwait(JackManager* jack, coro::ThreadPool& pool, IoReactor& reactor, Result fallback,
+              std::function<Result()> fn)
+        : jack(jack), pool(pool), reactor(reactor), fallback(std::move(fallback)), fn(std::move(fn)) {}
+    
+    // A request that already timed out or was turned away does not queue
+    // more work
+    bool await_ready() {
+        if (t_jackTimedOut || t_jackRejected) return true;
+        admission = jack->admit();
+        if (admission != CircuitBreaker::Admission::Rejected) return false;
+        t_jackRejected = true;
+        return true;
+    }
+    
+    void await_suspend(std::coroutine_handle<> h) {
+        started = std::chrono::steady_clock::now();
+        context = t_request;
+        auto deadline = context ? context->jackDeadline
+                                : std::chrono::steady_clock::now() + std::chrono::milliseconds(g_config.jackTimeoutMs);
+        if (context) context->leave();
+        
+        state = std::make_shared<State>();
+        state->handle = h;
+        
+        // Once the task is posted either side may resume the coroutine and
+        // destroy this awaiter, so nothing after that touches a member
+        std::shared_ptr<State> shared = state;
+        coro::ThreadPool* resume = &pool;
+        IoReactor* timers = &reactor;
+        jack->post([shared, resume, fn = std::move(fn)] {
+            std::optional<Result> value;
+            try {
+                value.emplace(fn());
+            } catch (...) {
+            }
+            if (shared->settled.exchange(true)) return;
+            shared->value = std::move(value);
+            shared->completed = true;
+            resume->post(shared->handle);
+        }, deadline);
+        timers->at(deadline, [shared, resume] {
+            if (!shared->settled.exchange(true)) resume->post(shared->handle);
+        });
+    }
+    
+    Result await_resume() {
+        if (context) context->enter();
+        if (!state) return std::move(fallback);
+        jack->record(admission, state->completed, std::chrono::steady_clock::now() - started,
+                     context && context->clientDeadline);
+        if (!state->completed) {
+            t_jackTimedOut = true;
+            jack->countTimeout();
+            return std::move(fallback);
+        }
+        return state->value ? std::move(*state->value) : std::move(fallback);
+    }
+
+private:
+    struct State {
+        std::atomic<bool> settled{false};
+        bool completed = false;
+        std::optional<Result> value;
+        std::coroutine_handle<> handle;
+    };
+    
+    JackManager* jack;
+    coro::ThreadPool& pool;
+    IoReactor& reactor;
+    Result fallback;
+    std::function<Result()> fn;
+    std::shared_ptr<State> state;
+    RequestContext* context = nullptr;
+    CircuitBreaker::Admission admission = CircuitBreaker::Admission::Rejected;
+    std::chrono::steady_clock::time_point started;
+};
+
+// Concurrent identical reads share one computation. The first request for a
+// key leads: it runs the handler and lands its body. Requests arriving while
+// it runs follow: they wait, each until its own JACK deadline, and get the
+// same body instead of computing it again. A landed flight is gone, so a
+// later request always computes afresh and nothing is reused beyond the
+// requests that overlapped it. A leader that ran out of JACK time lands
+// nothing: its deadline is its own, so followers compute for themselves.
+class SingleFlight {
+    struct Waiter;
+    struct Flight;
+    
+public:
+    struct Outcome {
+        std::string body;
+        bool jackRejected = false;
+    };
+    using OutcomePtr = std::shared_ptr<const Outcome>;
+    
+    struct Joined {
+        bool leader = false;
+        bool expired = false;       // the follower's deadline passed first
+        OutcomePtr outcome;         // null for the leader, or if it failed
+    };
+    
+    struct Stats {
+        uint64_t flights = 0;       // computations led
+        uint64_t shared = 0;        // requests answered from another's computation
+        uint64_t expired = 0;
+        size_t inFlight = 0;
+    };
+    
+    SingleFlight(coro::ThreadPool& pool, IoReactor& reactor) : pool(pool), reactor(reactor) {}
+    
+    // co_await join(key). The leader must land() the key afterwards, with a
+    // null outcome if it failed; its followers then compute for themselves.
+    class Join {
+    public:
+        Join(SingleFlight& flights, std::string_view key) : flights(flights), key(key) {}
+        
+        bool await_ready() {
+            std::lock_guard<InstrumentedMutex> lock(flights.mutex);
+            auto it = flights.flights.find(key);
+            if (it == flights.flights.end()) {
+                flights.flights.emplace(std::string(key), std::make_shared<Flight>());
+                flights.stats.flights++;
+                joined.leader = true;
+                return true;
+            }
+            flight = it->second;
+            return false;
+        }
+        
+        // Everything used after the waiter is published is a local: the
+        // leader or the timer may resume and destroy this awaiter by then
+        bool await_suspend(std::coroutine_handle<> h) {
+            context = t_request;
+            auto deadline = context ? context->jackDeadline
+                                    : std::chrono::steady_clock::now() + std::chrono::milliseconds(g_config.jackTimeoutMs);
+            auto waiter = std::make_shared<Waiter>();
+            waiter->handle = h;
+            waiter_ = waiter;
+            std::shared_ptr<Flight> joining = flight;
+            SingleFlight* group = &flights;
+            if (context) context->leave();
+            bool alreadyLanded;
+            {
+                std::lock_guard<InstrumentedMutex> lock(group->mutex);
+                alreadyLanded = joining->landed;
+                if (alreadyLanded) {
+                    waiter->outcome = joining->outcome;
+                    waiter->landed = true;
+                    group->stats.shared++;
+                } else {
+                    joining->waiters.push_back(waiter);
+                }
+            }
+            if (alreadyLanded) {
+                if (context) context->enter();
+                context = nullptr;
+                return false;
+            }
+            group->reactor.at(deadline, [waiter, group] {
+                if (!waiter->settled.exchange(true)) group->pool.post(waiter->handle);
+            });
+            return true;
+        }
+        
+        Joined await_resume() {
+            if (context) context->enter();
+            if (joined.leader) return joined;
+            if (!waiter_->landed) {
+                std::lock_guard<InstrumentedMutex> lock(flights.mutex);
+                flights.stats.expired++;
+                joined.expired = true;
+                return joined;
+            }
+            joined.outcome = waiter_->outcome;
+            return joined;
+        }
+    
+    private:
+        SingleFlight& flights;
+        std::string_view key;
+        Joined joined;
+        std::shared_ptr<Flight> flight;
+        std::shared_ptr<Waiter> waiter_;
+        RequestContext* context = nullptr;
+    };
+    
+    Join join(std::string_view key) { return Join(*this, key); }
+    
+    void land(std::string_view key, OutcomePtr outcome) {
+        std::vector<std::shared_ptr<Waiter>> waiters;
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            auto it = flights.find(key);
+            if (it == flights.end()) return;
+            it->second->landed = true;
+            it->second->outcome = outcome;
+            waiters.swap(it->second->waiters);
+            flights.erase(it);
+        }
+        uint64_t served = 0;
+        for (const auto& waiter : waiters) {
+            if (waiter->settled.exchange(true)) continue;
+            waiter->outcome = outcome;
+            waiter->landed = true;
+            served++;
+            pool.post(waiter->handle);
+        }
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        stats.shared += served;
+    }
+    
+    Stats inspect() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        Stats copy = stats;
+        copy.inFlight = flights.size();
+        return copy;
+    }
+
+private:
+    struct Waiter {
+        std::atomic<bool> settled{false};
+        bool landed = false;
+        OutcomePtr outcome;
+        std::coroutine_handle<> handle;
+    };
+    
+    struct Flight {
+        bool landed = false;
+        OutcomePtr outcome;
+        std::vector<std::shared_ptr<Waiter>> waiters;
+    };
+    
+    coro::ThreadPool& pool;
+    IoReactor& reactor;
+    InstrumentedMutex mutex{"single_flight"};
+    std::map<std::string, std::shared_ptr<Flight>, std::less<>> flights;
+    Stats stats;
+};
+
+// co_await ResumeOn(pool): continues the request coroutine on another pool,
+// carrying its RequestContext across
+class ResumeOn {
+public:
+    explicit ResumeOn(coro::ThreadPool& pool) : pool(pool) {}
+    
+    bool await_ready() const noexcept { return false; }
+    
+    void await_suspend(std::coroutine_handle<> h) {
+        context = t_request;
+        if (context) context->leave();
+        pool.post(h);
+    }
+    
+    void await_resume() {
+        if (context) context->enter();
+    }
+
+private:
+    coro::ThreadPool& pool;
+    RequestContext* context = nullptr;
+};
+
+// Everything the HTTP handlers operate on
+struct BridgeServices {
+    JackManager* jack = nullptr;
+    RecordingManager* recordings = nullptr;
+    ReplayManager* replay = nullptr;
+    MonitorManager* monitors = nullptr;
+    SpectrumAnalyzer* spectrum = nullptr;
+    LoudnessManager* loudness = nullptr;
+    AutoRouter* autoRouter = nullptr;
+    LatencyMeter* latency = nullptr;
+    PresetManager* presets = nullptr;
+    MidiControl* midi = nullptr;
+    MixerManager* mixer = nullptr;
+    MqttBridge* mqtt = nullptr;
+    RoutingReconciler* routing = nullptr;
+};
+
+// HTTP Server for API
+class HttpServer {
+private:
+    SOCKET serverSocket;
+    int port;
+    std::atomic<bool> running{false};
+    std::thread serverThread;
+    JackManager* jackManager;
+    RecordingManager* recordings;
+    ReplayManager* replay;
+    MonitorManager* monitors;
+    SpectrumAnalyzer* spectrum;
+    LoudnessManager* loudness;
+    AutoRouter* autoRouter;
+    LatencyMeter* latency;
+    PresetManager* presets;
+    MidiControl* midi;
+    MixerManager* mixer;
+    MqttBridge* mqtt;
+    RoutingReconciler* routing;
+    
+    static constexpr size_t kMaxRequestBytes = 64 * 1024;
+    static constexpr std::chrono::seconds kIdleTimeout{10};    // per read or write of one request
+    static constexpr std::chrono::milliseconds kStreamSendTimeout{2000};   // per monitor stream chunk
+    static constexpr std::chrono::milliseconds kStreamPoll{2};             // monitor tap poll interval
+    
+    // Request coroutines run on the pool; the reactor resumes them
+    coro::ThreadPool pool;
+    coro::ThreadPool blockingPool;
+    IoReactor reactor;
+    SingleFlight flights{pool, reactor};
+    std::atomic<uint64_t> inFlight{0};
+    
+    // /snapshot body up to its timestamp, for the graph generation and JACK
+    // settings it was serialised from
+    struct SnapshotBody {
+        uint64_t generation = 0;
+        jack_nframes_t sampleRate = 0;
+        jack_nframes_t bufferSize = 0;
+        std::string body;
+    };
+    InstrumentedMutex snapshotMutex{"snapshot"};
+    std::shared_ptr<const SnapshotBody> snapshotCache;
+    std::atomic<uint64_t> snapshotBuilds{0};
+    std::atomic<uint64_t> snapshotHits{0};
+    
+    // Request allocation statistics (see /stats)
+    ArenaUpstream arenaUpstream;
+    std::atomic<uint64_t> requestCount{0};
+    std::atomic<uint64_t> requestHeapAllocations{0};
+    std::atomic<uint64_t> requestHeapBytes{0};
+    std::atomic<uint64_t> lastRequestHeapAllocations{0};
+    std::atomic<uint64_t> zeroAllocationRequests{0};
+    std::atomic<uint32_t> nextRequestId{1};
+    
+    // Requests that said how long their client waits (X-Request-Timeout-Ms),
+    // and the work skipped because the client had given up
+    std::atomic<uint64_t> deadlineRequests{0};
+    std::atomic<uint64_t> expiredBeforeStart{0};
+    std::atomic<uint64_t> responsesDropped{0};
+    
+public:
+    HttpServer(int p, const BridgeServices& services)
+        : port(p), jackManager(services.jack), recordings(services.recordings), replay(services.replay), monitors(services.monitors), spectrum(services.spectrum), loudness(services.loudness), autoRouter(services.autoRouter), latency(services.latency), presets(services.presets), midi(services.midi), mixer(services.mixer), mqtt(services.mqtt), routing(services.routing), serverSocket(INVALID_SOCKET) {}
+    
+    ~HttpServer() {
+        stop();
+    }
+    
+    bool start() {
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            LOG_ERROR("WSAStartup failed");
+            return false;
+        }
+        
+        serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (serverSocket == INVALID_SOCKET) {
+            LOG_ERROR("Socket creation failed");
+            WSACleanup();
+            return false;
+        }
+        
+        // Allow socket reuse
+        int opt = 1;
+        setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+        
+        struct sockaddr_in address;
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(static_cast<u_short>(port));
+        
+        if (bind(serverSocket, (struct sockaddr*)&address, sizeof(address)) < 0) {
+            LOG_ERROR("Bind failed on port " + std::to_string(port));
+            closesocket(serverSocket);
+            WSACleanup();
+            return false;
+        }
+        
+        if (listen(serverSocket, SOMAXCONN) < 0) {
+            LOG_ERROR("Listen failed");
+            closesocket(serverSocket);
+            WSACleanup();
+            return false;
+        }
+        
+        pool.start(static_cast<size_t>(g_config.httpThreads));
+        blockingPool.start(static_cast<size_t>(g_config.httpBlockingThreads));
+        if (!reactor.start(&pool)) {
+            LOG_ERROR("HTTP reactor could not start");
+            blockingPool.stop();
+            pool.stop();
+            closesocket(serverSocket);
+            WSACleanup();
+            return false;
+        }
+        
+        running = true;
+        serverThread = std::thread(&HttpServer::serverLoop, this);
+        
+        LOG_INFO("HTTP Server listening on port " + std::to_string(port) + " (" +
+                 std::to_string(g_config.httpThreads) + " threads)");
+        return true;
+    }
+    
+    void stop() {
+        running = false;
+        
+        if (serverSocket != INVALID_SOCKET) {
+            closesocket(serverSocket);
+            serverSocket = INVALID_SOCKET;
+        }
+        
+        if (serverThread.joinable()) {
+            serverThread.join();
+        }
+        
+        // Requests and monitor streams still waiting are woken as timed out
+        // and finish on the pool; blocking handlers finish first, since they
+        // come back to it
+        reactor.stop();
+        blockingPool.stop();
+        pool.stop();
+        
+        WSACleanup();
+        LOG_INFO("HTTP Server stopped");
+    }
+    
+private:
+    void serverLoop() {
+        while (running) {
+            struct sockaddr_in clientAddr;
+            int clientLen = sizeof(clientAddr);
+            
+            SOCKET clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientLen);
+            if (clientSocket == INVALID_SOCKET) {
+                if (running) {
+                    LOG_ERROR("Accept failed");
+                }
+                continue;
+            }
+            
+            serve(clientSocket);
+        }
+    }
+    
+    // One connection from accept to close. The coroutine hops onto the pool
+    // at once and suspends, instead of holding a thread, whenever it waits
+    // for the socket or for JACK.
+    coro::Spawn serve(SOCKET clientSocket) {
+        auto accepted = std::chrono::steady_clock::now();
+        co_await pool.schedule();
+        inFlight.fetch_add(1, std::memory_order_relaxed);
+        u_long nonBlocking = 1;
+        ioctlsocket(clientSocket, FIONBIO, &nonBlocking);
+        
+        // Everything request-scoped lives in the arena, coroutine frames
+        // included; the heap should only be touched when a request or its
+        // response outgrows the inline buffer.
+        RequestArena arena(&arenaUpstream);
+        RequestTiming timing;
+        RequestContext context;
+        context.requestId = nextRequestId.fetch_add(1, std::memory_order_relaxed);
+        context.timing = &timing;
+        context.frames = arena.resource();
+        context.jackDeadline = accepted + std::chrono::milliseconds(g_config.jackTimeoutMs);
+        context.enter();
+        
+        std::pmr::string request(arena.resource());
+        bool received = false;
+        try {
+            received = co_await receiveRequest(clientSocket, request);
+        } catch (const std::exception&) {
+        }
+        
+        // Monitor streams keep the connection but not a thread: between
+        // chunks they sleep on the reactor like any other wait
+        std::string_view method, path, query;
+        parseRequestLine(request, method, path, query);
+        if (received && method == "GET" && path == "/stream") {
+            context.leave();
+            inFlight.fetch_sub(1, std::memory_order_relaxed);
+            try {
+                co_await streamMonitor(clientSocket, query);
+            } catch (const std::exception& e) {
+                LOG_ERROR(std::string("Monitor stream failed: ") + e.what());
+            }
+            closesocket(clientSocket);
+            co_return;
+        }
+        
+        // The client's budget counts from accept, so time spent queued for
+        // the pool is charged to it. JACK work is cut off at the deadline and
+        // a request that is already past it is dropped unanswered: its
+        // client has stopped listening.
+        bool hasDeadline = false;
+        std::chrono::steady_clock::time_point deadline;
+        if (received) {
+            long budgetMs = parseLong(headerValue(request, "x-request-timeout-ms"), -1);
+            if (budgetMs >= 0) {
+                hasDeadline = true;
+                deadline = accepted + std::chrono::milliseconds(budgetMs);
+                deadlineRequests.fetch_add(1, std::memory_order_relaxed);
+                if (deadline < context.jackDeadline) {
+                    context.jackDeadline = deadline;
+                    context.clientDeadline = true;
+                    t_jackDeadline = deadline;
+                    t_jackClientDeadline = true;
+                }
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    expiredBeforeStart.fetch_add(1, std::memory_order_relaxed);
+                    received = false;
+                }
+            }
+        }
+        
+        if (received) {
+            try {
+                TraceSpan requestSpan("request");
+                std::pmr::string response(arena.resource());
+                co_await processRequest(request, response, arena.resource(), timing);
+                
+                if (hasDeadline && std::chrono::steady_clock::now() >= deadline) {
+                    responsesDropped.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    TraceSpan sendSpan("send");
+                    co_await sendResponse(clientSocket, response);
+                }
+            } catch (const std::exception& e) {
+                LOG_ERROR(std::string("HTTP request failed: ") + e.what());
+            }
+        }
+        closesocket(clientSocket);
+        
+        context.leave();
+        if (received) {
+            recordRequestAllocations(context);
+        }
+        inFlight.fetch_sub(1, std::memory_order_relaxed);
+    }
+    
+    // Reads until the headers and Content-Length bytes of body have arrived
+    // (clients may send them in separate segments), kMaxRequestBytes have
+    // been read, the peer stops sending or goes quiet for kIdleTimeout
+    coro::Task<bool> receiveRequest(SOCKET clientSocket, std::pmr::string& request) {
+        auto deadline = std::chrono::steady_clock::now() + kIdleTimeout;
+        size_t expected = 0;    // 0 until the headers are complete
+        request.reserve(4096);
+        while (request.length() < kMaxRequestBytes && (expected == 0 || request.length() < expected)) {
+            size_t used = request.length();
+            request.resize(std::min(std::max(request.capacity(), used + 1024), kMaxRequestBytes));
+            int n = recv(clientSocket, request.data() + used, static_cast<int>(request.length() - used), 0);
+            request.resize(used + (n > 0 ? static_cast<size_t>(n) : 0));
+            if (n < 0 && WSAGetLastError() == WSAEWOULDBLOCK) {
+                if (!co_await reactor.readable(clientSocket, deadline)) break;
+                continue;
+            }
+            if (n <= 0) break;
+            
+            std::string_view data(request);
+            size_t headerEnd = data.find("\r\n\r\n");
+            if (expected == 0 && headerEnd != std::string_view::npos) {
+                expected = headerEnd + 4 + static_cast<size_t>(
+                    std::max(parseLong(headerValue(data.substr(0, headerEnd), "content-length"), 0), 0L));
+            }
+        }
+        co_return !request.empty();
+    }
+    
+    coro::Task<bool> sendResponse(SOCKET clientSocket, std::string_view response,
+                                  std::chrono::milliseconds timeout = kIdleTimeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        size_t sent = 0;
+        while (sent < response.length()) {
+            int n = send(clientSocket, response.data() + sent, static_cast<int>(response.length() - sent), 0);
+            if (n < 0 && WSAGetLastError() == WSAEWOULDBLOCK) {
+                if (!co_await reactor.writable(clientSocket, deadline)) co_return false;
+                continue;
+            }
+            if (n <= 0) co_return false;
+            sent += static_cast<size_t>(n);
+        }
+        co_return true;
+    }
+    
+    // co_await jack(fallback, fn); see JackAwait
+    template <typename Result>
+    JackAwait<Result> jack(Result fallback, std::function<Result()> fn) {
+        return JackAwait<Result>(jackManager, pool, reactor, std::move(fallback), std::move(fn));
+    }
+    
+    // What a route handler sees of its request besides the output buffer
+    struct Request {
+        std::string_view raw;               // request line, headers and body
+        std::string_view query;
+        http::RouteParams params;
+        std::pmr::memory_resource* mr;
+    };
+    
+    // Exactly one of the two is set: handlers that await JACK are coroutines.
+    // Shared ones are reads whose concurrent calls are coalesced (runShared);
+    // blocking ones are synchronous handlers run on blockingPool.
+    struct RouteHandler {
+        void (*sync)(HttpServer&, const Request&, std::pmr::string&) = nullptr;
+        coro::Task<> (*async)(HttpServer&, const Request&, std::pmr::string&) = nullptr;
+        bool shared = false;
+        bool blocking = false;
+    };
+    
+    // Calls a handler taking (out), (request text, out) or (Request, out)
+    template <auto Handler>
+    static auto invoke(HttpServer& server, const Request& request, std::pmr::string& out) {
+        using F = decltype(Handler);
+        if constexpr (std::is_invocable_v<F, HttpServer&, std::pmr::string&>) {
+            return (server.*Handler)(out);
+        } else if constexpr (std::is_invocable_v<F, HttpServer&, const Request&, std::pmr::string&>) {
+            return (server.*Handler)(request, out);
+        } else {
+            return (server.*Handler)(request.raw, out);
+        }
+    }
+    
+    template <auto Handler>
+    static constexpr RouteHandler route() {
+        RouteHandler handler;
+        using Result = decltype(invoke<Handler>(std::declval<HttpServer&>(), std::declval<const Request&>(),
+                                                std::declval<std::pmr::string&>()));
+        if constexpr (std::is_same_v<Result, coro::Task<>>) {
+            handler.async = &invoke<Handler>;
+        } else {
+            handler.sync = &invoke<Handler>;
+        }
+        return handler;
+    }
+    
+    template <auto Handler>
+    static constexpr RouteHandler blockingRoute() {
+        RouteHandler handler = route<Handler>();
+        handler.blocking = true;
+        return handler;
+    }
+    
+    template <auto Handler>
+    static constexpr RouteHandler sharedRoute() {
+        RouteHandler handler = route<Handler>();
+        handler.shared = true;
+        return handler;
+    }
+    
+    // The route table is hashed at compile time (include/route_table.h), so
+    // dispatch costs the same however many routes there are. A route with
+    // Method::Any answers every method that has no route of its own.
+    static const RouteHandler* findRoute(http::Method method, std::string_view path, http::RouteParams& params) {
+        using http::Method;
+        static constexpr http::Router router(std::to_array<http::Route<RouteHandler>>({
+            {Method::Any, "/health", route<&HttpServer::getHealthStatus>()},
+            {Method::Any, "/status", sharedRoute<&HttpServer::getJackStatus>()},
+            {Method::Any, "/ports", sharedRoute<&HttpServer::getJackPorts>()},
+            {Method::Any, "/connections", sharedRoute<&HttpServer::getJackConnections>()},
+            {Method::Any, "/snapshot", sharedRoute<&HttpServer::getSnapshot>()},
+            {Method::Any, "/connections/exists", sharedRoute<&HttpServer::getConnectionExists>()},
+            {Method::Any, "/ports/{name}/connections", sharedRoute<&HttpServer::getPortConnections>()},
+            {Method::Post, "/disconnect_port", route<&HttpServer::handleDisconnectPort>()},
+            {Method::Post, "/connect", route<&HttpServer::handleConnect>()},
+            {Method::Post, "/disconnect", route<&HttpServer::handleDisconnect>()},
+            {Method::Post, "/clear", route<&HttpServer::handleClearAll>()},
+            {Method::Any, "/stats", route<&HttpServer::getStats>()},
+            {Method::Any, "/stats/locks", route<&HttpServer::getLockStats>()},
+            {Method::Post, "/stats/locks/reset", route<&HttpServer::handleLockStatsReset>()},
+            {Method::Post, "/record/start", blockingRoute<&HttpServer::handleRecordStart>()},
+            {Method::Post, "/record/stop", route<&HttpServer::handleRecordStop>()},
+            {Method::Any, "/record", route<&HttpServer::getRecordings>()},
+            {Method::Post, "/replay/arm", route<&HttpServer::handleReplayArm>()},
+            {Method::Post, "/replay/disarm", route<&HttpServer::handleReplayDisarm>()},
+            {Method::Post, "/replay/dump", blockingRoute<&HttpServer::handleReplayDump>()},
+            {Method::Any, "/replay", route<&HttpServer::getReplayStatus>()},
+            {Method::Post, "/loudness/start", route<&HttpServer::handleLoudnessStart>()},
+            {Method::Post, "/loudness/stop", route<&HttpServer::handleLoudnessStop>()},
+            {Method::Post, "/loudness/reset", route<&HttpServer::handleLoudnessReset>()},
+            {Method::Any, "/loudness", route<&HttpServer::getLoudness>()},
+            {Method::Post, "/autoroute", route<&HttpServer::handleAutoRouteAdd>()},
+            {Method::Post, "/autoroute/remove", route<&HttpServer::handleAutoRouteRemove>()},
+            {Method::Any, "/autoroute", route<&HttpServer::getAutoRoutes>()},
+            {Method::Post, "/latency/measure", blockingRoute<&HttpServer::handleLatencyMeasure>()},
+            {Method::Any, "/latency", route<&HttpServer::getLatency>()},
+            {Method::Post, "/presets/apply", blockingRoute<&HttpServer::handlePresetApply>()},
+            {Method::Any, "/presets", route<&HttpServer::getPresets>()},
+            {Method::Post, "/midi/map", route<&HttpServer::handleMidiMap>()},
+            {Method::Post, "/midi/unmap", route<&HttpServer::handleMidiUnmap>()},
+            {Method::Any, "/midi", route<&HttpServer::getMidiStatus>()},
+            {Method::Post, "/mixer/gain", route<&HttpServer::handleMixerGain>()},
+            {Method::Post, "/mixer/mute", route<&HttpServer::handleMixerMute>()},
+            {Method::Post, "/mixer/learn", blockingRoute<&HttpServer::handleMixerLearn>()},
+            {Method::Post, "/mixer/unbind", route<&HttpServer::handleMixerUnbind>()},
+            {Method::Any, "/mixer", route<&HttpServer::getMixer>()},
+            {Method::Put, "/routing", route<&HttpServer::handleRoutingPut>()},
+            {Method::Delete, "/routing", route<&HttpServer::handleRoutingDelete>()},
+            {Method::Any, "/routing", route<&HttpServer::getRouting>()},
+            {Method::Any, "/mqtt", route<&HttpServer::getMqtt>()},
+            {Method::Any, "/spectrum", blockingRoute<&HttpServer::getSpectrum>()},
+            {Method::Any, "/monitor", route<&HttpServer::getMonitorStreams>()},
+            {Method::Any, "/trace", route<&HttpServer::getTrace>()},
+        }));
+        return router.find(method, path, params);
+    }
+    
+    // Sleeps, polls and disk I/O happen off the request pool. The request
+    // holds a blocking thread for as long as the handler runs and then
+    // comes back, so a saturated blocking pool only delays its own routes.
+    coro::Task<> runBlocking(const RouteHandler& handler, const Request& routed, std::pmr::string& out) {
+        co_await ResumeOn(blockingPool);
+        std::exception_ptr error;
+        try {
+            handler.sync(*this, routed, out);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        co_await ResumeOn(pool);
+        if (error) std::rethrow_exception(error);
+    }
+    
+    // Requests for the same path and query that overlap get the body, and
+    // the JACK outcome, of the one that started first
+    coro::Task<> runShared(const RouteHandler& handler, const Request& routed, std::string_view path,
+                           std::pmr::string& out) {
+        std::pmr::string key(path, routed.mr);
+        if (!routed.query.empty()) appendAll(key, "?", routed.query);
+        
+        SingleFlight::Joined joined = co_await flights.join(key);
+        if (joined.expired) {
+            t_jackTimedOut = true;
+            co_return;
+        }
+        if (joined.outcome) {
+            out.assign(joined.outcome->body);
+            t_jackRejected = joined.outcome->jackRejected;
+            co_return;
+        }
+        if (!joined.leader) {
+            co_await handler.async(*this, routed, out);     // the leader failed or timed out
+            co_return;
+        }
+        try {
+            co_await handler.async(*this, routed, out);
+        } catch (...) {
+            flights.land(key, nullptr);
+            throw;
+        }
+        if (t_jackTimedOut) {
+            flights.land(key, nullptr);
+            co_return;
+        }
+        flights.land(key, std::make_shared<const SingleFlight::Outcome>(
+            SingleFlight::Outcome{std::string(out), t_jackRejected}));
+    }
+    
+    coro::Task<> processRequest(std::string_view request, std::pmr::string& httpResponse,
+                                std::pmr::memory_resource* mr, const RequestTiming& timing) {
+        uint64_t startNs = TraceRegistry::instance().now();
+        std::string_view method, path, query;
+        {
+            TraceSpan span("parse");
+            parseRequestLine(request, method, path, query);
+        }
+        
+        LOG_DEBUG("Request: " + std::string(method) + " " + std::string(path));
+        
+        std::pmr::string responseBody(mr);
+        responseBody.reserve(1024);
+        const char* contentType = "application/json";
+        
+        // CORS headers
+        static constexpr std::string_view corsHeaders = 
+            "Access-Control-Allow-Origin: *\r\n"
+            "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
+            "Access-Control-Allow-Headers: Content-Type, X-Request-Timeout-Ms\r\n"
+            "Timing-Allow-Origin: *\r\n";
+        
+        try {
+            Request routed{request, query, {}, mr};
+            if (method == "OPTIONS") {
+                responseBody.clear();
+            } else if (const RouteHandler* handler = findRoute(http::parseMethod(method), path, routed.params)) {
+                if (handler->shared) {
+                    co_await runShared(*handler, routed, path, responseBody);
+                } else if (handler->blocking) {
+                    co_await runBlocking(*handler, routed, responseBody);
+                } else if (handler->async) {
+                    co_await handler->async(*this, routed, responseBody);
+                } else {
+                    handler->sync(*this, routed, responseBody);
+                }
+            } else {
+                responseBody += "{\"error\":\"Not found\",\"path\":\"";
+                appendJsonEscaped(responseBody, path);
+                responseBody += "\"}";
+            }
+        } catch (const std::exception& e) {
+            responseBody.clear();
+            appendAll(responseBody, "{\"error\":\"Internal server error\",\"message\":\"", e.what(), "\"}");
+        }
+        
+        // Whatever the handler made of the neutral values a timed-out or
+        // rejected JACK call returned, the caller is told the truth
+        const char* status = "200 OK";
+        uint64_t retryAfterSeconds = 0;
+        if (t_jackRejected) {
+            CircuitBreaker::Stats circuit = jackManager->circuit();
+            status = "503 Service Unavailable";
+            retryAfterSeconds = std::max<uint64_t>(1, (circuit.retryAfterMs + 999) / 1000);
+            responseBody.clear();
+            appendAll(responseBody,
+                "{\"success\":false,\"error\":\"JACK is not responding; failing fast until it recovers\","
+                "\"circuit\":\"", CircuitBreaker::stateName(circuit.state), "\","
+                "\"retry_after_ms\":", circuit.retryAfterMs, ",\"timestamp\":\"");
+            appendCurrentTimestamp(responseBody);
+            responseBody += "\"}";
+        } else if (t_jackTimedOut) {
+            status = "504 Gateway Timeout";
+            responseBody.clear();
+            appendAll(responseBody,
+                "{\"success\":false,\"error\":\"JACK did not answer within ", g_config.jackTimeoutMs,
+                " ms\",\"timestamp\":\"");
+            appendCurrentTimestamp(responseBody);
+            responseBody += "\"}";
+        }
+        
+        httpResponse.reserve(responseBody.length() + 512);
+        appendAll(httpResponse,
+            "HTTP/1.1 ", status, "\r\n",
+            corsHeaders,
+            "Content-Type: ", contentType, "\r\n"
+            "Content-Length: ", responseBody.length(), "\r\n");
+        if (retryAfterSeconds) {
+            appendAll(httpResponse, "Retry-After: ", retryAfterSeconds, "\r\n");
+        }
+        if (TraceRegistry::enabled()) {
+            appendServerTiming(httpResponse, timing, TraceRegistry::instance().now() - startNs);
+        }
+        appendAll(httpResponse, "\r\n", responseBody);
+    }
+    
+    // Server-Timing: parse;dur=0.004, jack_wait;dur=0.212, jack_connect;dur=0.210, total;dur=0.402
+    static void appendServerTiming(std::pmr::string& out, const RequestTiming& timing, uint64_t totalNs) {
+        out += "Server-Timing: ";
+        for (size_t i = 0; i < timing.count; i++) {
+            appendAll(out, timing.phases[i].name, ";dur=");
+            appendMillis(out, timing.phases[i].durationNs);
+            out += ", ";
+        }
+        out += "total;dur=";
+        appendMillis(out, totalNs);
+        out += "\r\n";
+    }
+    
+    static void appendMillis(std::pmr::string& out, uint64_t ns) {
+        char millis[32];
+        snprintf(millis, sizeof(millis), "%.3f", static_cast<double>(ns) / 1e6);
+        out += millis;
+    }
+    
+    static void parseRequestLine(std::string_view request, std::string_view& method,
+                                 std::string_view& path, std::string_view& query) {
+        size_t methodEnd = request.find(' ');
+        if (methodEnd == std::string_view::npos) return;
+        method = request.substr(0, methodEnd);
+        
+        size_t pathEnd = request.find_first_of(" \r\n", methodEnd + 1);
+        if (pathEnd == std::string_view::npos) pathEnd = request.length();
+        path = request.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+        
+        size_t queryStart = path.find('?');
+        if (queryStart != std::string_view::npos) {
+            query = path.substr(queryStart + 1);
+            path = path.substr(0, queryStart);
+        }
+    }
+    
+    // Value of a header field, name in lower case; empty if absent
+    static std::string_view headerValue(std::string_view request, std::string_view name) {
+        std::string_view headers = request.substr(0, request.find("\r\n\r\n"));
+        for (size_t line = headers.find("\r\n"); line != std::string_view::npos;
+             line = headers.find("\r\n", line + 2)) {
+            std::string_view field = headers.substr(line + 2);
+            field = field.substr(0, field.find("\r\n"));
+            if (field.length() <= name.length() || field[name.length()] != ':' ||
+                !std::equal(name.begin(), name.end(), field.begin(),
+                            [](char a, char b) { return a == tolower(static_cast<unsigned char>(b)); })) {
+                continue;
+            }
+            std::string_view value = field.substr(name.length() + 1);
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+            return value;
+        }
+        return {};
+    }
+    
+    // Value of name in "a=1&b=2", or empty
+    static std::string_view queryParam(std::string_view query, std::string_view name) {
+        while (!query.empty()) {
+            size_t end = query.find('&');
+            std::string_view pair = query.substr(0, end);
+            if (pair.length() > name.length() && pair.substr(0, name.length()) == name &&
+                pair[name.length()] == '=') {
+                return pair.substr(name.length() + 1);
+            }
+            if (end == std::string_view::npos) break;
+            query.remove_prefix(end + 1);
+        }
+        return {};
+    }
+    
+    static long parseLong(std::string_view text, long fallback) {
+        long value = 0;
+        auto result = std::from_chars(text.data(), text.data() + text.length(), value);
+        return (result.ec == std::errc() && result.ptr == text.data() + text.length()) ? value : fallback;
+    }
+    
+    // Append string-like and integral pieces without temporaries
+    static void appendPart(std::pmr::string& out, std::string_view part) { out.append(part); }
+    static void appendPart(std::pmr::string& out, const char* part) { out.append(part); }
+    static void appendPart(std::pmr::string& out, bool part) { out.append(part ? "true" : "false"); }
+    
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    static void appendPart(std::pmr::string& out, T value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+    
+    template <typename... Parts>
+    static void appendAll(std::pmr::string& out, const Parts&... parts) {
+        (appendPart(out, parts), ...);
+    }
+    
+    void recordRequestAllocations(const RequestContext& context) {
+        uint64_t allocations = context.allocations;
+        
+        requestCount.fetch_add(1, std::memory_order_relaxed);
+        requestHeapAllocations.fetch_add(allocations, std::memory_order_relaxed);
+        requestHeapBytes.fetch_add(context.bytes, std::memory_order_relaxed);
+        lastRequestHeapAllocations.store(allocations, std::memory_order_relaxed);
+        if (allocations == 0) {
+            zeroAllocationRequests.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    void appendCurrentTimestamp(std::pmr::string& out) {
+        appendTimestamp(out, std::chrono::system_clock::now());
+    }
+    
+    static void appendTimestamp(std::pmr::string& out, std::chrono::system_clock::time_point now) {
+        auto time_t = std::chrono::system_clock::to_time_t(now);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now.time_since_epoch()) % 1000;
+        
+        char buffer[64];
+        struct tm tm_buf;
+        if (gmtime_s(&tm_buf, &time_t) == 0) {
+            strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm_buf);
+        } else {
+            strcpy_s(buffer, "1970-01-01T00:00:00");
+        }
+        
+        char millis[8];
+        snprintf(millis, sizeof(millis), ".%03dZ", static_cast<int>(ms.count()));
+        appendAll(out, buffer, millis);
+    }
+    
+    // Always answers: a JACK timeout or an open circuit shows up as
+    // unhealthy, not as a 504 or 503
+    coro::Task<> getHealthStatus(std::pmr::string& out) {
+        bool jackOk = co_await jack<bool>(false, [jm = jackManager] { return jm->isRunning(); });
+        t_jackTimedOut = false;
+        t_jackRejected = false;
+        JackExecutor::Stats executor = jackManager->executorStats();
+        CircuitBreaker::Stats circuit = jackManager->circuit();
+        
+        appendAll(out,
+            "{\"status\":\"", jackOk ? "healthy" : "unhealthy", "\","
+            "\"service\":\"jack-bridge-local\","
+            "\"version\":\"1.0.0\","
+            "\"jack_running\":", jackOk, ","
+            "\"jack_executor\":{\"queued\":", executor.queued,
+            ",\"busy_ms\":", executor.busyMs,
+            ",\"tasks\":", executor.tasks,
+            ",\"batches\":", executor.batches,
+            ",\"largest_batch\":", executor.largestBatch,
+            ",\"timeouts\":", executor.timeouts,
+            ",\"dropped\":", executor.dropped,
+            ",\"restarts\":", executor.restarts, "},"
+            "\"circuit\":{\"state\":\"", CircuitBreaker::stateName(circuit.state), "\""
+            ",\"consecutive_failures\":", circuit.consecutiveFailures,
+            ",\"trips\":", circuit.trips,
+            ",\"rejected\":", circuit.rejected,
+            ",\"probes\":", circuit.probes,
+            ",\"retry_after_ms\":", circuit.retryAfterMs, "},"
+            "\"platform\":\"windows\","
+            "\"api\":\"native\","
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    coro::Task<> getJackStatus(std::pmr::string& out) {
+        using Status = std::pair<bool, JackInfo>;
+        auto [jackOk, info] = co_await jack<Status>(Status(), [jm = jackManager] {
+            bool running = jm->isRunning();
+            return Status(running, running ? jm->getJackInfo() : JackInfo());
+        });
+        
+        appendAll(out,
+            "{\"success\":", jackOk,
+            ",\"jack_running\":", jackOk,
+            ",\"method\":\"native_api\"");
+        
+        if (jackOk) {
+            appendAll(out,
+                ",\"sample_rate\":", info.sampleRate,
+                ",\"buffer_size\":", info.bufferSize,
+                ",\"client_name\":\"", info.clientName, "\"");
+        }
+        
+        out += ",\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // Null when JACK is not running
+    JackAwait<GraphPtr> runningGraph() {
+        return jack<GraphPtr>(nullptr, [jm = jackManager] { return jm->isRunning() ? jm->getGraph() : nullptr; });
+    }
+    
+    struct GraphRead {
+        GraphPtr graph;                 // null when JACK never answered
+        bool stale = false;
+        uint64_t ageMs = 0;
+    };
+    
+    // The live graph or, while JACK is down, not answering or behind an
+    // open breaker, the last one it gave us. A stale answer is still an
+    // answer, so the request is not failed for the call that missed.
+    coro::Task<GraphRead> readGraph() {
+        GraphPtr graph = co_await runningGraph();
+        if (graph) co_return GraphRead{std::move(graph)};
+        
+        JackManager::KnownGraph known = jackManager->lastKnownGraph();
+        if (!known.graph) co_return GraphRead{};
+        t_jackTimedOut = false;
+        t_jackRejected = false;
+        auto age = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - known.at);
+        co_return GraphRead{std::move(known.graph), true, static_cast<uint64_t>(age.count())};
+    }
+    
+    coro::Task<> getJackPorts(std::pmr::string& out) {
+        GraphRead read = co_await readGraph();
+        if (!read.graph) {
+            out += "{\"success\":false,\"error\":\"JACK not running\"}";
+            co_return;
+        }
+        
+        const auto& ports = read.graph->ports;
+        
+        TraceSpan span("serialize");
+        out += "{\"success\":true,\"ports\":[";
+        for (size_t i = 0; i < ports.size(); i++) {
+            appendAll(out, "\"", ports[i].view(), "\"");
+            if (i < ports.size() - 1) out += ",";
+        }
+        appendAll(out, "],"
+            "\"count\":", ports.size(), ","
+            "\"stale\":", read.stale, ","
+            "\"age_ms\":", read.ageMs, ","
+            "\"method\":\"native_api\","
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // Status, ports and connections from one executor task, so they agree
+    // with each other. While nothing has changed the serialised body is
+    // reused and only the timestamp is new.
+    coro::Task<> getSnapshot(std::pmr::string& out) {
+        struct Read {
+            bool running = false;
+            JackInfo info;
+            GraphPtr graph;
+        };
+        Read read = co_await jack<Read>(Read(), [jm = jackManager] {
+            Read r;
+            r.running = jm->isRunning();
+            if (r.running) {
+                r.info = jm->getJackInfo();
+                r.graph = jm->getGraph();
+            }
+            return r;
+        });
+        
+        if (!read.running) {
+            GraphRead known = co_await readGraph();
+            appendAll(out, "{\"success\":", known.graph != nullptr, ",\"jack_running\":false");
+            if (known.graph) {
+                appendGraph(out, *known.graph);
+                appendAll(out, ",\"stale\":true,\"age_ms\":", known.ageMs);
+            } else {
+                out += ",\"error\":\"JACK not running\"";
+            }
+            out += ",\"method\":\"native_api\",\"timestamp\":\"";
+            appendCurrentTimestamp(out);
+            out += "\"}";
+            co_return;
+        }
+        
+        std::shared_ptr<const SnapshotBody> cached;
+        {
+            std::lock_guard<InstrumentedMutex> lock(snapshotMutex);
+            cached = snapshotCache;
+        }
+        if (cached && cached->generation == read.graph->generation && cached->sampleRate == read.info.sampleRate &&
+            cached->bufferSize == read.info.bufferSize) {
+            snapshotHits.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            TraceSpan span("serialize");
+            std::pmr::string body(out.get_allocator());
+            body.reserve(256 + read.graph->ports.size() * 48 + read.graph->edges.size() * 96);
+            appendAll(body,
+                "{\"success\":true,\"jack_running\":true,"
+                "\"sample_rate\":", read.info.sampleRate, ","
+                "\"buffer_size\":", read.info.bufferSize, ","
+                "\"client_name\":\"", read.info.clientName, "\"");
+            appendGraph(body, *read.graph);
+            body += ",\"stale\":false,\"age_ms\":0,\"method\":\"native_api\",";
+            
+            auto next = std::make_shared<SnapshotBody>();
+            next->generation = read.graph->generation;
+            next->sampleRate = read.info.sampleRate;
+            next->bufferSize = read.info.bufferSize;
+            next->body.assign(body);
+            cached = std::move(next);
+            snapshotBuilds.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard<InstrumentedMutex> lock(snapshotMutex);
+            snapshotCache = cached;
+        }
+        out += cached->body;
+        out += "\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // ,"generation":..,"ports":[..],"port_count":..,"connections":[..],"connection_count":..
+    static void appendGraph(std::pmr::string& out, const GraphSnapshot& graph) {
+        appendAll(out, ",\"generation\":", graph.generation, ",\"ports\":[");
+        for (size_t i = 0; i < graph.ports.size(); i++) {
+            appendAll(out, i ? ",\"" : "\"", graph.ports[i].view(), "\"");
+        }
+        appendAll(out, "],\"port_count\":", graph.ports.size(), ",\"connections\":[");
+        for (size_t i = 0; i < graph.edges.size(); i++) {
+            appendAll(out, i ? "," : "", "{\"from\":\"", graph.fromName(graph.edges[i]).view(), "\","
+                                         "\"to\":\"", graph.toName(graph.edges[i]).view(), "\"}");
+        }
+        appendAll(out, "],\"connection_count\":", graph.edges.size());
+    }
+    
+    // GET /ports/{name}/connections, name percent-encoded
+    coro::Task<> getPortConnections(const Request& request, std::pmr::string& out) {
+        std::string name = urlDecode(request.params[0], false);
+        GraphRead read = co_await readGraph();
+        if (!read.graph) {
+            out += "{\"success\":false,\"error\":\"JACK not running\"}";
+            co_return;
+        }
+        const GraphSnapshot& graph = *read.graph;
+        uint32_t port = graph.findPort(name);
+        if (port == GraphSnapshot::kNoPort) {
+            out += "{\"success\":false,\"error\":\"Unknown port\",\"port\":\"";
+            appendJsonEscaped(out, name);
+            out += "\"}";
+            co_return;
+        }
+        
+        TraceSpan span("serialize");
+        std::span<const PortEdge> outgoing = graph.outgoing(port);
+        std::span<const uint32_t> incoming = graph.incoming(port);
+        auto appendEdge = [&](const char* separator, const PortEdge& edge) {
+            appendAll(out, separator, "{\"from\":\"", graph.fromName(edge).view(), "\","
+                                      "\"to\":\"", graph.toName(edge).view(), "\"}");
+        };
+        appendAll(out, "{\"success\":true,\"port\":\"", graph.ports[port].view(), "\",\"outgoing\":[");
+        for (size_t i = 0; i < outgoing.size(); i++) {
+            appendEdge(i ? "," : "", outgoing[i]);
+        }
+        out += "],\"incoming\":[";
+        for (size_t i = 0; i < incoming.size(); i++) {
+            appendEdge(i ? "," : "", graph.edges[incoming[i]]);
+        }
+        appendAll(out, "],"
+            "\"count\":", outgoing.size() + incoming.size(), ","
+            "\"stale\":", read.stale, ","
+            "\"age_ms\":", read.ageMs, ","
+            "\"method\":\"native_api\","
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // GET /connections/exists?source=a&destination=b
+    coro::Task<> getConnectionExists(const Request& request, std::pmr::string& out) {
+        std::string source = urlDecode(queryParam(request.query, "source"));
+        std::string destination = urlDecode(queryParam(request.query, "destination"));
+        if (source.empty() || destination.empty()) {
+            out += "{\"success\":false,\"error\":\"Missing source or destination\"}";
+            co_return;
+        }
+        GraphRead read = co_await readGraph();
+        if (!read.graph) {
+            out += "{\"success\":false,\"error\":\"JACK not running\"}";
+            co_return;
+        }
+        appendAll(out,
+            "{\"success\":true,"
+            "\"connected\":", read.graph->connected(source, destination), ","
+            "\"stale\":", read.stale, ","
+            "\"age_ms\":", read.ageMs, ","
+            "\"method\":\"native_api\","
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    coro::Task<> getJackConnections(std::pmr::string& out) {
+        GraphRead read = co_await readGraph();
+        if (!read.graph) {
+            out += "{\"success\":false,\"error\":\"JACK not running\"}";
+            co_return;
+        }
+        
+        const GraphPtr& graph = read.graph;
+        const auto& edges = graph->edges;
+        
+        TraceSpan span("serialize");
+        out += "{\"success\":true,\"connections\":[";
+        for (size_t i = 0; i < edges.size(); i++) {
+            appendAll(out, "{\"from\":\"", graph->fromName(edges[i]).view(), "\","
+                           "\"to\":\"", graph->toName(edges[i]).view(), "\"}");
+            if (i < edges.size() - 1) out += ",";
+        }
+        appendAll(out, "],"
+            "\"count\":", edges.size(), ","
+            "\"stale\":", read.stale, ","
+            "\"age_ms\":", read.ageMs, ","
+            "\"method\":\"native_api\","
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getStats(std::pmr::string& out) {
+        uint64_t requests = requestCount.load(std::memory_order_relaxed);
+        uint64_t allocations = requestHeapAllocations.load(std::memory_order_relaxed);
+        
+        char perRequest[32];
+        snprintf(perRequest, sizeof(perRequest), "%.3f",
+                 requests ? static_cast<double>(allocations) / static_cast<double>(requests) : 0.0);
+        
+        // Share of coalesced reads that did not compute their own answer
+        SingleFlight::Stats coalescing = flights.inspect();
+        uint64_t coalesced = coalescing.flights + coalescing.shared;
+        char sharedRatio[32];
+        snprintf(sharedRatio, sizeof(sharedRatio), "%.3f",
+                 coalesced ? static_cast<double>(coalescing.shared) / static_cast<double>(coalesced) : 0.0);
+        
+        appendAll(out,
+            "{\"success\":true,"
+            "\"allocations\":{"
+            "\"requests\":", requests, ","
+            "\"heap_allocations\":", allocations, ","
+            "\"heap_bytes\":", requestHeapBytes.load(std::memory_order_relaxed), ","
+            "\"heap_allocations_per_request\":", perRequest, ","
+            "\"last_request_heap_allocations\":", lastRequestHeapAllocations.load(std::memory_order_relaxed), ","
+            "\"zero_allocation_requests\":", zeroAllocationRequests.load(std::memory_order_relaxed), ","
+            "\"arena_inline_bytes\":", RequestArena::kInlineBytes, ","
+            "\"arena_overflows\":", arenaUpstream.overflows(), "},"
+            "\"http\":{"
+            "\"threads\":", pool.threads(), ","
+            "\"in_flight\":", inFlight.load(std::memory_order_relaxed), ","
+            "\"runnable\":", pool.queued(), ","
+            "\"blocking_threads\":", blockingPool.threads(), ","
+            "\"blocking_queued\":", blockingPool.queued(), ","
+            "\"waiting_io\":", reactor.waiting(), "},"
+            "\"deadlines\":{"
+            "\"requests\":", deadlineRequests.load(std::memory_order_relaxed), ","
+            "\"expired_before_start\":", expiredBeforeStart.load(std::memory_order_relaxed), ","
+            "\"responses_dropped\":", responsesDropped.load(std::memory_order_relaxed), ","
+            "\"jack_ops_dropped\":", jackManager->executorStats().dropped, "},"
+            "\"coalescing\":{"
+            "\"flights\":", coalescing.flights, ","
+            "\"shared\":", coalescing.shared, ","
+            "\"expired\":", coalescing.expired, ","
+            "\"in_flight\":", coalescing.inFlight, ","
+            "\"ratio\":", sharedRatio, "},"
+            "\"snapshot\":{"
+            "\"builds\":", snapshotBuilds.load(std::memory_order_relaxed), ","
+            "\"hits\":", snapshotHits.load(std::memory_order_relaxed), "},"
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    static void appendHistogram(std::pmr::string& out, const char* key, uint64_t totalNs, uint64_t maxNs,
+                                const std::array<uint64_t, InstrumentedMutex::kHistogramBuckets>& buckets) {
+        appendAll(out, "\"", key, "\":{"
+            "\"total_us\":", totalNs / 1000, ","
+            "\"max_us\":", maxNs / 1000, ","
+            "\"histogram\":[");
+        bool first = true;
+        for (size_t i = 0; i < buckets.size(); i++) {
+            if (buckets[i] == 0) continue;
+            if (!first) out += ",";
+            first = false;
+            // The open-ended last bucket reports the longest time it saw
+            uint64_t bound = InstrumentedMutex::bucketUpperBoundNs(i);
+            appendAll(out, "{\"le_ns\":", bound == UINT64_MAX ? maxNs : bound, ",\"count\":", buckets[i], "}");
+        }
+        out += "]}";
+    }
+    
+    static std::string_view baseName(const char* file) {
+        std::string_view path(file ? file : "unknown");
+        size_t slash = path.find_last_of("/\\");
+        return slash == std::string_view::npos ? path : path.substr(slash + 1);
+    }
+    
+    void getLockStats(std::pmr::string& out) {
+        appendAll(out, "{\"success\":true,\"enabled\":", InstrumentedMutex::enabled(), ",\"locks\":[");
+        
+        bool first = true;
+        InstrumentedMutex::forEach([&](const InstrumentedMutex& mutex) {
+            InstrumentedMutex::Stats stats = mutex.stats();
+            if (!first) out += ",";
+            first = false;
+            
+            appendAll(out,
+                "{\"name\":\"", stats.name, "\","
+                "\"acquisitions\":", stats.acquisitions, ","
+                "\"contended\":", stats.contended, ",");
+            appendHistogram(out, "wait", stats.waitTotalNs, stats.waitMaxNs, stats.waitHistogram);
+            out += ",";
+            appendHistogram(out, "hold", stats.holdTotalNs, stats.holdMaxNs, stats.holdHistogram);
+            
+            out += ",\"longest_holds\":[";
+            for (size_t i = 0; i < stats.longestHolds.size(); i++) {
+                const auto& hold = stats.longestHolds[i];
+                if (i > 0) out += ",";
+                appendAll(out,
+                    "{\"hold_us\":", hold.holdNs / 1000, ","
+                    "\"file\":\"", baseName(hold.site.file), "\","
+                    "\"line\":", hold.site.line, ","
+                    "\"function\":\"", hold.site.function ? hold.site.function : "unknown", "\"}");
+            }
+            out += "]}";
+        });
+        
+        out += "],\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void handleLockStatsReset(std::pmr::string& out) {
+        InstrumentedMutex::forEach([](InstrumentedMutex& mutex) { mutex.reset(); });
+        
+        out += "{\"success\":true,\"message\":\"Lock statistics reset\",\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // Chrome / Perfetto trace of the last ?seconds=N (default 10, max 600)
+    void getTrace(const Request& request, std::pmr::string& out) {
+        long seconds = parseLong(queryParam(request.query, "seconds"), 10);
+        if (seconds < 1) seconds = 1;
+        if (seconds > 600) seconds = 600;
+        
+        TraceRegistry& registry = TraceRegistry::instance();
+        uint64_t now = registry.now();
+        uint64_t windowNs = static_cast<uint64_t>(seconds) * 1000000000ull;
+        
+        std::pmr::vector<TraceEvent> events(request.mr);
+        registry.collect(now > windowNs ? now - windowNs : 0, events);
+        
+        out.reserve(events.size() * 110 + 256);
+        out += "{\"traceEvents\":[";
+        char timing[64];
+        for (size_t i = 0; i < events.size(); i++) {
+            const TraceEvent& event = events[i];
+            if (i > 0) out += ",";
+            snprintf(timing, sizeof(timing), "\"ts\":%.3f,\"dur\":%.3f",
+                     static_cast<double>(event.startNs) / 1000.0,
+                     static_cast<double>(event.durationNs) / 1000.0);
+            appendAll(out, "{\"name\":\"", event.name, "\",\"ph\":\"X\",", timing,
+                      ",\"pid\":1,\"tid\":", event.threadId);
+            if (event.requestId != 0) {
+                appendAll(out, ",\"args\":{\"request\":", event.requestId, "}");
+            }
+            out += "}";
+        }
+        appendAll(out, "],"
+            "\"displayTimeUnit\":\"ms\","
+            "\"otherData\":{"
+            "\"service\":\"jack-bridge-local\","
+            "\"window_seconds\":", seconds, ","
+            "\"events\":", events.size(), ","
+            "\"thread_buffers\":", registry.bufferCount(), ","
+            "\"untraced_threads\":", registry.droppedThreads(), "}}");
+    }
+    
+    // Position just past "key": in a flat JSON body, or npos
+    static size_t findJsonValue(std::string_view json, std::string_view key) {
+        size_t pos = 0;
+        while ((pos = json.find(key, pos)) != std::string_view::npos) {
+            size_t keyEnd = pos + key.length();
+            bool quoted = pos > 0 && json[pos - 1] == '"' && keyEnd < json.length() && json[keyEnd] == '"';
+            pos = keyEnd;
+            if (!quoted) continue;
+            
+            size_t i = keyEnd + 1;
+            while (i < json.length() && isspace(static_cast<unsigned char>(json[i]))) i++;
+            if (i >= json.length() || json[i] != ':') continue;
+            i++;
+            while (i < json.length() && isspace(static_cast<unsigned char>(json[i]))) i++;
+            return i;
+        }
+        return std::string_view::npos;
+    }
+    
+    // Finds "key":"value" in a flat JSON body; the view points into the request buffer
+    static std::string_view extractJsonValue(std::string_view json, std::string_view key) {
+        size_t i = findJsonValue(json, key);
+        if (i >= json.length() || json[i] != '"') return {};
+        
+        size_t valueStart = i + 1;
+        size_t valueEnd = json.find('"', valueStart);
+        if (valueEnd == std::string_view::npos) return {};
+        return json.substr(valueStart, valueEnd - valueStart);
+    }
+    
+    // "key": 12.5 (or "key": "12.5")
+    static bool extractJsonNumber(std::string_view json, std::string_view key, double& value) {
+        size_t i = findJsonValue(json, key);
+        if (i >= json.length()) return false;
+        if (json[i] == '"') i++;
+        
+        char digits[64];
+        size_t n = 0;
+        while (i < json.length() && n < sizeof(digits) - 1 &&
+               (isdigit(static_cast<unsigned char>(json[i])) || json[i] == '-' || json[i] == '+' ||
+                json[i] == '.' || json[i] == 'e' || json[i] == 'E')) {
+            digits[n++] = json[i++];
+        }
+        digits[n] = '\0';
+        if (n == 0) return false;
+        
+        char* end = nullptr;
+        value = std::strtod(digits, &end);
+        return end == digits + n;
+    }
+    
+    // "key": true / false
+    static bool extractJsonBool(std::string_view json, std::string_view key, bool& value) {
+        size_t i = findJsonValue(json, key);
+        if (i >= json.length()) return false;
+        std::string_view rest = json.substr(i);
+        if (rest.substr(0, 4) == "true") {
+            value = true;
+            return true;
+        }
+        if (rest.substr(0, 5) == "false") {
+            value = false;
+            return true;
+        }
+        return false;
+    }
+    
+    // "key": ["a", "b"] into PortNames; false on a malformed or oversize entry
+    static bool extractJsonPortArray(std::string_view json, std::string_view key, std::vector<PortName>& out) {
+        size_t i = findJsonValue(json, key);
+        if (i >= json.length() || json[i] != '[') return false;
+        
+        size_t end = json.find(']', i);
+        if (end == std::string_view::npos) return false;
+        
+        std::string_view items = json.substr(i + 1, end - i - 1);
+        size_t pos = 0;
+        while ((pos = items.find('"', pos)) != std::string_view::npos) {
+            size_t close = items.find('"', pos + 1);
+            if (close == std::string_view::npos) return false;
+            PortName name;
+            if (!name.assign(items.substr(pos + 1, close - pos - 1)) || name.empty()) return false;
+            out.push_back(name);
+            pos = close + 1;
+        }
+        return true;
+    }
+    
+    // Bridge requests name ports either as "ports":[...] or a single "port"
+    static bool extractPortList(std::string_view body, std::vector<PortName>& ports) {
+        if (findJsonValue(body, "ports") != std::string_view::npos) {
+            return extractJsonPortArray(body, "ports", ports);
+        }
+        PortName single;
+        if (!single.assign(extractJsonValue(body, "port"))) return false;
+        if (!single.empty()) ports.push_back(single);
+        return true;
+    }
+    
+    static std::string_view requestBody(std::string_view request) {
+        auto bodyStart = request.find("\r\n\r\n");
+        return bodyStart == std::string_view::npos ? std::string_view() : request.substr(bodyStart + 4);
+    }
+    
+    void handleRecordStart(std::string_view request, std::pmr::string& out) {
+        std::string_view body = requestBody(request);
+        std::vector<PortName> sources;
+        if (!extractPortList(body, sources) || sources.empty()) {
+            out += "{\"success\":false,\"error\":\"Missing or invalid ports\"}";
+            return;
+        }
+        if (sources.size() > 64) {
+            out += "{\"success\":false,\"error\":\"Too many channels\"}";
+            return;
+        }
+        
+        std::string error;
+        int id = recordings->start(sources, std::string(extractJsonValue(body, "file")), error);
+        if (id == 0) {
+            out += "{\"success\":false,\"error\":\"";
+            appendJsonEscaped(out, error);
+            out += "\"}";
+            return;
+        }
+        
+        appendAll(out, "{\"success\":true,\"id\":", id, ",\"channels\":", sources.size(), ",\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void handleRecordStop(std::string_view request, std::pmr::string& out) {
+        double id = 0;
+        if (!extractJsonNumber(requestBody(request), "id", id)) {
+            out += "{\"success\":false,\"error\":\"Missing recording id\"}";
+            return;
+        }
+        
+        RecordingManager::Summary summary;
+        if (!recordings->stop(static_cast<int>(id), summary)) {
+            out += "{\"success\":false,\"error\":\"No such recording\"}";
+            return;
+        }
+        
+        char seconds[32];
+        snprintf(seconds, sizeof(seconds), "%.3f",
+                 summary.sampleRate ? static_cast<double>(summary.frames) / summary.sampleRate : 0.0);
+        appendAll(out,
+            "{\"success\":", !summary.writeFailed, ","
+            "\"id\":", summary.id, ","
+            "\"file\":\"");
+        appendJsonEscaped(out, summary.file);
+        appendAll(out, "\","
+            "\"channels\":", summary.channels, ","
+            "\"frames\":", summary.frames, ","
+            "\"seconds\":", seconds, ","
+            "\"overruns\":", summary.overruns, ","
+            "\"overrun_frames\":", summary.overrunFrames, ","
+            "\"write_failed\":", summary.writeFailed, ","
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getRecordings(std::pmr::string& out) {
+        out += "{\"success\":true,\"recordings\":[";
+        bool first = true;
+        recordings->forEach([&](int id, const std::vector<PortName>& sources, const Recording& recording) {
+            if (!first) out += ",";
+            first = false;
+            
+            char stats[96];
+            snprintf(stats, sizeof(stats), "\"seconds\":%.3f,\"ring_fill\":%.3f",
+                     static_cast<double>(recording.writtenFrames()) / recording.sampleRate(), recording.ringFill());
+            appendAll(out, "{\"id\":", id, ",\"file\":\"");
+            appendJsonEscaped(out, recording.path());
+            out += "\",\"ports\":[";
+            for (size_t i = 0; i < sources.size(); i++) {
+                out += i ? ",\"" : "\"";
+                appendJsonEscaped(out, sources[i].view());
+                out += "\"";
+            }
+            appendAll(out, "],"
+                "\"captured_frames\":", recording.capturedFrames(), ","
+                "\"written_frames\":", recording.writtenFrames(), ",",
+                stats, ","
+                "\"overruns\":", recording.overruns(), ","
+                "\"overrun_frames\":", recording.overrunFrames(), ","
+                "\"write_failed\":", recording.writeFailed(), "}");
+        });
+        out += "],\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // {"ports":[...], "seconds":300 | "minutes":5, "compress":true, "memory_mb":64}
+    void handleReplayArm(std::string_view request, std::pmr::string& out) {
+        std::string_view body = requestBody(request);
+        ReplayManager::Settings settings;
+        if (!extractPortList(body, settings.sources) || settings.sources.empty()) {
+            out += "{\"success\":false,\"error\":\"Missing or invalid ports\"}";
+            return;
+        }
+        
+        double value = 0;
+        settings.seconds = g_config.replayMinutes * 60;
+        if (extractJsonNumber(body, "seconds", value)) {
+            settings.seconds = value;
+        } else if (extractJsonNumber(body, "minutes", value)) {
+            settings.seconds = value * 60;
+        }
+        settings.compress = g_config.replayCompress;
+        extractJsonBool(body, "compress", settings.compress);
+        settings.storeBytes = g_config.replayMemoryMb * 1024 * 1024;
+        if (extractJsonNumber(body, "memory_mb", value) && value >= 0) {
+            settings.storeBytes = static_cast<size_t>(value * 1024 * 1024);
+        }
+        
+        std::string error;
+        if (!replay->arm(settings, error)) {
+            out += "{\"success\":false,\"error\":\"";
+            appendJsonEscaped(out, error);
+            out += "\"}";
+            return;
+        }
+        out += "{\"success\":true,";
+        appendReplayStats(out);
+        out += ",\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void handleReplayDisarm(std::pmr::string& out) {
+        replay->disarm();
+        out += "{\"success\":true,\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // {"seconds":30, "offset":0, "file":"take.wav"}: the 30 s ending `offset` s ago
+    void handleReplayDump(std::string_view request, std::pmr::string& out) {
+        std::string_view body = requestBody(request);
+        double seconds = ReplayManager::kMaxSeconds, offset = 0;
+        extractJsonNumber(body, "seconds", seconds);
+        extractJsonNumber(body, "offset", offset);
+        if (!(seconds > 0) || !(offset >= 0)) {
+            out += "{\"success\":false,\"error\":\"Invalid window\"}";
+            return;
+        }
+        
+        std::string path, error;
+        uint64_t frames = 0;
+        if (!replay->dump(offset, seconds, std::string(extractJsonValue(body, "file")), path, frames, error)) {
+            out += "{\"success\":false,\"error\":\"";
+            appendJsonEscaped(out, error);
+            out += "\"}";
+            return;
+        }
+        
+        out += "{\"success\":true,\"file\":\"";
+        appendJsonEscaped(out, path);
+        appendAll(out, "\",\"frames\":", frames, ",\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getReplayStatus(std::pmr::string& out) {
+        out += "{\"success\":true,";
+        appendReplayStats(out);
+        out += ",\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void appendReplayStats(std::pmr::string& out) {
+        bool armed = replay->inspect([&](const ReplayManager::Settings& settings, ReplayBuffer& buffer) {
+            ReplayBuffer::Stats stats = buffer.stats();
+            char numbers[160];
+            snprintf(numbers, sizeof(numbers),
+                     "\"window_seconds\":%.1f,\"retained_seconds\":%.3f,\"compression_ratio\":%.3f",
+                     stats.windowSeconds, stats.retainedSeconds,
+                     stats.storeRawBytes ? static_cast<double>(stats.storeUsedBytes) / stats.storeRawBytes : 1.0);
+            out += "\"armed\":true,\"ports\":[";
+            for (size_t i = 0; i < settings.sources.size(); i++) {
+                out += i ? ",\"" : "\"";
+                appendJsonEscaped(out, settings.sources[i].view());
+                out += "\"";
+            }
+            appendAll(out, "],"
+                "\"sample_rate\":", stats.sampleRate, ","
+                "\"compressed\":", stats.compressed, ",",
+                numbers, ","
+                "\"memory_bytes\":", stats.memoryBytes, ","
+                "\"store_used_bytes\":", stats.storeUsedBytes, ","
+                "\"captured_frames\":", stats.capturedFrames, ","
+                "\"lost_frames\":", stats.lostFrames);
+        });
+        if (!armed) {
+            out += "\"armed\":false";
+        }
+    }
+    
+    // GET /stream?ports=a,b&mix=mono&decimate=2&format=wav&encoding=s16&buffer_ms=250
+    // Streams until the client hangs up. The connection thread does all the
+    // mixing, decimation and encoding; a client that cannot keep up loses
+    // the oldest audio beyond buffer_ms instead of holding anything back.
+    // Runs on the pool for as long as the client listens; stop() wakes it
+    // through the reactor and the pool finishes it before returning
+    coro::Task<> streamMonitor(SOCKET clientSocket, std::string_view query) {
+        MonitorManager::Session session;
+        std::string error;
+        
+        std::string ports = urlDecode(queryParam(query, "ports"));
+        if (ports.empty()) ports = urlDecode(queryParam(query, "port"));
+        std::string_view list = ports;
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            PortName name;
+            if (!name.assign(list.substr(0, comma)) || name.empty()) {
+                error = "Invalid port name";
+                break;
+            }
+            session.sources.push_back(name);
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        }
+        if (error.empty() && (session.sources.empty() || session.sources.size() > MonitorTap::kMaxSlots)) {
+            error = "Specify 1-" + std::to_string(MonitorTap::kMaxSlots) + " ports";
+        }
+        
+        bool mono = queryParam(query, "mix") == "mono";
+        bool wav = queryParam(query, "format") != "raw";
+        bool floatSamples = queryParam(query, "encoding") == "f32";
+        long factor = parseLong(queryParam(query, "decimate"), 1);
+        long bufferMs = parseLong(queryParam(query, "buffer_ms"), 250);
+        if (error.empty() && (factor < 1 || factor > 8)) error = "decimate must be 1-8";
+        if (error.empty() && (bufferMs < 20 || bufferMs > 1500)) error = "buffer_ms must be 20-1500";
+        
+        size_t inChannels = session.sources.size();
+        size_t outChannels = mono ? 1 : inChannels;
+        if (error.empty() && monitors->attach(session, error)) {
+            uint32_t outRate = session.tap->sampleRate() / static_cast<uint32_t>(factor);
+            session.format = std::string(floatSamples ? "f32le" : "s16le") + ";rate=" + std::to_string(outRate) +
+                             ";channels=" + std::to_string(outChannels);
+        }
+        if (!session.tap) {
+            std::string body = "{\"success\":false,\"error\":\"";
+            appendJsonEscaped(body, error);
+            body += "\"}";
+            std::string response = "HTTP/1.1 200 OK\r\nAccess-Control-Allow-Origin: *\r\n"
+                                   "Content-Type: application/json\r\nContent-Length: " +
+                                   std::to_string(body.length()) + "\r\n\r\n" + body;
+            co_await sendResponse(clientSocket, response);
+            co_return;
+        }
+        
+        // Small writes go out immediately
+        BOOL noDelay = TRUE;
+        setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+        
+        std::string header = std::string("HTTP/1.1 200 OK\r\n"
+            "Access-Control-Allow-Origin: *\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "Content-Type: ") + (wav ? "audio/wav" : "application/octet-stream") + "\r\n"
+            "X-Audio-Format: " + session.format + "\r\n\r\n";
+        bool connected = co_await sendResponse(clientSocket, header, kStreamSendTimeout);
+        
+        MonitorTap& tap = *session.tap;
+        uint32_t outRate = tap.sampleRate() / static_cast<uint32_t>(factor);
+        if (connected && wav) {
+            char wavHeader[44];
+            streamingWavHeader(wavHeader, outRate, static_cast<uint16_t>(outChannels), floatSamples);
+            connected = co_await sendChunk(clientSocket, wavHeader, sizeof(wavHeader), session);
+        }
+        
+        constexpr size_t kChunkFrames = 2048;
+        uint64_t queueFrames = static_cast<uint64_t>(tap.sampleRate()) * bufferMs / 1000;
+        std::vector<float> slotSamples(kChunkFrames * inChannels);
+        std::vector<float> frames(kChunkFrames * outChannels);
+        std::vector<float> decimated((kChunkFrames + 1) * outChannels);
+        std::vector<char> encoded(decimated.size() * sizeof(float));
+        Decimator decimator(static_cast<unsigned>(factor), outChannels);
+        
+        uint64_t cursor = 0;
+        bool started = false;
+        while (connected && running && g_serviceRunning && !tap.closed()) {
+            uint64_t newest = tap.writeFrame();
+            
+            // Slots claimed by this stream carry audio from the cycle after attach
+            if (!started) {
+                if (newest > session.startAfter) {
+                    cursor = newest;
+                    started = true;
+                }
+                co_await reactor.sleepUntil(std::chrono::steady_clock::now() + kStreamPoll);
+                continue;
+            }
+            
+            if (newest - cursor > queueFrames || newest - cursor > tap.readableFrames()) {
+                uint64_t resume = newest - std::min<uint64_t>(queueFrames / 2, tap.readableFrames());
+                session.droppedFrames.fetch_add(resume - cursor, std::memory_order_relaxed);
+                cursor = resume;
+            }
+            if (newest == cursor) {
+                co_await reactor.sleepUntil(std::chrono::steady_clock::now() + kStreamPoll);
+                continue;
+            }
+            
+            size_t count = static_cast<size_t>(std::min<uint64_t>(newest - cursor, kChunkFrames));
+            bool intact = true;
+            for (size_t ch = 0; ch < inChannels && intact; ch++) {
+                intact = tap.read(session.slots[ch], cursor, count, slotSamples.data() + ch * count);
+            }
+            if (!intact) {
+                continue;   // lapped during the copy; the lag check resynchronizes
+            }
+            cursor += count;
+            
+            for (size_t i = 0; i < count; i++) {
+                if (mono) {
+                    float sum = 0;
+                    for (size_t ch = 0; ch < inChannels; ch++) sum += slotSamples[ch * count + i];
+                    frames[i] = sum / static_cast<float>(inChannels);
+                } else {
+                    for (size_t ch = 0; ch < inChannels; ch++) frames[i * inChannels + ch] = slotSamples[ch * count + i];
+                }
+            }
+            size_t samples = decimator.process(frames.data(), count, decimated.data()) * outChannels;
+            
+            size_t bytes = 0;
+            if (floatSamples) {
+                bytes = samples * sizeof(float);
+                std::memcpy(encoded.data(), decimated.data(), bytes);
+            } else {
+                for (size_t i = 0; i < samples; i++) {
+                    float v = std::clamp(decimated[i], -1.0f, 1.0f);
+                    int16_t pcm = static_cast<int16_t>(std::lrint(v * 32767.0f));
+                    std::memcpy(encoded.data() + bytes, &pcm, sizeof(pcm));
+                    bytes += sizeof(pcm);
+                }
+            }
+            if (bytes > 0) {
+                connected = co_await sendChunk(clientSocket, encoded.data(), bytes, session);
+            }
+        }
+        
+        if (connected) {
+            co_await sendResponse(clientSocket, "0\r\n\r\n", kStreamSendTimeout);
+        }
+        monitors->detach(session);
+    }
+    
+    // A client that takes longer than kStreamSendTimeout for one chunk is
+    // treated as gone
+    coro::Task<bool> sendChunk(SOCKET socket, const char* data, size_t length, MonitorManager::Session& session) {
+        char size[16];
+        int n = snprintf(size, sizeof(size), "%zx\r\n", length);
+        bool ok = co_await sendResponse(socket, std::string_view(size, static_cast<size_t>(n)), kStreamSendTimeout) &&
+                  co_await sendResponse(socket, std::string_view(data, length), kStreamSendTimeout) &&
+                  co_await sendResponse(socket, "\r\n", kStreamSendTimeout);
+        if (ok) {
+            session.sentBytes.fetch_add(length, std::memory_order_relaxed);
+        }
+        co_return ok;
+    }
+    
+    // %XX and '+' in query values (port names may contain spaces); a '+'
+    // in a path segment is literal
+    static std::string urlDecode(std::string_view text, bool plusIsSpace = true) {
+        std::string out;
+        out.reserve(text.length());
+        for (size_t i = 0; i < text.length(); i++) {
+            if (text[i] == '+' && plusIsSpace) {
+                out += ' ';
+            } else if (text[i] == '%' && i + 2 < text.length() &&
+                       isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+                       isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+                out += static_cast<char>(std::stoi(std::string(text.substr(i + 1, 2)), nullptr, 16));
+                i += 2;
+            } else {
+                out += text[i];
+            }
+        }
+        return out;
+    }
+    
+    // GET /spectrum?port=system:capture_1&size=4096&average=8&window=hann&max_hz=1000&peaks=5
+    void getSpectrum(const Request& request, std::pmr::string& out) {
+        std::string_view query = request.query;
+        SpectrumAnalyzer::Params params;
+        std::string port = urlDecode(queryParam(query, "port"));
+        long size = parseLong(queryParam(query, "size"), 4096);
+        long average = parseLong(queryParam(query, "average"), 8);
+        long peakCount = parseLong(queryParam(query, "peaks"), 5);
+        long maxHz = parseLong(queryParam(query, "max_hz"), 0);
+        std::string_view window = queryParam(query, "window");
+        
+        if (!params.port.assign(port) || params.port.empty()) {
+            out += "{\"success\":false,\"error\":\"Missing or invalid port\"}";
+            return;
+        }
+        if (size < 0 || !RealFft::validSize(static_cast<size_t>(size))) {
+            out += "{\"success\":false,\"error\":\"size must be a power of two, 16-65536\"}";
+            return;
+        }
+        if (average < 1 || average > 256 || peakCount < 0 || peakCount > 32 || maxHz < 0) {
+            out += "{\"success\":false,\"error\":\"Invalid average, peaks or max_hz\"}";
+            return;
+        }
+        if (window.empty() || window == "hann") {
+            params.window = SpectrumWindow::Hann;
+        } else if (window == "blackman") {
+            params.window = SpectrumWindow::BlackmanHarris;
+        } else if (window == "rect") {
+            params.window = SpectrumWindow::Rectangular;
+        } else {
+            out += "{\"success\":false,\"error\":\"window must be hann, blackman or rect\"}";
+            return;
+        }
+        params.size = static_cast<size_t>(size);
+        params.average = static_cast<unsigned>(average);
+        
+        SpectrumAnalyzer::Result result;
+        std::string error;
+        {
+            TraceSpan span("spectrum");
+            if (!spectrum->latest(params, result, error)) {
+                out += "{\"success\":false,\"error\":\"";
+                appendJsonEscaped(out, error);
+                out += "\"}";
+                return;
+            }
+        }
+        
+        TraceSpan serialize("serialize");
+        double binHz = static_cast<double>(result.sampleRate) / params.size;
+        size_t bins = result.db.size();
+        if (maxHz > 0) {
+            bins = std::min(bins, static_cast<size_t>(maxHz / binHz) + 1);
+        }
+        
+        // Strongest local maxima, frequency refined by a parabola through the peak bin
+        std::vector<std::pair<float, double>> peaks;
+        for (size_t k = 1; k + 1 < bins; k++) {
+            float a = result.db[k - 1], b = result.db[k], c = result.db[k + 1];
+            if (b > a && b >= c) {
+                double denominator = a - 2 * b + c;
+                double shift = denominator != 0 ? 0.5 * (a - c) / denominator : 0;
+                peaks.emplace_back(b, (k + shift) * binHz);
+            }
+        }
+        size_t keep = std::min(peaks.size(), static_cast<size_t>(peakCount));
+        std::partial_sort(peaks.begin(), peaks.begin() + keep, peaks.end(),
+                          [](const auto& x, const auto& y) { return x.first > y.first; });
+        
+        char number[48];
+        snprintf(number, sizeof(number), "%.6f", binHz);
+        out += "{\"success\":true,\"port\":\"";
+        appendJsonEscaped(out, params.port.view());
+        appendAll(out, "\","
+            "\"sample_rate\":", result.sampleRate, ","
+            "\"size\":", params.size, ","
+            "\"average\":", params.average, ","
+            "\"window\":\"", spectrumWindowName(params.window), "\","
+            "\"bin_hz\":", number, ","
+            "\"sequence\":", result.sequence, ","
+            "\"averaged_frames\":", result.averaged, ","
+            "\"peaks\":[");
+        for (size_t i = 0; i < keep; i++) {
+            snprintf(number, sizeof(number), "%s{\"hz\":%.2f,\"db\":%.1f}", i ? "," : "",
+                     peaks[i].second, peaks[i].first);
+            out += number;
+        }
+        out += "],\"bins\":[";
+        for (size_t k = 0; k < bins; k++) {
+            snprintf(number, sizeof(number), k ? ",%.1f" : "%.1f", result.db[k]);
+            out += number;
+        }
+        out += "],\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // {"ports":["jack-bridge-local:out_1","jack-bridge-local:out_2"],"name":"Headphones"}
+    void handleLoudnessStart(std::string_view request, std::pmr::string& out) {
+        std::string_view body = requestBody(request);
+        std::vector<PortName> sources;
+        if (!extractPortList(body, sources) || sources.empty()) {
+            out += "{\"success\":false,\"error\":\"Missing or invalid ports\"}";
+            return;
+        }
+        
+        std::string error;
+        int id = loudness->start(sources, std::string(extractJsonValue(body, "name")), error);
+        if (id == 0) {
+            out += "{\"success\":false,\"error\":\"";
+            appendJsonEscaped(out, error);
+            out += "\"}";
+            return;
+        }
+        appendAll(out, "{\"success\":true,\"id\":", id, ",\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void handleLoudnessStop(std::string_view request, std::pmr::string& out) {
+        double id = 0;
+        if (!extractJsonNumber(requestBody(request), "id", id)) {
+            out += "{\"success\":false,\"error\":\"Missing meter id\"}";
+            return;
+        }
+        if (!loudness->stop(static_cast<int>(id))) {
+            out += "{\"success\":false,\"error\":\"No such meter\"}";
+            return;
+        }
+        out += "{\"success\":true,\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // {"id":1}, or no id to reset every meter
+    void handleLoudnessReset(std::string_view request, std::pmr::string& out) {
+        double id = 0;
+        extractJsonNumber(requestBody(request), "id", id);
+        if (!loudness->reset(static_cast<int>(id))) {
+            out += "{\"success\":false,\"error\":\"No such meter\"}";
+            return;
+        }
+        out += "{\"success\":true,\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getLoudness(std::pmr::string& out) {
+        out += "{\"success\":true,\"meters\":[";
+        bool first = true;
+        loudness->forEach([&](const LoudnessManager::Meter& meter, const LoudnessReading& r) {
+            if (!first) out += ",";
+            first = false;
+            appendAll(out, "{\"id\":", meter.id, ",\"name\":\"");
+            appendJsonEscaped(out, meter.name);
+            out += "\",\"ports\":[";
+            for (size_t i = 0; i < meter.session.sources.size(); i++) {
+                out += i ? ",\"" : "\"";
+                appendJsonEscaped(out, meter.session.sources[i].view());
+                out += "\"";
+            }
+            out += "]";
+            appendLevel(out, "momentary_lufs", r.momentary);
+            appendLevel(out, "short_term_lufs", r.shortTerm);
+            appendLevel(out, "integrated_lufs", r.integrated);
+            appendLevel(out, "momentary_max_lufs", r.momentaryMax);
+            appendLevel(out, "short_term_max_lufs", r.shortTermMax);
+            appendLevel(out, "true_peak_dbtp", r.truePeak);
+            appendLevel(out, "sample_peak_dbfs", r.samplePeak);
+            char seconds[32];
+            snprintf(seconds, sizeof(seconds), "%.1f", r.seconds);
+            appendAll(out, ",\"oversampling\":", meter.meter->oversampling(),
+                      ",\"seconds\":", seconds,
+                      ",\"dropped_frames\":", meter.session.droppedFrames.load(), "}");
+        });
+        out += "],\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // ,"key":-23.0 or ,"key":null when nothing has been measured
+    static void appendLevel(std::pmr::string& out, const char* key, double value) {
+        char number[32];
+        if (value <= LoudnessReading::kSilence) {
+            std::strcpy(number, "null");
+        } else {
+            snprintf(number, sizeof(number), "%.1f", value);
+        }
+        appendAll(out, ",\"", key, "\":", number);
+    }
+    
+    // {"source":"system:capture_3","destinations":["system:playback_1"],"on_db":-50,"off_db":-60,"hold_ms":5000}
+    void handleAutoRouteAdd(std::string_view request, std::pmr::string& out) {
+        std::string_view body = requestBody(request);
+        AutoRouter::Rule rule;
+        rule.onDb = g_config.autoRouteOnDb;
+        rule.offDb = g_config.autoRouteOffDb;
+        rule.holdSeconds = g_config.autoRouteHoldSeconds;
+        if (!rule.source.assign(extractJsonValue(body, "source")) ||
+            !extractJsonPortArray(body, "destinations", rule.destinations)) {
+            out += "{\"success\":false,\"error\":\"Missing or invalid source or destinations\"}";
+            return;
+        }
+        double value = 0;
+        extractJsonNumber(body, "on_db", rule.onDb);
+        extractJsonNumber(body, "off_db", rule.offDb);
+        if (extractJsonNumber(body, "hold_ms", value)) {
+            rule.holdSeconds = value / 1000.0;
+        }
+        
+        std::string error;
+        if (!autoRouter->add(rule, error)) {
+            out += "{\"success\":false,\"error\":\"";
+            appendJsonEscaped(out, error);
+            out += "\"}";
+            return;
+        }
+        out += "{\"success\":true,\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void handleAutoRouteRemove(std::string_view request, std::pmr::string& out) {
+        PortName source;
+        if (!source.assign(extractJsonValue(requestBody(request), "source")) || source.empty()) {
+            out += "{\"success\":false,\"error\":\"Missing source\"}";
+            return;
+        }
+        if (!autoRouter->remove(source)) {
+            out += "{\"success\":false,\"error\":\"No rule for that source\"}";
+            return;
+        }
+        out += "{\"success\":true,\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getAutoRoutes(std::pmr::string& out) {
+        out += "{\"success\":true,\"rules\":[";
+        bool first = true;
+        autoRouter->forEach([&](const AutoRouter::Rule& rule, const AutoRouter::Status& status) {
+            if (!first) out += ",";
+            first = false;
+            out += "{\"source\":\"";
+            appendJsonEscaped(out, rule.source.view());
+            out += "\",\"destinations\":[";
+            for (size_t i = 0; i < rule.destinations.size(); i++) {
+                out += i ? ",\"" : "\"";
+                appendJsonEscaped(out, rule.destinations[i].view());
+                out += "\"";
+            }
+            char numbers[160];
+            snprintf(numbers, sizeof(numbers),
+                     "\"on_db\":%.1f,\"off_db\":%.1f,\"hold_ms\":%.0f,\"peak_db\":%.1f,\"silent_seconds\":%.2f",
+                     rule.onDb, rule.offDb, rule.holdSeconds * 1000, status.peakDb, status.silentSeconds);
+            appendAll(out, "],", numbers,
+                      ",\"watching\":", status.watching,
+                      ",\"active\":", status.active,
+                      ",\"routed\":", status.routed,
+                      ",\"onsets\":", status.onsets, "}");
+        });
+        out += "],\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // {"playback":"system:playback_8","capture":"system:capture_8","level_db":-12,"max_ms":500}
+    void handleLatencyMeasure(std::string_view request, std::pmr::string& out) {
+        std::string_view body = requestBody(request);
+        LatencyMeter::Request measurement;
+        if (!measurement.playback.assign(extractJsonValue(body, "playback")) || measurement.playback.empty() ||
+            !measurement.capture.assign(extractJsonValue(body, "capture")) || measurement.capture.empty()) {
+            out += "{\"success\":false,\"error\":\"Missing playback or capture port\"}";
+            return;
+        }
+        extractJsonNumber(body, "level_db", measurement.levelDb);
+        extractJsonNumber(body, "max_ms", measurement.maxMs);
+        
+        LatencyMeter::Result result;
+        std::string error;
+        if (!latency->measure(measurement, result, error)) {
+            out += "{\"success\":false,\"error\":\"";
+            appendJsonEscaped(out, error);
+            out += "\"}";
+            return;
+        }
+        out += "{\"success\":true,";
+        appendLatencyResult(out, result);
+        out += ",\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getLatency(std::pmr::string& out) {
+        out += "{\"success\":true,\"measurements\":[";
+        bool first = true;
+        latency->forEach([&](const LatencyMeter::Result& result) {
+            out += first ? "{" : ",{";
+            first = false;
+            appendLatencyResult(out, result);
+            out += "}";
+        });
+        out += "],\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    static void appendLatencyResult(std::pmr::string& out, const LatencyMeter::Result& r) {
+        char numbers[160];
+        snprintf(numbers, sizeof(numbers),
+                 "\"precise_frames\":%.2f,\"milliseconds\":%.3f,\"peak_to_noise_db\":%.1f",
+                 r.delay.preciseFrames, 1000.0 * r.delay.preciseFrames / r.sampleRate, r.delay.peakToNoiseDb);
+        appendAll(out,
+            "\"playback\":\"", r.playback.view(), "\","
+            "\"capture\":\"", r.capture.view(), "\","
+            "\"frames\":", r.delay.frames, ",",
+            numbers, ","
+            "\"sample_rate\":", r.sampleRate, ","
+            "\"reported_frames\":", r.reportedFrames, ","
+            "\"extra_frames\":", static_cast<int64_t>(r.delay.frames) - static_cast<int64_t>(r.reportedFrames), ","
+            "\"inverted\":", r.delay.inverted, ","
+            "\"measured_at\":\"");
+        appendTimestamp(out, r.measuredAt);
+        out += "\"";
+    }
+    
+    // {"name":"clean"}
+    void handlePresetApply(std::string_view request, std::pmr::string& out) {
+        std::string name(extractJsonValue(requestBody(request), "name"));
+        PresetManager::Outcome outcome;
+        std::string error;
+        if (!presets->apply(name, outcome, error)) {
+            out += "{\"success\":false,\"error\":\"";
+            appendJsonEscaped(out, error);
+            out += "\"}";
+            return;
+        }
+        appendAll(out, "{\"success\":true,\"preset\":\"", name, "\","
+            "\"connected\":", outcome.connected, ","
+            "\"disconnected\":", outcome.disconnected, ","
+            "\"failed\":", outcome.failed, ",\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getPresets(std::pmr::string& out) {
+        out += "{\"success\":true,\"presets\":[";
+        bool first = true;
+        presets->forEach([&](const std::string& name, const std::vector<PresetManager::Edge>& edges, bool active) {
+            appendAll(out, first ? "" : ",", "{\"name\":\"", name, "\",\"active\":", active, ",\"connections\":[");
+            first = false;
+            for (size_t i = 0; i < edges.size(); i++) {
+                appendAll(out, i ? "," : "", "{\"from\":\"");
+                appendJsonEscaped(out, edges[i].from.view());
+                out += "\",\"to\":\"";
+                appendJsonEscaped(out, edges[i].to.view());
+                out += "\"}";
+            }
+            out += "]}";
+        });
+        out += "],\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // {"type":"pc"|"cc","number":3} (+ "preset":"clean" to map)
+    static bool extractMidiTarget(std::string_view body, bool& program, int& number) {
+        std::string_view type = extractJsonValue(body, "type");
+        double value = -1;
+        if ((type != "pc" && type != "cc") || !extractJsonNumber(body, "number", value)) return false;
+        program = type == "pc";
+        number = static_cast<int>(value);
+        return true;
+    }
+    
+    void handleMidiMap(std::string_view request, std::pmr::string& out) {
+        std::string_view body = requestBody(request);
+        MidiControl::Mapping mapping;
+        mapping.preset = std::string(extractJsonValue(body, "preset"));
+        if (!extractMidiTarget(body, mapping.program, mapping.number)) {
+            out += "{\"success\":false,\"error\":\"Need type pc or cc and a number\"}";
+            return;
+        }
+        std::string error;
+        if (!midi->map(mapping, error)) {
+            out += "{\"success\":false,\"error\":\"";
+            appendJsonEscaped(out, error);
+            out += "\"}";
+            return;
+        }
+        midi->start();
+        out += "{\"success\":true,\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void handleMidiUnmap(std::string_view request, std::pmr::string& out) {
+        bool program = true;
+        int number = 0;
+        if (!extractMidiTarget(requestBody(request), program, number) || !midi->unmap(program, number)) {
+            out += "{\"success\":false,\"error\":\"No such mapping\"}";
+            return;
+        }
+        out += "{\"success\":true,\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getMidiStatus(std::pmr::string& out) {
+        midi->inspect([&](const PortName& source, int channel, const char* port,
+                          const std::vector<MidiControl::Mapping>& mappings, const MidiControl::Stats& stats) {
+            appendAll(out, "{\"success\":true,\"port\":\"", port, "\",\"source\":\"");
+            appendJsonEscaped(out, source.view());
+            appendAll(out, "\",\"channel\":", channel, ",\"mappings\":[");
+            for (size_t i = 0; i < mappings.size(); i++) {
+                appendAll(out, i ? "," : "", "{\"type\":\"", mappings[i].program ? "pc" : "cc",
+                          "\",\"number\":", mappings[i].number, ",\"preset\":\"");
+                appendJsonEscaped(out, mappings[i].preset);
+                out += "\"}";
+            }
+            appendAll(out, "],"
+                "\"matched\":", stats.matched, ","
+                "\"dropped\":", stats.dropped, ","
+                "\"applied\":", stats.applied, ","
+                "\"superseded\":", stats.superseded, ","
+                "\"failed\":", stats.failed, ","
+                "\"latency_us\":{\"last\":", stats.lastUsecs, ","
+                "\"max\":", stats.maxUsecs, ","
+                "\"mean\":", stats.applied ? stats.totalUsecs / stats.applied : 0, "}");
+        });
+        out += ",\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // "output":1,"input":2 (1-based) into a command; false if missing
+    static bool extractCrosspoint(std::string_view body, uint8_t& output, uint8_t& input) {
+        double o = 0, i = 0;
+        if (!extractJsonNumber(body, "output", o) || !extractJsonNumber(body, "input", i) ||
+            o < 1 || i < 1 || o > CrosspointMixer::kMaxOutputs || i > CrosspointMixer::kMaxInputs) {
+            return false;
+        }
+        output = static_cast<uint8_t>(o - 1);
+        input = static_cast<uint8_t>(i - 1);
+        return true;
+    }
+    
+    void postMixerCommand(const MixerCommand& command, std::pmr::string& out) {
+        std::string error;
+        if (!mixer->post(command, error)) {
+            out += "{\"success\":false,\"error\":\"";
+            appendJsonEscaped(out, error);
+            out += "\"}";
+            return;
+        }
+        out += "{\"success\":true,\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // {"output":1,"input":2,"db":-6} (db null or below -120 is off)
+    void handleMixerGain(std::string_view request, std::pmr::string& out) {
+        std::string_view body = requestBody(request);
+        MixerCommand command;
+        command.type = MixerCommand::SetGain;
+        double db = 0;
+        if (!extractCrosspoint(body, command.output, command.input)) {
+            out += "{\"success\":false,\"error\":\"Missing output or input\"}";
+            return;
+        }
+        bool hasDb = extractJsonNumber(body, "db", db);
+        if (hasDb && db > 12) {
+            out += "{\"success\":false,\"error\":\"Gain above +12 dB\"}";
+            return;
+        }
+        command.value = hasDb && db >= -120 ? dbToLinear(db) : 0.0f;
+        postMixerCommand(command, out);
+    }
+    
+    // {"output":1,"input":2,"mute":true}
+    void handleMixerMute(std::string_view request, std::pmr::string& out) {
+        std::string_view body = requestBody(request);
+        MixerCommand command;
+        command.type = MixerCommand::SetMute;
+        bool mute = true;
+        if (!extractCrosspoint(body, command.output, command.input)) {
+            out += "{\"success\":false,\"error\":\"Missing output or input\"}";
+            return;
+        }
+        extractJsonBool(body, "mute", mute);
+        command.value = mute ? 1.0f : 0.0f;
+        postMixerCommand(command, out);
+    }
+    
+    // {"target":"gain"|"mute","output":1,"input":2,"timeout_ms":10000}:
+    // binds the next CC that arrives
+    void handleMixerLearn(std::string_view request, std::pmr::string& out) {
+        std::string_view body = requestBody(request);
+        MixerBinding binding;
+        std::string_view target = extractJsonValue(body, "target");
+        binding.target = target == "mute" ? MixerBinding::Mute : MixerBinding::Gain;
+        if ((target != "gain" && target != "mute") || !extractCrosspoint(body, binding.output, binding.input)) {
+            out += "{\"success\":false,\"error\":\"Need target gain or mute, output and input\"}";
+            return;
+        }
+        double timeoutMs = 10000;
+        extractJsonNumber(body, "timeout_ms", timeoutMs);
+        timeoutMs = std::clamp(timeoutMs, 100.0, 60000.0);
+        
+        int cc = 0;
+        std::string error;
+        if (!mixer->learn(binding, std::chrono::milliseconds(static_cast<int>(timeoutMs)), cc, error)) {
+            out += "{\"success\":false,\"error\":\"";
+            appendJsonEscaped(out, error);
+            out += "\"}";
+            return;
+        }
+        appendAll(out, "{\"success\":true,\"cc\":", cc, ",\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void handleMixerUnbind(std::string_view request, std::pmr::string& out) {
+        double cc = -1;
+        if (!extractJsonNumber(requestBody(request), "cc", cc) || !mixer->unbind(static_cast<int>(cc))) {
+            out += "{\"success\":false,\"error\":\"No binding for that CC\"}";
+            return;
+        }
+        out += "{\"success\":true,\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getMixer(std::pmr::string& out) {
+        mixer->inspect([&](size_t inputs, size_t outputs, const CrosspointMixer* running, const MixerBindings& bindings) {
+            appendAll(out, "{\"success\":true,\"running\":", running != nullptr,
+                      ",\"inputs\":", inputs, ",\"outputs\":", outputs, ",\"crosspoints\":[");
+            bool first = true;
+            for (size_t o = 0; running && o < outputs; o++) {
+                for (size_t i = 0; i < inputs; i++) {
+                    float level = running->level(o, i);
+                    char db[32];
+                    if (level > 0) {
+                        snprintf(db, sizeof(db), "%.2f", 20.0 * std::log10(level));
+                    } else {
+                        std::strcpy(db, "null");
+                    }
+                    appendAll(out, first ? "" : ",", "{\"output\":", o + 1, ",\"input\":", i + 1,
+                              ",\"db\":", db, ",\"muted\":", running->muted(o, i), "}");
+                    first = false;
+                }
+            }
+            out += "],\"bindings\":[";
+            first = true;
+            for (int cc = 0; cc < 128; cc++) {
+                const MixerBinding& b = bindings[cc];
+                if (b.target == MixerBinding::None) continue;
+                appendAll(out, first ? "" : ",", "{\"cc\":", cc, ",\"channel\":", static_cast<int>(b.channel),
+                          ",\"target\":\"", b.target == MixerBinding::Gain ? "gain" : "mute",
+                          "\",\"output\":", b.output + 1, ",\"input\":", b.input + 1, "}");
+                first = false;
+            }
+            out += "]";
+        });
+        out += ",\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // {"connections":[{"source":"a","destination":"b"},...],"exclusive":false}
+    void handleRoutingPut(std::string_view request, std::pmr::string& out) {
+        std::string_view body = requestBody(request);
+        size_t i = findJsonValue(body, "connections");
+        if (i >= body.length() || body[i] != '[') {
+            out += "{\"success\":false,\"error\":\"Missing connections array\"}";
+            return;
+        }
+        
+        std::vector<RoutingReconciler::Edge> edges;
+        for (size_t pos = i + 1;;) {
+            size_t open = body.find_first_of("{]", pos);
+            size_t close = open == std::string_view::npos ? open : body.find('}', open);
+            if (open != std::string_view::npos && body[open] == ']') break;
+            if (close == std::string_view::npos) {
+                out += "{\"success\":false,\"error\":\"Malformed connections array\"}";
+                return;
+            }
+            std::string_view object = body.substr(open, close - open + 1);
+            RoutingReconciler::Edge edge;
+            if (!edge.from.assign(extractJsonValue(object, "source")) ||
+                !edge.to.assign(extractJsonValue(object, "destination")) || edge.from.empty() || edge.to.empty()) {
+                out += "{\"success\":false,\"error\":\"Each connection needs a source and destination\"}";
+                return;
+            }
+            edges.push_back(edge);
+            pos = close + 1;
+        }
+        bool exclusive = false;
+        extractJsonBool(body, "exclusive", exclusive);
+        
+        size_t count = edges.size();
+        routing->set(std::move(edges), exclusive);
+        appendAll(out, "{\"success\":true,\"desired\":", count, ",\"exclusive\":", exclusive, ",\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void handleRoutingDelete(std::pmr::string& out) {
+        routing->clear();
+        out += "{\"success\":true,\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getRouting(std::pmr::string& out) {
+        routing->inspect([&](const std::vector<RoutingReconciler::Edge>* edges, bool exclusive,
+                             const RoutingReconciler::Stats& stats) {
+            appendAll(out, "{\"success\":true,\"managed\":", edges != nullptr, ",\"exclusive\":", exclusive,
+                      ",\"connections\":[");
+            if (edges) {
+                for (size_t i = 0; i < edges->size(); i++) {
+                    appendAll(out, i ? "," : "", "{\"source\":\"");
+                    appendJsonEscaped(out, (*edges)[i].from.view());
+                    out += "\",\"destination\":\"";
+                    appendJsonEscaped(out, (*edges)[i].to.view());
+                    out += "\"}";
+                }
+            }
+            appendAll(out, "],"
+                "\"converged\":", stats.converged, ","
+                "\"missing\":", stats.missing, ","
+                "\"extra\":", stats.extra, ","
+                "\"waiting\":", stats.waiting, ","
+                "\"passes\":", stats.passes, ","
+                "\"connected\":", stats.connected, ","
+                "\"disconnected\":", stats.disconnected, ","
+                "\"failed\":", stats.failed, ","
+                "\"drift\":{\"passes\":", stats.driftPasses, ",\"edges\":", stats.driftEdges, ",\"last\":");
+            if (stats.driftPasses) {
+                out += "\"";
+                appendTimestamp(out, stats.lastDrift);
+                out += "\"";
+            } else {
+                out += "null";
+            }
+            appendAll(out, "},"
+                "\"reconcile_us\":{\"last\":", stats.lastUsecs, ","
+                "\"max\":", stats.maxUsecs, ","
+                "\"mean\":", stats.passes ? stats.totalUsecs / stats.passes : 0, "},"
+                "\"deferred\":{\"queued\":", stats.deferred, ","
+                "\"applied\":", stats.deferredApplied, ","
+                "\"failed\":", stats.deferredFailed, ",");
+        });
+        routing->inspectDeferred([&](const std::vector<RoutingReconciler::Intent>& pending, bool clearFirst) {
+            appendAll(out, "\"clear_first\":", clearFirst, ",\"pending\":[");
+            for (size_t i = 0; i < pending.size(); i++) {
+                appendAll(out, i ? "," : "", "{\"source\":\"");
+                appendJsonEscaped(out, pending[i].edge.from.view());
+                out += "\",\"destination\":\"";
+                appendJsonEscaped(out, pending[i].edge.to.view());
+                appendAll(out, "\",\"connect\":", pending[i].connect, "}");
+            }
+            out += "]}";
+        });
+        out += ",\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getMqtt(std::pmr::string& out) {
+        mqtt->inspect([&](const MqttBridge::Settings& settings, const MqttBridge::Stats& stats) {
+            appendAll(out, "{\"success\":true,\"enabled\":", !settings.host.empty(), ",\"broker\":\"");
+            appendJsonEscaped(out, settings.host);
+            appendAll(out, "\",\"port\":", settings.port, ",\"base\":\"");
+            appendJsonEscaped(out, settings.base);
+            appendAll(out, "\",\"connected\":", stats.connected,
+                      ",\"switches\":", settings.inputs.size() * settings.outputs.size(),
+                      ",\"sessions\":", stats.sessions,
+                      ",\"commands\":", stats.commands,
+                      ",\"failed\":", stats.failed,
+                      ",\"ignored\":", stats.ignored,
+                      ",\"published\":", stats.published, ",\"last_error\":");
+            if (stats.lastError.empty()) {
+                out += "null";
+            } else {
+                out += "\"";
+                appendJsonEscaped(out, stats.lastError);
+                out += "\"";
+            }
+        });
+        out += ",\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    void getMonitorStreams(std::pmr::string& out) {
+        out += "{\"success\":true,\"streams\":[";
+        bool first = true;
+        monitors->forEach([&](const MonitorManager::Session& session) {
+            if (!first) out += ",";
+            first = false;
+            appendAll(out, "{\"id\":", session.id, ",\"format\":\"", session.format, "\",\"ports\":[");
+            for (size_t i = 0; i < session.sources.size(); i++) {
+                out += i ? ",\"" : "\"";
+                appendJsonEscaped(out, session.sources[i].view());
+                out += "\"";
+            }
+            appendAll(out, "],"
+                "\"sent_bytes\":", session.sentBytes.load(), ","
+                "\"dropped_frames\":", session.droppedFrames.load(), "}");
+        });
+        out += "],\"timestamp\":\"";
+        appendCurrentTimestamp(out);
+        out += "\"}";
+    }
+    
+    // For anything the bridge did not write itself: file paths (backslashes
+    // on Windows), and port, preset or file names the client sent, which
+    // error messages quote
+    template <typename String>
+    static void appendJsonEscaped(String& out, std::string_view text) {
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out += escaped;
+            } else {
+                out += c;
+            }
         }
     }
     
-    bool isRunning() {
-        std::lock_guard<std::mutex> lock(g_jackMutex);
-        
-        if (!g_jackClient) {
-            return false;
-        }
-        
-        // Test JACK responsiveness
-        try {
-            jack_nframes_t sr = jack_get_sample_rate(g_jackClient);
-            g_jackRunning = (sr > 0);
-            return g_jackRunning;
-        } catch (...) {
-            g_jackRunning = false;
-            return false;
+    // JACK could not take the change, so the reconciler holds it until it
+    // can; that is an answer, not a failed request
+    void answerDeferred(std::pmr::string& out, size_t queued) {
+        t_jackTimedOut = false;
+        t_jackRejected = false;
+        if (!queued) {
+            appendAll(out, "{\"success\":false,\"error\":\"JACK not running and ", RoutingReconciler::kMaxDeferred,
+                      " changes already queued\"}");
+            return;
         }
+        appendAll(out,
+            "{\"success\":true,"
+            "\"queued\":true,"
+            "\"message\":\"JACK unavailable; queued until it is back\","
+            "\"pending\":", queued, ","
+            "\"method\":\"native_api\","
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
     }
     
-    std::vector<std::string> getPorts() {
-        std::lock_guard<std::mutex> lock(g_jackMutex);
-        std::vector<std::string> ports;
-        
-        if (!g_jackClient) return ports;
-        
-        const char** jackPorts = jack_get_ports(g_jackClient, nullptr, nullptr, 0);
-        if (jackPorts) {
-            for (int i = 0; jackPorts[i]; i++) {
-                ports.push_back(std::string(jackPorts[i]));
-            }
-            jack_free(jackPorts);
+    coro::Task<> handleConnect(std::string_view request, std::pmr::string& out) {
+        auto bodyStart = request.find("\r\n\r\n");
+        if (bodyStart == std::string_view::npos) {
+            out += "{\"success\":false,\"error\":\"No request body\"}";
+            co_return;
         }
         
-        return ports;
-    }
-    
-    std::vector<std::pair<std::string, std::string>> getConnections() {
-        std::lock_guard<std::mutex> lock(g_jackMutex);
-        std::vector<std::pair<std::string, std::string>> connections;
+        std::string_view body = request.substr(bodyStart + 4);
+        PortName source, destination;
+        TraceSpan parseSpan("parse");
+        bool namesFit = source.assign(extractJsonValue(body, "source")) &&
+                        destination.assign(extractJsonValue(body, "destination"));
+        parseSpan.end();
         
-        if (!g_jackClient) return connections;
+        if (!namesFit) {
+            out += "{\"success\":false,\"error\":\"Port name too long\"}";
+            co_return;
+        }
         
-        const char** outputPorts = jack_get_ports(g_jackClient, nullptr, nullptr, JackPortIsOutput);
-        if (!outputPorts) return connections;
+        if (source.empty() || destination.empty()) {
+            out += "{\"success\":false,\"error\":\"Missing source or destination\"}";
+            co_return;
+        }
         
-        for (int i = 0; outputPorts[i]; i++) {
-            jack_port_t* port = jack_port_by_name(g_jackClient, outputPorts[i]);
-            if (!port) continue;
-            
-            const char** connectedPorts = jack_port_get_all_connections(g_jackClient, port);
-            if (!connectedPorts) continue;
-            
-            for (int j = 0; connectedPorts[j]; j++) {
-                connections.emplace_back(outputPorts[i], connectedPorts[j]);
-            }
-            jack_free(connectedPorts);
+        std::optional<bool> done = co_await jack<std::optional<bool>>(std::nullopt,
+            [jm = jackManager, source, destination] {
+                return jm->isRunning() ? std::optional<bool>(jm->connectPorts(source.c_str(), destination.c_str()))
+                                       : std::nullopt;
+            });
+        if (!done) {
+            answerDeferred(out, routing->defer({source, destination}, true));
+            co_return;
         }
-        jack_free(outputPorts);
+        bool success = *done;
+        if (success) routing->supersede({source, destination}, true);
         
-        return connections;
+        TraceSpan span("serialize");
+        appendAll(out,
+            "{\"success\":", success, ","
+            "\"message\":\"", success ? "Connected" : "Failed", "\","
+            "\"method\":\"native_api\","
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
     }
     
-    bool connectPorts(const std::string& from, const std::string& to) {
-        std::lock_guard<std::mutex> lock(g_jackMutex);
-        
-        if (!g_jackClient) {
-            LOG_ERROR("JACK client not available for connection");
-            return false;
+    coro::Task<> handleDisconnect(std::string_view request, std::pmr::string& out) {
+        auto bodyStart = request.find("\r\n\r\n");
+        if (bodyStart == std::string_view::npos) {
+            out += "{\"success\":false,\"error\":\"No request body\"}";
+            co_return;
         }
         
-        int result = jack_connect(g_jackClient, from.c_str(), to.c_str());
+        std::string_view body = request.substr(bodyStart + 4);
+        PortName source, destination;
+        TraceSpan parseSpan("parse");
+        bool namesFit = source.assign(extractJsonValue(body, "source")) &&
+                        destination.assign(extractJsonValue(body, "destination"));
+        parseSpan.end();
         
-        if (result == 0) {
-            LOG_INFO("Connected: " + from + " -> " + to);
-            return true;
-        } else if (result == EEXIST) {
-            LOG_DEBUG("Connection already exists: " + from + " -> " + to);
-            return true; // Consider already connected as success
-        } else {
-            LOG_ERROR("Failed to connect: " + from + " -> " + to);
-            return false;
+        if (!namesFit) {
+            out += "{\"success\":false,\"error\":\"Port name too long\"}";
+            co_return;
         }
-    }
-    
-    bool disconnectPorts(const std::string& from, const std::string& to) {
-        std::lock_guard<std::mutex> lock(g_jackMutex);
         
-        if (!g_jackClient) {
-            LOG_ERROR("JACK client not available for disconnection");
-            return false;
+        if (source.empty() || destination.empty()) {
+            out += "{\"success\":false,\"error\":\"Missing source or destination\"}";
+            co_return;
         }
         
-        int result = jack_disconnect(g_jackClient, from.c_str(), to.c_str());
-        
-        if (result == 0) {
-            LOG_INFO("Disconnected: " + from + " -> " + to);
-            return true;
-        } else {
-            LOG_ERROR("Failed to disconnect: " + from + " -> " + to);
-            return false;
+        std::optional<bool> done = co_await jack<std::optional<bool>>(std::nullopt,
+            [jm = jackManager, source, destination] {
+                return jm->isRunning() ? std::optional<bool>(jm->disconnectPorts(source.c_str(), destination.c_str()))
+                                       : std::nullopt;
+            });
+        if (!done) {
+            answerDeferred(out, routing->defer({source, destination}, false));
+            co_return;
         }
+        bool success = *done;
+        if (success) routing->supersede({source, destination}, false);
+        
+        TraceSpan span("serialize");
+        appendAll(out,
+            "{\"success\":", success, ","
+            "\"message\":\"", success ? "Disconnected" : "Failed", "\","
+            "\"method\":\"native_api\","
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
     }
     
-    int clearAllConnections() {
-        std::lock_guard<std::mutex> lock(g_jackMutex);
-        
-        if (!g_jackClient) return 0;
+    // POST /disconnect_port {"port":"system:capture_1"}: every connection of
+    // the port, both directions, in one executor task
+    coro::Task<> handleDisconnectPort(std::string_view request, std::pmr::string& out) {
+        auto bodyStart = request.find("\r\n\r\n");
+        if (bodyStart == std::string_view::npos) {
+            out += "{\"success\":false,\"error\":\"No request body\"}";
+            co_return;
+        }
         
-        auto connections = getConnections();
-        int cleared = 0;
+        PortName port;
+        TraceSpan parseSpan("parse");
+        bool nameFits = port.assign(extractJsonValue(request.substr(bodyStart + 4), "port"));
+        parseSpan.end();
+        if (!nameFits || port.empty()) {
+            out += "{\"success\":false,\"error\":\"Missing or invalid port\"}";
+            co_return;
+        }
         
-        for (const auto& conn : connections) {
-            if (jack_disconnect(g_jackClient, conn.first.c_str(), conn.second.c_str()) == 0) {
-                cleared++;
+        std::optional<int> done = co_await jack<std::optional<int>>(std::nullopt, [jm = jackManager, port] {
+            return jm->isRunning() ? std::optional<int>(jm->disconnectPort(port.c_str())) : std::nullopt;
+        });
+        bool live = done.has_value();
+        if (!done) {
+            // Queue the port's edges as the last known graph has them
+            JackManager::KnownGraph known = jackManager->lastKnownGraph();
+            uint32_t index = known.graph ? known.graph->findPort(port.view()) : GraphSnapshot::kNoPort;
+            if (index == GraphSnapshot::kNoPort) {
+                out += "{\"success\":false,\"error\":\"JACK not running\"}";
+                co_return;
             }
+            const GraphSnapshot& graph = *known.graph;
+            std::vector<PortEdge> edges(graph.outgoing(index).begin(), graph.outgoing(index).end());
+            for (uint32_t edge : graph.incoming(index)) edges.push_back(graph.edges[edge]);
+            if (edges.empty()) {
+                t_jackTimedOut = false;
+                t_jackRejected = false;
+                done = 0;           // nothing to queue
+            } else {
+                size_t queued = 0;
+                for (const PortEdge& edge : edges) {
+                    queued = routing->defer({graph.fromName(edge), graph.toName(edge)}, false);
+                    if (!queued) break;
+                }
+                answerDeferred(out, queued);
+                co_return;
+            }
+        }
+        if (*done < 0) {
+            out += "{\"success\":false,\"error\":\"Unknown port\",\"port\":\"";
+            appendJsonEscaped(out, port.view());
+            out += "\"}";
+            co_return;
         }
+        if (live) routing->supersedePort(port);
         
-        LOG_INFO("Cleared " + std::to_string(cleared) + " connections");
-        return cleared;
+        out += "{\"success\":true,\"port\":\"";
+        appendJsonEscaped(out, port.view());
+        appendAll(out,
+            "\","
+            "\"disconnected\":", *done, ","
+            "\"method\":\"native_api\","
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
     }
     
-    std::string getJackInfo() {
-        std::lock_guard<std::mutex> lock(g_jackMutex);
-        
-        if (!g_jackClient) return "{}";
-        
-        std::ostringstream info;
-        info << "{"
-             << "\"sample_rate\":" << jack_get_sample_rate(g_jackClient) << ","
-             << "\"buffer_size\":" << jack_get_buffer_size(g_jackClient) << ","
-             << "\"client_name\":\"" << jack_get_client_name(g_jackClient) << "\""
-             << "}";
+    coro::Task<> handleClearAll(std::pmr::string& out) {
+        std::optional<int> cleared = co_await jack<std::optional<int>>(std::nullopt, [jm = jackManager] {
+            return jm->isRunning() ? std::optional<int>(jm->clearAllConnections()) : std::nullopt;
+        });
+        if (!cleared) {
+            answerDeferred(out, routing->deferClear());
+            co_return;
+        }
+        routing->supersedeAll();
         
-        return info.str();
+        appendAll(out,
+            "{\"success\":true,"
+            "\"message\":\"Cleared all connections\","
+            "\"count\":", *cleared, ","
+            "\"method\":\"native_api\","
+            "\"timestamp\":\"");
+        appendCurrentTimestamp(out);
+        out += "\"}";
     }
 };
 
-// HTTP Server for API
-class HttpServer {
-private:
-    SOCKET serverSocket;
-    int port;
-    std::atomic<bool> running{false};
-    std::thread serverThread;
-    JackManager* jackManager;
-    
+// Binary control protocol (control_protocol.h) on its own port, for scripts
+// that make changes by the thousand. Connections stay open and requests are
+// pipelined; each op goes through the same JackManager and MixerManager
+// calls as the HTTP handlers, and a connect or disconnect that JACK took
+// supersedes queued intents for its edge the same way. Replies are gathered
+// while more requests are already buffered and sent with one write.
+class ControlServer {
 public:
-    HttpServer(int p, JackManager* jm) : port(p), jackManager(jm), serverSocket(INVALID_SOCKET) {}
+    ControlServer(int p, const BridgeServices& services)
+        : port(p), jackManager(services.jack), mixer(services.mixer), routing(services.routing) {}
     
-    ~HttpServer() {
+    ~ControlServer() {
         stop();
     }
     
     bool start() {
         WSADATA wsaData;
         if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-            LOG_ERROR("WSAStartup failed");
+            LOG_ERROR("Control: WSAStartup failed");
             return false;
         }
         
-        serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-        if (serverSocket == INVALID_SOCKET) {
-            LOG_ERROR("Socket creation failed");
+        listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (listenSocket == INVALID_SOCKET) {
+            LOG_ERROR("Control: socket creation failed");
             WSACleanup();
             return false;
         }
-        
-        // Allow socket reuse
         int opt = 1;
-        setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+        setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
         
         struct sockaddr_in address;
         address.sin_family = AF_INET;
         address.sin_addr.s_addr = INADDR_ANY;
         address.sin_port = htons(static_cast<u_short>(port));
-        
-        if (bind(serverSocket, (struct sockaddr*)&address, sizeof(address)) < 0) {
-            LOG_ERROR("Bind failed on port " + std::to_string(port));
-            closesocket(serverSocket);
-            WSACleanup();
-            return false;
-        }
-        
-        if (listen(serverSocket, 3) < 0) {
-            LOG_ERROR("Listen failed");
-            closesocket(serverSocket);
+        if (bind(listenSocket, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listenSocket, 16) < 0) {
+            LOG_ERROR("Control: cannot listen on port " + std::to_string(port));
+            closesocket(listenSocket);
+            listenSocket = INVALID_SOCKET;
             WSACleanup();
             return false;
         }
         
         running = true;
-        serverThread = std::thread(&HttpServer::serverLoop, this);
-        
-        LOG_INFO("HTTP Server listening on port " + std::to_string(port));
+        acceptThread = std::thread(&ControlServer::acceptLoop, this);
+        LOG_INFO("Control protocol listening on port " + std::to_string(port));
         return true;
     }
     
     void stop() {
-        running = false;
-        
-        if (serverSocket != INVALID_SOCKET) {
-            closesocket(serverSocket);
-            serverSocket = INVALID_SOCKET;
+        if (!running.exchange(false)) return;
+        closesocket(listenSocket);
+        listenSocket = INVALID_SOCKET;
+        if (acceptThread.joinable()) {
+            acceptThread.join();
         }
         
-        if (serverThread.joinable()) {
-            serverThread.join();
+        // Wake every client thread and join it; their JACK calls are bounded
+        // by jack_timeout_ms, so none outlives this object
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<InstrumentedMutex> lock(mutex);
+            for (auto& [s, thread] : clients) {
+                shutdown(s, SD_BOTH);
+                threads.push_back(std::move(thread));
+            }
+            clients.clear();
+            threads.insert(threads.end(), std::make_move_iterator(finished.begin()),
+                           std::make_move_iterator(finished.end()));
+            finished.clear();
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
         }
-        
         WSACleanup();
-        LOG_INFO("HTTP Server stopped");
+        LOG_INFO("Control protocol stopped");
     }
     
 private:
-    void serverLoop() {
+    void acceptLoop() {
         while (running) {
             struct sockaddr_in clientAddr;
             int clientLen = sizeof(clientAddr);
-            
-            SOCKET clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientLen);
+            SOCKET clientSocket = accept(listenSocket, (struct sockaddr*)&clientAddr, &clientLen);
             if (clientSocket == INVALID_SOCKET) {
                 if (running) {
-                    LOG_ERROR("Accept failed");
+                    LOG_ERROR("Control: accept failed");
                 }
                 continue;
             }
+            BOOL noDelay = TRUE;
+            setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
             
-            std::thread(&HttpServer::handleClient, this, clientSocket).detach();
-        }
-    }
-    
-    void handleClient(SOCKET clientSocket) {
-        char buffer[4096] = {0};
-        int bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
-        
-        if (bytesRead <= 0) {
-            closesocket(clientSocket);
-            return;
-        }
-        
-        std::string request(buffer, bytesRead);
-        std::string response = processRequest(request);
-        
-        send(clientSocket, response.c_str(), static_cast<int>(response.length()), 0);
-        closesocket(clientSocket);
-    }
-    
-    std::string processRequest(const std::string& request) {
-        std::istringstream iss(request);
-        std::string method, path, version;
-        iss >> method >> path >> version;
-        
-        LOG_DEBUG("Request: " + method + " " + path);
-        
-        std::string responseBody;
-        std::string contentType = "application/json";
-        
-        // CORS headers
-        std::string corsHeaders = 
-            "Access-Control-Allow-Origin: *\r\n"
-            "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
-            "Access-Control-Allow-Headers: Content-Type\r\n";
-        
-        try {
-            if (method == "OPTIONS") {
-                responseBody = "";
-            } else if (path == "/health") {
-                responseBody = getHealthStatus();
-            } else if (path == "/status") {
-                responseBody = getJackStatus();
-            } else if (path == "/ports") {
-                responseBody = getJackPorts();
-            } else if (path == "/connections") {
-                responseBody = getJackConnections();
-            } else if (path == "/connect" && method == "POST") {
-                responseBody = handleConnect(request);
-            } else if (path == "/disconnect" && method == "POST") {
-                responseBody = handleDisconnect(request);
-            } else if (path == "/clear" && method == "POST") {
-                responseBody = handleClearAll();
-            } else {
-                responseBody = "{\"error\":\"Not found\",\"path\":\"" + path + "\"}";
+            std::vector<std::thread> done;
+            {
+                std::lock_guard<InstrumentedMutex> lock(mutex);
+                done.swap(finished);
+                clients.emplace(clientSocket, std::thread(&ControlServer::serveClient, this, clientSocket));
+            }
+            for (std::thread& thread : done) {
+                thread.join();
             }
-        } catch (const std::exception& e) {
-            responseBody = "{\"error\":\"Internal server error\",\"message\":\"" + std::string(e.what()) + "\"}";
-        }
-        
-        std::string httpResponse = 
-            "HTTP/1.1 200 OK\r\n" +
-            corsHeaders +
-            "Content-Type: " + contentType + "\r\n"
-            "Content-Length: " + std::to_string(responseBody.length()) + "\r\n"
-            "\r\n" +
-            responseBody;
-        
-        return httpResponse;
-    }
-    
-    std::string getCurrentTimestamp() {
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now.time_since_epoch()) % 1000;
-        
-        char buffer[64];
-        struct tm tm_buf;
-        if (gmtime_s(&tm_buf, &time_t) == 0) {
-            strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm_buf);
-        } else {
-            strcpy_s(buffer, "1970-01-01T00:00:00");
-        }
-        
-        return std::string(buffer) + "." + std::to_string(ms.count()) + "Z";
-    }
-    
-    std::string getHealthStatus() {
-        bool jackOk = jackManager->isRunning();
-        
-        return "{\"status\":\"" + std::string(jackOk ? "healthy" : "unhealthy") + "\","
-               "\"service\":\"jack-bridge-local\","
-               "\"version\":\"1.0.0\","
-               "\"jack_running\":" + (jackOk ? "true" : "false") + ","
-               "\"platform\":\"windows\","
-               "\"api\":\"native\","
-               "\"timestamp\":\"" + getCurrentTimestamp() + "\"}";
-    }
-    
-    std::string getJackStatus() {
-        bool jackOk = jackManager->isRunning();
-        
-        std::string response = "{\"success\":" + std::string(jackOk ? "true" : "false") +
-                              ",\"jack_running\":" + std::string(jackOk ? "true" : "false") +
-                              ",\"method\":\"native_api\"";
-        
-        if (jackOk) {
-            response += "," + jackManager->getJackInfo().substr(1, jackManager->getJackInfo().length() - 2);
-        }
-        
-        response += ",\"timestamp\":\"" + getCurrentTimestamp() + "\"}";
-        return response;
-    }
-    
-    std::string getJackPorts() {
-        if (!jackManager->isRunning()) {
-            return "{\"success\":false,\"error\":\"JACK not running\"}";
-        }
-        
-        auto ports = jackManager->getPorts();
-        
-        std::string portsJson = "[";
-        for (size_t i = 0; i < ports.size(); i++) {
-            portsJson += "\"" + ports[i] + "\"";
-            if (i < ports.size() - 1) portsJson += ",";
         }
-        portsJson += "]";
-        
-        return "{\"success\":true,"
-               "\"ports\":" + portsJson + ","
-               "\"count\":" + std::to_string(ports.size()) + ","
-               "\"method\":\"native_api\","
-               "\"timestamp\":\"" + getCurrentTimestamp() + "\"}";
     }
     
-    std::string getJackConnections() {
-        if (!jackManager->isRunning()) {
-            return "{\"success\":false,\"error\":\"JACK not running\"}";
-        }
-        
-        auto connections = jackManager->getConnections();
+    void serveClient(SOCKET clientSocket) {
+        control::FrameBuffer in;
+        std::string out;
+        bool subscribed = false;
+        uint64_t seenGeneration = 0;
+        bool open = true;
         
-        std::string connectionsJson = "[";
-        for (size_t i = 0; i < connections.size(); i++) {
-            connectionsJson += "{\"from\":\"" + connections[i].first + "\","
-                              "\"to\":\"" + connections[i].second + "\"}";
-            if (i < connections.size() - 1) connectionsJson += ",";
+        while (open && running) {
+            WSAPOLLFD fd = {};
+            fd.fd = clientSocket;
+            fd.events = POLLIN;
+            int ready = WSAPoll(&fd, 1, subscribed ? 50 : 500);
+            if (ready < 0) break;
+            if (ready > 0) {
+                char buffer[16384];
+                int received = recv(clientSocket, buffer, sizeof(buffer), 0);
+                if (received <= 0) break;
+                in.feed(buffer, static_cast<size_t>(received));
+                
+                control::Frame frame;
+                while (in.peek(frame)) {
+                    if (frame.code == control::Subscribe) {
+                        control::Reader reader(frame.payload);
+                        subscribed = reader.u8() != 0;
+                        seenGeneration = g_graphGeneration.load();
+                    }
+                    handle(frame, out);
+                    in.consume();
+                }
+                if (in.malformed()) {
+                    LOG_WARN("Control: malformed frame, closing connection");
+                    open = false;
+                }
+            }
+            
+            if (subscribed && g_graphGeneration.load() != seenGeneration) {
+                seenGeneration = g_graphGeneration.load();
+                control::Writer writer(out);
+                size_t frame = writer.beginFrame(0, control::EventGraphChanged);
+                writer.u64(seenGeneration);
+                writer.endFrame(frame);
+            }
+            if (!out.empty()) {
+                open = open && sendAll(clientSocket, out.data(), out.length());
+                out.clear();
+            }
         }
-        connectionsJson += "]";
         
-        return "{\"success\":true,"
-               "\"connections\":" + connectionsJson + ","
-               "\"count\":" + std::to_string(connections.size()) + ","
-               "\"method\":\"native_api\","
-               "\"timestamp\":\"" + getCurrentTimestamp() + "\"}";
-    }
-    
-    std::string extractJsonValue(const std::string& json, const std::string& key) {
-        std::regex pattern("\"" + key + "\"\\s*:\\s*\"([^\"]+)\"");
-        std::smatch matches;
-        
-        if (std::regex_search(json, matches, pattern)) {
-            return matches[1].str();
+        // Hand our thread to the next accept (or stop()) to join; stop()
+        // may already have taken it
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        auto self = clients.find(clientSocket);
+        if (self != clients.end()) {
+            finished.push_back(std::move(self->second));
+            clients.erase(self);
         }
-        
-        return "";
+        closesocket(clientSocket);
     }
     
-    std::string handleConnect(const std::string& request) {
-        auto bodyStart = request.find("\r\n\r\n");
-        if (bodyStart == std::string::npos) {
-            return "{\"success\":false,\"error\":\"No request body\"}";
-        }
-        
-        std::string body = request.substr(bodyStart + 4);
-        std::string source = extractJsonValue(body, "source");
-        std::string destination = extractJsonValue(body, "destination");
+    void handle(const control::Frame& request, std::string& out) {
+        control::Reader reader(request.payload);
+        control::Writer writer(out);
+        size_t frame = writer.beginFrame(request.id, control::Ok);
+        size_t statusAt = frame + 8;
+        auto fail = [&](control::Status status) {
+            out.resize(statusAt + 1);
+            out[statusAt] = static_cast<char>(status);
+        };
         
-        if (source.empty() || destination.empty()) {
-            return "{\"success\":false,\"error\":\"Missing source or destination\"}";
-        }
-        
-        if (!jackManager->isRunning()) {
-            return "{\"success\":false,\"error\":\"JACK not running\"}";
+        switch (request.code) {
+        case control::Ping:
+            break;
+        case control::Connect:
+        case control::Disconnect: {
+            // The whole frame goes to the JACK executor as one task. The
+            // count is checked against the payload before anything is
+            // allocated: an edge is at least two empty strings (4 bytes).
+            uint16_t count = reader.u16();
+            if (!reader.ok() || count > reader.remaining() / 4) {
+                fail(control::BadRequest);
+                break;
+            }
+            std::vector<std::pair<PortName, PortName>> edges(count);
+            for (uint16_t i = 0; i < count && reader.ok(); i++) {
+                PortName& from = edges[i].first;
+                PortName& to = edges[i].second;
+                if (!from.assign(reader.str()) || !to.assign(reader.str()) || !reader.ok()) {
+                    from.clear();
+                    to.clear();
+                }
+            }
+            if (!reader.done()) {
+                fail(control::BadRequest);
+                break;
+            }
+            bool connect = request.code == control::Connect;
+            std::vector<uint8_t> done = jackManager->setConnections(edges, connect);
+            if (t_jackRejected) {
+                fail(control::Unavailable);
+                break;
+            }
+            writer.u16(count);
+            for (size_t i = 0; i < done.size(); i++) {
+                writer.u8(done[i]);
+                if (done[i]) routing->supersede({edges[i].first, edges[i].second}, connect);
+            }
+            break;
         }
-        
-        bool success = jackManager->connectPorts(source, destination);
-        
-        return "{\"success\":" + std::string(success ? "true" : "false") + ","
-               "\"message\":\"" + (success ? "Connected" : "Failed") + "\","
-               "\"method\":\"native_api\","
-               "\"timestamp\":\"" + getCurrentTimestamp() + "\"}";
-    }
-    
-    std::string handleDisconnect(const std::string& request) {
-        auto bodyStart = request.find("\r\n\r\n");
-        if (bodyStart == std::string::npos) {
-            return "{\"success\":false,\"error\":\"No request body\"}";
+        case control::SetGain: {
+            uint16_t count = reader.u16();
+            writer.u16(count);
+            for (uint16_t i = 0; i < count && reader.ok(); i++) {
+                MixerCommand command;
+                command.type = MixerCommand::SetGain;
+                command.output = reader.u8();
+                command.input = reader.u8();
+                float db = reader.f32();
+                // Same range as POST /mixer/gain: NaN or below -120 dB is off
+                bool valid = reader.ok() && !(db > 12);
+                command.value = db >= -120 ? dbToLinear(db) : 0.0f;
+                std::string error;
+                writer.u8(valid && mixer->post(command, error) ? 1 : 0);
+            }
+            if (!reader.done()) fail(control::BadRequest);
+            break;
         }
-        
-        std::string body = request.substr(bodyStart + 4);
-        std::string source = extractJsonValue(body, "source");
-        std::string destination = extractJsonValue(body, "destination");
-        
-        if (source.empty() || destination.empty()) {
-            return "{\"success\":false,\"error\":\"Missing source or destination\"}";
+        case control::Subscribe:
+            reader.u8();
+            writer.u64(g_graphGeneration.load());
+            if (!reader.done()) fail(control::BadRequest);
+            break;
+        case control::GetGraph: {
+            if (!jackManager->isRunning()) {
+                fail(control::Unavailable);
+                break;
+            }
+            GraphPtr graph = jackManager->getGraph();
+            writer.u64(graph->generation);
+            writer.u32(static_cast<uint32_t>(graph->edges.size()));
+            for (const PortEdge& edge : graph->edges) {
+                writer.str(graph->fromName(edge).view());
+                writer.str(graph->toName(edge).view());
+            }
+            break;
         }
-        
-        if (!jackManager->isRunning()) {
-            return "{\"success\":false,\"error\":\"JACK not running\"}";
+        default:
+            fail(control::UnknownOp);
+            break;
         }
-        
-        bool success = jackManager->disconnectPorts(source, destination);
-        
-        return "{\"success\":" + std::string(success ? "true" : "false") + ","
-               "\"message\":\"" + (success ? "Disconnected" : "Failed") + "\","
-               "\"method\":\"native_api\","
-               "\"timestamp\":\"" + getCurrentTimestamp() + "\"}";
+        writer.endFrame(frame);
     }
     
-    std::string handleClearAll() {
-        if (!jackManager->isRunning()) {
-            return "{\"success\":false,\"error\":\"JACK not running\"}";
-        }
-        
-        int cleared = jackManager->clearAllConnections();
-        
-        return "{\"success\":true,"
-               "\"message\":\"Cleared all connections\","
-               "\"count\":" + std::to_string(cleared) + ","
-               "\"method\":\"native_api\","
-               "\"timestamp\":\"" + getCurrentTimestamp() + "\"}";
-    }
+    int port;
+    JackManager* jackManager;
+    MixerManager* mixer;
+    RoutingReconciler* routing;
+    SOCKET listenSocket = INVALID_SOCKET;
+    std::atomic<bool> running{false};
+    std::thread acceptThread;
+    InstrumentedMutex mutex{"control"};
+    std::map<SOCKET, std::thread> clients;
+    std::vector<std::thread> finished;  // exited, not joined yet
 };
 
 // Signal handler
@@ -646,6 +7197,16 @@ void loadConfiguration() {
         g_config.verbose = true;
     }
     
+    const char* tracingEnv = std::getenv("JACK_BRIDGE_TRACING");
+    if (tracingEnv) {
+        g_config.tracing = (std::string(tracingEnv) == "true");
+    }
+    
+    const char* lockStatsEnv = std::getenv("JACK_BRIDGE_LOCK_STATS");
+    if (lockStatsEnv && std::string(lockStatsEnv) == "true") {
+        g_config.lockStats = true;
+    }
+    
     // Try to load from config file
     std::ifstream configFile("jack-bridge.conf");
     if (configFile.is_open()) {
@@ -653,16 +7214,259 @@ void loadConfiguration() {
         while (std::getline(configFile, line)) {
             if (line.find("port=") == 0) {
                 g_config.apiPort = std::stoi(line.substr(5));
+            } else if (line.find("control_port=") == 0) {
+                g_config.controlPort = std::stoi(line.substr(13));
+            } else if (line.find("http_threads=") == 0) {
+                g_config.httpThreads = std::max(1, std::stoi(line.substr(13)));
+            } else if (line.find("http_blocking_threads=") == 0) {
+                g_config.httpBlockingThreads = std::max(1, std::stoi(line.substr(22)));
+            } else if (line.find("jack_timeout_ms=") == 0) {
+                g_config.jackTimeoutMs = std::max(1, std::stoi(line.substr(16)));
+            } else if (line.find("jack_watchdog_ms=") == 0) {
+                g_config.jackWatchdogMs = std::max(1000, std::stoi(line.substr(17)));
+            } else if (line.find("jack_breaker_failures=") == 0) {
+                g_config.jackBreakerFailures = std::max(1, std::stoi(line.substr(22)));
+            } else if (line.find("jack_breaker_slow_ms=") == 0) {
+                g_config.jackBreakerSlowMs = std::max(1, std::stoi(line.substr(21)));
+            } else if (line.find("jack_breaker_open_ms=") == 0) {
+                g_config.jackBreakerOpenMs = std::max(100, std::stoi(line.substr(21)));
             } else if (line.find("log_file=") == 0) {
                 g_config.logFile = line.substr(9);
             } else if (line.find("verbose=") == 0) {
                 g_config.verbose = (line.substr(8) == "true");
+            } else if (line.find("lock_stats=") == 0) {
+                g_config.lockStats = (line.substr(11) == "true");
+            } else if (line.find("tracing=") == 0) {
+                g_config.tracing = (line.substr(8) == "true");
+            } else if (line.find("record_dir=") == 0) {
+                g_config.recordDir = line.substr(11);
+            } else if (line.find("replay_ports=") == 0) {
+                g_config.replayPorts = line.substr(13);
+            } else if (line.find("replay_minutes=") == 0) {
+                g_config.replayMinutes = std::stod(line.substr(15));
+            } else if (line.find("replay_compress=") == 0) {
+                g_config.replayCompress = (line.substr(16) == "true");
+            } else if (line.find("replay_memory_mb=") == 0) {
+                g_config.replayMemoryMb = static_cast<size_t>(std::stoul(line.substr(17)));
+            } else if (line.find("auto_route=") == 0) {
+                g_config.autoRoutes.push_back(line.substr(11));
+            } else if (line.find("auto_route_on_db=") == 0) {
+                g_config.autoRouteOnDb = std::stod(line.substr(17));
+            } else if (line.find("auto_route_off_db=") == 0) {
+                g_config.autoRouteOffDb = std::stod(line.substr(18));
+            } else if (line.find("auto_route_hold_ms=") == 0) {
+                g_config.autoRouteHoldSeconds = std::stod(line.substr(19)) / 1000.0;
+            } else if (line.find("preset.") == 0 && line.find('=') != std::string::npos) {
+                size_t equals = line.find('=');
+                g_config.presets.emplace_back(line.substr(7, equals - 7), line.substr(equals + 1));
+            } else if (line.find("midi_input=") == 0) {
+                g_config.midiInput = line.substr(11);
+            } else if (line.find("midi_channel=") == 0) {
+                g_config.midiChannel = std::stoi(line.substr(13));
+            } else if (line.find("midi_map=") == 0) {
+                g_config.midiMaps.push_back(line.substr(9));
+            } else if (line.find("mixer_inputs=") == 0) {
+                g_config.mixerInputs = static_cast<size_t>(std::stoul(line.substr(13)));
+            } else if (line.find("mixer_outputs=") == 0) {
+                g_config.mixerOutputs = static_cast<size_t>(std::stoul(line.substr(14)));
+            } else if (line.find("mixer_cc=") == 0) {
+                g_config.mixerCcs.push_back(line.substr(9));
+            } else if (line.find("mqtt_host=") == 0) {
+                g_config.mqttHost = line.substr(10);
+            } else if (line.find("mqtt_port=") == 0) {
+                g_config.mqttPort = std::stoi(line.substr(10));
+            } else if (line.find("mqtt_username=") == 0) {
+                g_config.mqttUsername = line.substr(14);
+            } else if (line.find("mqtt_password=") == 0) {
+                g_config.mqttPassword = line.substr(14);
+            } else if (line.find("mqtt_client_id=") == 0) {
+                g_config.mqttClientId = line.substr(15);
+            } else if (line.find("mqtt_keepalive=") == 0) {
+                g_config.mqttKeepAlive = std::stoi(line.substr(15));
+            } else if (line.find("mqtt_base=") == 0) {
+                g_config.mqttBase = line.substr(10);
+            } else if (line.find("mqtt_input.") == 0 && line.find('=') != std::string::npos) {
+                size_t equals = line.find('=');
+                g_config.mqttInputs.emplace_back(line.substr(11, equals - 11), line.substr(equals + 1));
+            } else if (line.find("mqtt_output.") == 0 && line.find('=') != std::string::npos) {
+                size_t equals = line.find('=');
+                g_config.mqttOutputs.emplace_back(line.substr(12, equals - 12), line.substr(equals + 1));
             }
         }
         configFile.close();
     }
 }
 
+// replay_ports=system:capture_1,system:capture_2 (retried by poll() until JACK is up)
+void armReplayFromConfig(ReplayManager& replay) {
+    ReplayManager::Settings settings;
+    std::string_view list = g_config.replayPorts;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        while (!item.empty() && isspace(static_cast<unsigned char>(item.front()))) item.remove_prefix(1);
+        while (!item.empty() && isspace(static_cast<unsigned char>(item.back()))) item.remove_suffix(1);
+        PortName name;
+        if (!item.empty() && name.assign(item)) {
+            settings.sources.push_back(name);
+        }
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+    }
+    settings.seconds = g_config.replayMinutes * 60;
+    settings.compress = g_config.replayCompress;
+    settings.storeBytes = g_config.replayMemoryMb * 1024 * 1024;
+    
+    std::string error;
+    if (!replay.arm(settings, error, true)) {
+        LOG_WARN("Replay buffer not armed: " + error + " (will retry)");
+    }
+}
+
+// auto_route=system:capture_3>system:playback_1,system:playback_2
+void addAutoRoutesFromConfig(AutoRouter& autoRouter) {
+    auto trim = [](std::string_view item) {
+        while (!item.empty() && isspace(static_cast<unsigned char>(item.front()))) item.remove_prefix(1);
+        while (!item.empty() && isspace(static_cast<unsigned char>(item.back()))) item.remove_suffix(1);
+        return item;
+    };
+    
+    for (const std::string& line : g_config.autoRoutes) {
+        std::string_view text = line;
+        size_t arrow = text.find('>');
+        AutoRouter::Rule rule;
+        rule.onDb = g_config.autoRouteOnDb;
+        rule.offDb = g_config.autoRouteOffDb;
+        rule.holdSeconds = g_config.autoRouteHoldSeconds;
+        
+        bool valid = arrow != std::string_view::npos && rule.source.assign(trim(text.substr(0, arrow)));
+        std::string_view list = arrow == std::string_view::npos ? std::string_view() : text.substr(arrow + 1);
+        while (valid && !list.empty()) {
+            size_t comma = list.find(',');
+            PortName destination;
+            std::string_view item = trim(list.substr(0, comma));
+            if (!item.empty()) {
+                valid = destination.assign(item);
+                rule.destinations.push_back(destination);
+            }
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        }
+        
+        std::string error = "Expected source>destination[,destination...]";
+        if (!valid || !autoRouter.add(rule, error)) {
+            LOG_WARN("Ignoring auto_route=" + line + ": " + error);
+        }
+    }
+}
+
+// preset.<name>=from>to,from>to and midi_map=pc3>name / cc80>name
+void loadPresetsFromConfig(PresetManager& presets, MidiControl& midi) {
+    auto trim = [](std::string_view item) {
+        while (!item.empty() && isspace(static_cast<unsigned char>(item.front()))) item.remove_prefix(1);
+        while (!item.empty() && isspace(static_cast<unsigned char>(item.back()))) item.remove_suffix(1);
+        return item;
+    };
+    
+    for (const auto& [name, definition] : g_config.presets) {
+        std::vector<PresetManager::Edge> edges;
+        bool valid = PresetManager::validName(name);
+        std::string_view list = definition;
+        while (valid && !list.empty()) {
+            size_t comma = list.find(',');
+            std::string_view item = trim(list.substr(0, comma));
+            size_t arrow = item.find('>');
+            if (!item.empty()) {
+                PresetManager::Edge edge;
+                valid = arrow != std::string_view::npos &&
+                        edge.from.assign(trim(item.substr(0, arrow))) && !edge.from.empty() &&
+                        edge.to.assign(trim(item.substr(arrow + 1))) && !edge.to.empty();
+                edges.push_back(edge);
+            }
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        }
+        if (!valid) {
+            LOG_WARN("Ignoring preset." + name + ": expected from>to[,from>to...]");
+            continue;
+        }
+        presets.define(name, std::move(edges));
+    }
+    
+    PortName source;
+    if (!source.assign(trim(g_config.midiInput))) {
+        LOG_WARN("Ignoring midi_input: port name too long");
+    }
+    midi.configure(source, g_config.midiChannel >= 0 && g_config.midiChannel <= 16 ? g_config.midiChannel : 0);
+    
+    for (const std::string& line : g_config.midiMaps) {
+        std::string_view text = trim(line);
+        size_t arrow = text.find('>');
+        MidiControl::Mapping mapping;
+        std::string error = "Expected pc<n>>preset or cc<n>>preset";
+        if (arrow != std::string_view::npos && arrow > 2 &&
+            (text.substr(0, 2) == "pc" || text.substr(0, 2) == "cc")) {
+            mapping.program = text.substr(0, 2) == "pc";
+            std::string_view digits = trim(text.substr(2, arrow - 2));
+            auto parsed = std::from_chars(digits.data(), digits.data() + digits.length(), mapping.number);
+            if (parsed.ec != std::errc() || parsed.ptr != digits.data() + digits.length()) mapping.number = -1;
+            mapping.preset = std::string(trim(text.substr(arrow + 1)));
+            if (midi.map(mapping, error)) continue;
+        }
+        LOG_WARN("Ignoring midi_map=" + line + ": " + error);
+    }
+    if (!g_config.midiMaps.empty() || !g_config.midiInput.empty()) {
+        midi.start();
+    }
+}
+
+void startMixerFromConfig(MixerManager& mixer) {
+    PortName source;
+    source.assign(g_config.midiInput);
+    mixer.configure(g_config.mixerInputs, g_config.mixerOutputs, source);
+    for (const std::string& line : g_config.mixerCcs) {
+        int cc = 0;
+        MixerBinding binding;
+        if (MixerManager::parseBinding(line, cc, binding)) {
+            mixer.bind(cc, binding);
+        } else {
+            LOG_WARN("Ignoring mixer_cc=" + line + ": expected cc[:channel]>gain|mute:output:input");
+        }
+    }
+    if (mixer.enabled()) {
+        mixer.start();
+    }
+}
+
+// mqtt_host=... plus mqtt_input.<key>=port / mqtt_output.<key>=port switches
+void startMqttFromConfig(MqttBridge& mqtt) {
+    if (g_config.mqttHost.empty()) return;
+    
+    MqttBridge::Settings settings;
+    settings.host = g_config.mqttHost;
+    settings.port = g_config.mqttPort;
+    settings.username = g_config.mqttUsername;
+    settings.password = g_config.mqttPassword;
+    settings.clientId = g_config.mqttClientId;
+    settings.keepAliveSeconds = g_config.mqttKeepAlive;
+    settings.base = g_config.mqttBase;
+    
+    // Keys become topic levels and are split at "_to_", so keep them plain
+    auto load = [](const std::vector<std::pair<std::string, std::string>>& lines, const char* kind,
+                   std::vector<std::pair<std::string, PortName>>& into) {
+        for (const auto& [key, port] : lines) {
+            PortName name;
+            bool valid = PresetManager::validName(key) && key.find('_') == std::string::npos &&
+                         name.assign(port) && !name.empty();
+            if (!valid) {
+                LOG_WARN(std::string("Ignoring mqtt_") + kind + "." + key + ": expected a key without '_' and a port");
+                continue;
+            }
+            into.emplace_back(key, name);
+        }
+    };
+    load(g_config.mqttInputs, "input", settings.inputs);
+    load(g_config.mqttOutputs, "output", settings.outputs);
+    mqtt.start(std::move(settings));
+}
+
 // Main function
 int main(int argc, char* argv[]) {
     // Parse command line arguments
@@ -674,6 +7478,10 @@ int main(int argc, char* argv[]) {
             g_config.verbose = true;
         } else if (arg == "--log-file" && i + 1 < argc) {
             g_config.logFile = argv[++i];
+        } else if (arg == "--lock-stats") {
+            g_config.lockStats = true;
+        } else if (arg == "--no-tracing") {
+            g_config.tracing = false;
         } else if (arg == "--help") {
             std::cout << "JACK Audio Bridge - Local Windows Service\n"
                       << "Usage: " << argv[0] << " [options]\n"
@@ -681,12 +7489,16 @@ int main(int argc, char* argv[]) {
                       << "  --port <port>       API port (default: 6666)\n"
                       << "  --verbose           Enable verbose logging\n"
                       << "  --log-file <file>   Log file path\n"
+                      << "  --lock-stats        Record lock contention statistics\n"
+                      << "  --no-tracing        Disable request tracing spans\n"
                       << "  --help              Show this help\n";
             return 0;
         }
     }
     
     loadConfiguration();
+    InstrumentedMutex::setEnabled(g_config.lockStats);
+    TraceRegistry::setEnabled(g_config.tracing);
     
     // Initialize logging
     if (g_config.enableLogging) {
@@ -703,6 +7515,10 @@ int main(int argc, char* argv[]) {
     LOG_INFO("  API Port: " + std::to_string(g_config.apiPort));
     LOG_INFO("  Log File: " + g_config.logFile);
     LOG_INFO("  Verbose: " + std::string(g_config.verbose ? "enabled" : "disabled"));
+    LOG_INFO("  Lock Stats: " + std::string(g_config.lockStats ? "enabled" : "disabled"));
+    LOG_INFO("  Tracing: " + std::string(g_config.tracing ? "enabled" : "disabled"));
+    LOG_INFO("  Replay: " + (g_config.replayPorts.empty() ? std::string("off") : g_config.replayPorts));
+    LOG_INFO("  Auto-route rules: " + std::to_string(g_config.autoRoutes.size()));
     LOG_INFO("=================================================================");
     
     // Setup signal handlers
@@ -710,6 +7526,18 @@ int main(int argc, char* argv[]) {
     
     // Initialize JACK manager
     JackManager jackManager;
+    RecordingManager recordings(&jackManager);
+    ReplayManager replay(&jackManager);
+    MonitorManager monitors(&jackManager);
+    SpectrumAnalyzer spectrum(&monitors);
+    LoudnessManager loudness(&monitors);
+    AutoRouter autoRouter(&jackManager);
+    LatencyMeter latency(&jackManager);
+    PresetManager presets(&jackManager);
+    MidiControl midi(&jackManager, &presets);
+    MixerManager mixer(&jackManager);
+    MqttBridge mqtt(&jackManager, &presets);
+    RoutingReconciler routing(&jackManager);
     
     // Try to connect to JACK
     LOG_INFO("Attempting to connect to JACK server...");
@@ -718,12 +7546,42 @@ int main(int argc, char* argv[]) {
     }
     
     // Create and start HTTP server
-    g_server = std::make_unique<HttpServer>(g_config.apiPort, &jackManager);
+    BridgeServices services;
+    services.jack = &jackManager;
+    services.recordings = &recordings;
+    services.replay = &replay;
+    services.monitors = &monitors;
+    services.spectrum = &spectrum;
+    services.loudness = &loudness;
+    services.autoRouter = &autoRouter;
+    services.latency = &latency;
+    services.presets = &presets;
+    services.midi = &midi;
+    services.mixer = &mixer;
+    services.mqtt = &mqtt;
+    services.routing = &routing;
+    
+    if (!g_config.replayPorts.empty()) {
+        armReplayFromConfig(replay);
+    }
+    addAutoRoutesFromConfig(autoRouter);
+    loadPresetsFromConfig(presets, midi);
+    startMixerFromConfig(mixer);
+    g_server = std::make_unique<HttpServer>(g_config.apiPort, services);
     
     if (!g_server->start()) {
         LOG_ERROR("Failed to start HTTP server");
         return 1;
     }
+    startMqttFromConfig(mqtt);
+    
+    std::unique_ptr<ControlServer> control;
+    if (g_config.controlPort > 0) {
+        control = std::make_unique<ControlServer>(g_config.controlPort, services);
+        if (!control->start()) {
+            control.reset();
+        }
+    }
     
     LOG_INFO("=================================================================");
     LOG_INFO("JACK Audio Bridge Service Ready");
@@ -736,6 +7594,12 @@ int main(int argc, char* argv[]) {
     int statusCheckCounter = 0;
     while (g_serviceRunning) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
+        recordings.poll();
+        replay.poll();
+        monitors.poll();
+        midi.poll();
+        mixer.poll();
+        jackManager.watchdog();
         
         // Periodic status check and JACK reconnection
         if (++statusCheckCounter >= 30) { // Every 30 seconds
@@ -760,11 +7624,21 @@ int main(int argc, char* argv[]) {
     LOG_INFO("Service shutting down...");
     
     // Cleanup
+    control.reset();
+    mqtt.stop();
     if (g_server) {
         g_server->stop();
         g_server.reset();
     }
     
+    recordings.stopAll();
+    replay.disarm();
+    spectrum.stop();
+    loudness.stopAll();
+    autoRouter.stop();
+    midi.stop();
+    mixer.stop();
+    routing.stop();
     jackManager.shutdown();
     
     if (g_logFile.is_open()) {
@@ -0,0 +1,239 @@
+// jack-bridge-local/tools/control_bench.cpp
+// Routing throughput of a running bridge: HTTP vs the binary control protocol
+//
+// Toggles every --from x --to pair (comma-separated lists) on and off
+// through each path until --ops changes are made, and prints changes per
+// second:
+//
+//   http        POST /connect and /disconnect, one request per connection
+//   pipelined   one change per control frame, --window frames in flight
+//   batched     all pairs in one Connect or Disconnect frame
+//
+// The bridge needs control_port set in jack-bridge.conf.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+
+#include "control_protocol.h"
+
+#pragma comment(lib, "ws2_32.lib")
+
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int httpPort = 6666;
+    int controlPort = 6667;
+    int ops = 2000;
+    int window = 64;
+    std::vector<std::pair<std::string, std::string>> pairs;
+};
+
+std::vector<std::string> splitList(std::string_view list) {
+    std::vector<std::string> items;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        if (comma != 0) items.emplace_back(list.substr(0, comma));
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+    }
+    return items;
+}
+
+SOCKET dial(const std::string& host, int port) {
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<u_short>(port));
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) return INVALID_SOCKET;
+    SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) return s;
+    if (connect(s, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        closesocket(s);
+        return INVALID_SOCKET;
+    }
+    BOOL noDelay = TRUE;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+    return s;
+}
+
+bool sendAll(SOCKET s, const std::string& data) {
+    size_t done = 0;
+    while (done < data.length()) {
+        int sent = send(s, data.data() + done, static_cast<int>(data.length() - done), 0);
+        if (sent <= 0) return false;
+        done += static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// One change per HTTP request, the way the web UI makes them
+bool httpToggle(const Options& options, const std::pair<std::string, std::string>& pair, bool on) {
+    SOCKET s = dial(options.host, options.httpPort);
+    if (s == INVALID_SOCKET) return false;
+    std::string body = "{\"source\":\"" + pair.first + "\",\"destination\":\"" + pair.second + "\"}";
+    std::string request = std::string("POST ") + (on ? "/connect" : "/disconnect") + " HTTP/1.1\r\n"
+                          "Host: " + options.host + "\r\n"
+                          "Content-Type: application/json\r\n"
+                          "Content-Length: " + std::to_string(body.length()) + "\r\n"
+                          "Connection: close\r\n\r\n" + body;
+    bool ok = sendAll(s, request);
+    std::string response;
+    char buffer[4096];
+    int received;
+    while (ok && (received = recv(s, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, static_cast<size_t>(received));
+    }
+    closesocket(s);
+    return ok && response.find("\"success\":true") != std::string::npos;
+}
+
+class ControlClient {
+public:
+    bool open(const Options& options) {
+        socket_ = dial(options.host, options.controlPort);
+        return socket_ != INVALID_SOCKET;
+    }
+    ~ControlClient() {
+        if (socket_ != INVALID_SOCKET) closesocket(socket_);
+    }
+
+    // Queues a Connect or Disconnect frame for pairs [first, first + count)
+    void queue(uint32_t id, bool on, const Options& options, size_t first, size_t count) {
+        control::Writer writer(pending_);
+        size_t frame = writer.beginFrame(id, on ? control::Connect : control::Disconnect);
+        writer.u16(static_cast<uint16_t>(count));
+        for (size_t i = first; i < first + count; i++) {
+            writer.str(options.pairs[i].first);
+            writer.str(options.pairs[i].second);
+        }
+        writer.endFrame(frame);
+    }
+
+    bool flush() {
+        bool ok = sendAll(socket_, pending_);
+        pending_.clear();
+        return ok;
+    }
+
+    // Next reply; counts the ops it reports as done
+    bool reply(int& succeeded) {
+        control::Frame frame;
+        while (!in_.peek(frame)) {
+            if (in_.malformed()) return false;
+            char buffer[16384];
+            int received = recv(socket_, buffer, sizeof(buffer), 0);
+            if (received <= 0) return false;
+            in_.feed(buffer, static_cast<size_t>(received));
+        }
+        control::Reader reader(frame.payload);
+        uint16_t count = frame.code == control::Ok ? reader.u16() : 0;
+        for (uint16_t i = 0; i < count; i++) {
+            succeeded += reader.u8();
+        }
+        in_.consume();
+        return true;
+    }
+
+private:
+    SOCKET socket_ = INVALID_SOCKET;
+    std::string pending_;
+    control::FrameBuffer in_;
+};
+
+void report(const char* name, int ops, int succeeded, std::chrono::steady_clock::duration elapsed) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    std::printf("%-10s %8d ops %8d ok %10.3f s %12.0f ops/s\n", name, ops, succeeded, seconds,
+                seconds > 0 ? ops / seconds : 0.0);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    std::string from = "system:capture_1", to = "system:playback_1";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string_view arg = argv[i];
+        const char* value = argv[i + 1];
+        if (arg == "--host") options.host = value;
+        else if (arg == "--http-port") options.httpPort = std::atoi(value);
+        else if (arg == "--control-port") options.controlPort = std::atoi(value);
+        else if (arg == "--ops") options.ops = std::atoi(value);
+        else if (arg == "--window") options.window = std::atoi(value);
+        else if (arg == "--from") from = value;
+        else if (arg == "--to") to = value;
+        else {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+    options.window = std::max(options.window, 1);
+    for (const std::string& source : splitList(from)) {
+        for (const std::string& destination : splitList(to)) {
+            options.pairs.emplace_back(source, destination);
+        }
+    }
+    size_t pairCount = options.pairs.size();
+    if (pairCount == 0 || pairCount > 65535) {
+        std::fprintf(stderr, "Need between 1 and 65535 port pairs\n");
+        return 2;
+    }
+    // Change i toggles pair i % pairCount; a full sweep connects, the next disconnects
+    auto connecting = [&](int i) { return (i / pairCount) % 2 == 0; };
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return 1;
+    using Clock = std::chrono::steady_clock;
+
+    int succeeded = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < options.ops; i++) {
+        succeeded += httpToggle(options, options.pairs[i % pairCount], connecting(i)) ? 1 : 0;
+    }
+    report("http", options.ops, succeeded, Clock::now() - start);
+
+    ControlClient pipelined;
+    if (!pipelined.open(options)) {
+        std::fprintf(stderr, "Cannot reach the control port %d\n", options.controlPort);
+        WSACleanup();
+        return 1;
+    }
+    succeeded = 0;
+    start = Clock::now();
+    int sent = 0, received = 0;
+    bool ok = true;
+    while (ok && received < options.ops) {
+        while (sent < options.ops && sent - received < options.window) {
+            pipelined.queue(static_cast<uint32_t>(sent + 1), connecting(sent), options, sent % pairCount, 1);
+            sent++;
+        }
+        ok = pipelined.flush() && pipelined.reply(succeeded);
+        received++;
+    }
+    report("pipelined", options.ops, succeeded, Clock::now() - start);
+
+    ControlClient batched;
+    succeeded = 0;
+    ok = batched.open(options);
+    start = Clock::now();
+    int done = 0;
+    for (uint32_t id = 1; ok && done < options.ops; id++) {
+        size_t count = std::min(pairCount, static_cast<size_t>(options.ops - done));
+        batched.queue(id, connecting(done), options, 0, count);
+        ok = batched.flush() && batched.reply(succeeded);
+        done += static_cast<int>(count);
+    }
+    report("batched", done, succeeded, Clock::now() - start);
+
+    WSACleanup();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+// jack-bridge-local/tools/route_bench.cpp
+// Route dispatch cost: compile-time perfect hash vs a chain of comparisons
+//
+// Builds synthetic route tables of 8, 64 and 512 routes (every eighth one
+// with an {id:int} parameter), then looks up every route's path plus one
+// path that matches nothing, and prints nanoseconds per lookup for:
+//
+//   router   http::Router, the table HttpServer dispatches with
+//   chain    the routes tried in order, as processRequest used to
+//
+// The router should stay flat as the table grows; the chain grows with it.
+// No bridge or JACK is needed.
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "route_table.h"
+
+namespace {
+
+constexpr size_t kWidth = 32;
+
+template <size_t N>
+struct PatternText {
+    std::array<char, N * kWidth> chars{};
+    std::array<size_t, N> lengths{};
+};
+
+constexpr bool hasParam(size_t i) { return i % 8 == 7; }
+
+// "/api/r0042/state", or "/api/r0047/{id:int}/detail" for parameter routes
+template <size_t N>
+consteval PatternText<N> makeText() {
+    PatternText<N> text;
+    for (size_t i = 0; i < N; i++) {
+        char* out = text.chars.data() + i * kWidth;
+        size_t length = 0;
+        auto put = [&](std::string_view part) {
+            for (char c : part) out[length++] = c;
+        };
+        put("/api/r");
+        for (size_t divisor = 1000; divisor > 0; divisor /= 10) out[length++] = static_cast<char>('0' + (i / divisor) % 10);
+        put(hasParam(i) ? "/{id:int}/detail" : "/state");
+        text.lengths[i] = length;
+    }
+    return text;
+}
+
+template <size_t N>
+constexpr PatternText<N> kText = makeText<N>();
+
+template <size_t N>
+consteval std::array<http::Route<int>, N> makeRoutes() {
+    std::array<http::Route<int>, N> routes{};
+    for (size_t i = 0; i < N; i++) {
+        routes[i] = {http::Method::Get, std::string_view(kText<N>.chars.data() + i * kWidth, kText<N>.lengths[i]),
+                     static_cast<int>(i)};
+    }
+    return routes;
+}
+
+template <size_t N>
+constexpr http::Router<int, N> kRouter{makeRoutes<N>()};
+
+// The old dispatch: every route in turn until one matches
+template <size_t N>
+const int* chainFind(const std::array<http::Route<int>, N>& routes, const std::array<uint32_t, N>& masks,
+                     http::Method method, std::string_view path, http::RouteParams& params) {
+    for (size_t i = 0; i < N; i++) {
+        const http::Route<int>& route = routes[i];
+        if (route.method != method && route.method != http::Method::Any) continue;
+        if (masks[i] == 0 ? route.pattern == path
+                          : http::detail::matchPath(route.pattern.substr(1), path.substr(1), masks[i], params)) {
+            return &route.handler;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Find>
+double nanosPerLookup(const std::vector<std::string>& paths, size_t rounds, long long& checksum, Find find) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; round++) {
+        for (const std::string& path : paths) {
+            const int* handler = find(path);
+            checksum += handler ? *handler : -1;
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(rounds * paths.size());
+}
+
+template <size_t N>
+void run() {
+    constexpr std::array<http::Route<int>, N> routes = makeRoutes<N>();
+    std::array<uint32_t, N> masks{};
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < N; i++) {
+        masks[i] = http::detail::paramMask(routes[i].pattern.substr(1));
+        std::string path(routes[i].pattern);
+        if (hasParam(i)) path.replace(path.find("{id:int}"), 8, "42");
+        paths.push_back(path);
+    }
+    paths.push_back("/api/missing/state");
+
+    size_t rounds = std::max<size_t>(1, 4000000 / paths.size());
+    long long checksum = 0;
+    http::RouteParams params;
+    double router = nanosPerLookup(paths, rounds, checksum, [&](std::string_view path) {
+        return kRouter<N>.find(http::Method::Get, path, params);
+    });
+    double chain = nanosPerLookup(paths, rounds, checksum, [&](std::string_view path) {
+        return chainFind(routes, masks, http::Method::Get, path, params);
+    });
+    std::printf("%6zu routes %6zu shapes %10.1f ns router %10.1f ns chain   (%lld)\n", N, kRouter<N>.shapes(),
+                router, chain, checksum);
+}
+
+}  // namespace
+
+int main() {
+    run<8>();
+    run<64>();
+    run<512>();
+    return 0;
+}
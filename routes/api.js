@@ -16,9 +16,9 @@ const router = express.Router();
  */
 router.get('/status', async (req, res) => {
   try {
-    const jackRunning = await jackService.checkStatus();
+    const snapshot = await jackService.getSnapshot().catch(() => null);
 
-    if (!jackRunning) {
+    if (!snapshot || !snapshot.jack_running) {
       return res.json({
         status: 'error',
         message: 'JACK server not running',
@@ -32,9 +32,12 @@ router.get('/status', async (req, res) => {
       });
     }
 
-    // Use connectionService for high-level operations
-    const connections = await connectionService.getCurrentConnections();
-    const connectionOutput = await jackService.listConnections(); // Raw output for debugging
+    // One bridge read; the tracker is synced from the same connection list
+    const connectionOutput = jackService.convertConnectionsToLspFormat(
+      snapshot.connections
+    ); // Raw output for debugging
+    const connections = jackService.parseConnections(connectionOutput);
+    connectionService.syncTrackerWithJack(connections);
 
     res.json({
       status: 'ok',
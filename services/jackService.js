@@ -35,6 +35,14 @@ class JackService {
   }
 
   setupHttpInterceptors() {
+    // Tell the bridge how long we wait, so it drops work we have given up on
+    this.httpClient.interceptors.request.use((request) => {
+      if (request.timeout) {
+        request.headers['X-Request-Timeout-Ms'] = String(request.timeout);
+      }
+      return request;
+    });
+
     this.httpClient.interceptors.response.use(
       (response) => response,
       (error) => {
@@ -163,6 +171,24 @@ class JackService {
     }
   }
 
+  /**
+   * Status, ports and connections in one consistent read
+   */
+  async getSnapshot() {
+    const response = await this.httpClient.get('/snapshot');
+    const data = response.data;
+
+    this.statusCache = {
+      running: data.jack_running || false,
+      lastCheck: Date.now(),
+    };
+
+    if (!data.success) {
+      throw new Error(data.error || 'Failed to get snapshot');
+    }
+    return data;
+  }
+
   convertConnectionsToLspFormat(connections) {
     const portMap = new Map();
 
@@ -221,7 +247,12 @@ class JackService {
         destination: destinationPort,
       });
 
-      if (response.data.success) {
+      if (response.data.queued) {
+        logger.warn(
+          `⏳ JACK unavailable, connect queued: ${sourcePort} -> ${destinationPort}`
+        );
+        return 'queued';
+      } else if (response.data.success) {
         logger.info(`✅ Connected: ${sourcePort} -> ${destinationPort}`);
         return response.data.already_connected
           ? 'already connected'
@@ -246,7 +277,12 @@ class JackService {
         destination: destinationPort,
       });
 
-      if (response.data.success) {
+      if (response.data.queued) {
+        logger.warn(
+          `⏳ JACK unavailable, disconnect queued: ${sourcePort} -> ${destinationPort}`
+        );
+        return { method: 'bridge_api', success: true, queued: true };
+      } else if (response.data.success) {
         logger.info(`✅ Disconnected: ${sourcePort} -> ${destinationPort}`);
         return { method: 'bridge_api', success: true };
       } else {
@@ -339,10 +375,13 @@ class JackService {
 
   async arePortsConnected(sourcePort, destinationPort) {
     try {
-      const connections = await this.getCurrentConnections();
-      return connections.some(
-        (conn) => conn.from === sourcePort && conn.to === destinationPort
-      );
+      const response = await this.httpClient.get('/connections/exists', {
+        params: { source: sourcePort, destination: destinationPort },
+      });
+      if (!response.data.success) {
+        throw new Error(response.data.error || 'Connection check failed');
+      }
+      return response.data.connected;
     } catch (error) {
       logger.error(`❌ Error checking connection: ${error.message}`);
       return false;
@@ -351,10 +390,15 @@ class JackService {
 
   async getPortConnections(portName) {
     try {
-      const connections = await this.getCurrentConnections();
+      const response = await this.httpClient.get(
+        `/ports/${encodeURIComponent(portName)}/connections`
+      );
+      if (!response.data.success) {
+        throw new Error(response.data.error || 'Failed to get port connections');
+      }
       return {
-        outgoing: connections.filter((conn) => conn.from === portName),
-        incoming: connections.filter((conn) => conn.to === portName),
+        outgoing: response.data.outgoing,
+        incoming: response.data.incoming,
       };
     } catch (error) {
       logger.error(`❌ Error getting port connections: ${error.message}`);
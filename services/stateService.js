@@ -42,13 +42,16 @@ class StateService {
    */
   async saveState() {
     try {
-      if (!(await jackService.checkStatus())) {
+      const snapshot = await jackService.getSnapshot().catch(() => null);
+      if (!snapshot || !snapshot.jack_running) {
         logger.warn('⚠️ JACK not running, skipping state save');
         return false;
       }
 
-      const connectionOutput = await jackService.listConnections();
-      const parsedConnections = jackService.parseConnections(connectionOutput);
+      const parsedConnections = snapshot.connections.map(({ from, to }) => ({
+        from,
+        to,
+      }));
       const trackedConnections = connectionService.getTrackedConnections();
 
       const currentState = {